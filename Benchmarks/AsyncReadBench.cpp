@@ -0,0 +1,54 @@
+#include "../asyncfilereader.h"
+#include "../logger.h"
+#include <QFile>
+#include <QTextStream>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    // Pass an existing file (ideally larger than the page cache) to measure the device.
+    string path = argc > 1 ? argv[1] : "async_read_bench.txt";
+    bool generated = argc <= 1;
+
+    Logger::setLogLevel(Logger::Warning);
+
+    if (generated) {
+        mt19937_64 rng(11);
+        ofstream out(path, ios::binary);
+        for (size_t i = 0; i < 20000000; i++) {
+            out << "w" << rng() % 100000 << (i % 12 ? ' ' : '\n');
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    uint64_t lineBytes = 0;
+    {
+        QFile file(QString::fromStdString(path));
+        file.open(QIODevice::ReadOnly | QIODevice::Text);
+        QTextStream in(&file);
+        while (!in.atEnd()) lineBytes += static_cast<uint64_t>(in.readLine().size()) + 1;
+    }
+    double lineSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "file: " << path << "\n"
+         << "QTextStream::readLine: " << lineSeconds << " s\n";
+
+    for (auto backend : {AsyncFileReader::Pread, AsyncFileReader::Auto}) {
+        AsyncFileReader reader(backend);
+        uint64_t bytes = 0;
+        start = chrono::steady_clock::now();
+        reader.read({path}, [&](const AsyncFileReader::Block& block) { bytes += block.size; });
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << AsyncFileReader::backendName(reader.backend()) << ": " << seconds << " s, "
+             << bytes / seconds / (1 << 20) << " MiB/s (" << lineSeconds / seconds << "x)\n";
+    }
+
+    if (generated) remove(path.c_str());
+    return lineBytes > 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include "../dictionary.h"
+#include "../frozendictionary.h"
+#include "../logger.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+const size_t BatchSize = 1024;
+
+template <typename Run>
+double nanosecondsPerLookup(size_t lookups, Run run) {
+    auto start = chrono::steady_clock::now();
+    run();
+    auto elapsed = chrono::steady_clock::now() - start;
+    return chrono::duration<double, nano>(elapsed).count() / static_cast<double>(lookups);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    // The default vocabulary (~8M words, several hundred MB of nodes and
+    // tables) is meant to be far larger than the last-level cache.
+    size_t wordCount = argc > 1 ? stoul(argv[1]) : 8000000;
+    size_t queryCount = argc > 2 ? stoul(argv[2]) : 4000000;
+
+    Logger::setLogLevel(Logger::Warning);
+    mt19937_64 rng(7);
+
+    Dictionary dictionary;
+    for (size_t i = 0; dictionary.size() < wordCount; i++) {
+        dictionary.addWord("w" + to_string(rng() % (wordCount * 4)));
+    }
+    FrozenDictionary frozen = dictionary.freeze();
+
+    vector<pair<string, int>> words = dictionary.getWordsAlphabetically();
+    vector<string> queryStorage;
+    queryStorage.reserve(queryCount);
+    uniform_int_distribution<size_t> pick(0, words.size() - 1);
+    for (size_t i = 0; i < queryCount; i++) {
+        queryStorage.push_back(words[pick(rng)].first);
+    }
+    vector<string_view> queries(queryStorage.begin(), queryStorage.end());
+    vector<uint64_t> counts(queries.size());
+
+    uint64_t single = 0;
+    uint64_t batched = 0;
+    uint64_t frozenSingle = 0;
+    uint64_t frozenBatched = 0;
+
+    double singleNs = nanosecondsPerLookup(queries.size(), [&]() {
+        for (string_view query : queries) single += static_cast<uint64_t>(dictionary.count(query));
+    });
+    double batchedNs = nanosecondsPerLookup(queries.size(), [&]() {
+        for (size_t base = 0; base < queries.size(); base += BatchSize) {
+            size_t n = min(BatchSize, queries.size() - base);
+            dictionary.countMany(span(queries).subspan(base, n), span(counts).subspan(base, n));
+        }
+        for (uint64_t count : counts) batched += count;
+    });
+    double frozenSingleNs = nanosecondsPerLookup(queries.size(), [&]() {
+        for (string_view query : queries) frozenSingle += frozen.count(query);
+    });
+    double frozenBatchedNs = nanosecondsPerLookup(queries.size(), [&]() {
+        for (size_t base = 0; base < queries.size(); base += BatchSize) {
+            size_t n = min(BatchSize, queries.size() - base);
+            frozen.countMany(span(queries).subspan(base, n), span(counts).subspan(base, n));
+        }
+        for (uint64_t count : counts) frozenBatched += count;
+    });
+
+    cout << "words: " << words.size() << ", queries: " << queries.size() << "\n"
+         << "Dictionary::count       " << singleNs << " ns\n"
+         << "Dictionary::countMany   " << batchedNs << " ns (" << singleNs / batchedNs << "x)\n"
+         << "FrozenDictionary::count " << frozenSingleNs << " ns\n"
+         << "FrozenDictionary::many  " << frozenBatchedNs << " ns (" << frozenSingleNs / frozenBatchedNs << "x)\n";
+
+    return single == batched && frozenSingle == frozenBatched && single == frozenSingle ? 0 : 1;
+}
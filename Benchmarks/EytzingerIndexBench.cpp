@@ -0,0 +1,59 @@
+#include "../dictionary.h"
+#include "../eytzingerindex.h"
+#include "../logger.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    size_t wordCount = argc > 1 ? stoul(argv[1]) : 4000000;
+    size_t queryCount = argc > 2 ? stoul(argv[2]) : 2000000;
+
+    Logger::setLogLevel(Logger::Warning);
+    mt19937_64 rng(11);
+
+    Dictionary dictionary;
+    while (dictionary.size() < wordCount) {
+        dictionary.addWord("w" + to_string(rng() % (wordCount * 4)));
+    }
+    vector<pair<string, int>> words = dictionary.getWordsAlphabetically();
+
+    auto buildStart = chrono::steady_clock::now();
+    EytzingerIndex index;
+    index.build(words);
+    double buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - buildStart).count();
+
+    vector<string> queries;
+    queries.reserve(queryCount);
+    for (size_t i = 0; i < queryCount; i++) {
+        queries.push_back("w" + to_string(rng() % (wordCount * 4)));
+    }
+
+    size_t binaryChecksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (const auto& query : queries) {
+        binaryChecksum += lower_bound(words.begin(), words.end(), query,
+                                      [](const auto& a, const string& b) { return a.first < b; }) -
+                          words.begin();
+    }
+    double binaryNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() /
+                      static_cast<double>(queries.size());
+
+    size_t eytzingerChecksum = 0;
+    start = chrono::steady_clock::now();
+    for (const auto& query : queries) {
+        eytzingerChecksum += index.lowerBound(query);
+    }
+    double eytzingerNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() /
+                         static_cast<double>(queries.size());
+
+    cout << "words: " << words.size() << ", queries: " << queries.size() << "\n"
+         << "build: " << buildSeconds << " s, index: " << index.memoryUsage() << " bytes\n"
+         << "std::lower_bound: " << binaryNs << " ns\n"
+         << "Eytzinger:        " << eytzingerNs << " ns (" << binaryNs / eytzingerNs << "x)\n";
+
+    return binaryChecksum == eytzingerChecksum ? 0 : 1;
+}
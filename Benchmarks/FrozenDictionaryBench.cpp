@@ -0,0 +1,78 @@
+#include "../dictionary.h"
+#include "../frozendictionary.h"
+#include "../logger.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+string randomWord(mt19937_64& rng) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+    uniform_int_distribution<int> length(3, 14);
+    uniform_int_distribution<int> letter(0, 25);
+
+    string word(static_cast<size_t>(length(rng)), 'a');
+    for (char& c : word) c = letters[letter(rng)];
+    return word;
+}
+
+template <typename Lookup>
+double nanosecondsPerLookup(const vector<string>& queries, Lookup lookup, uint64_t& checksum) {
+    auto start = chrono::steady_clock::now();
+    for (const auto& query : queries) {
+        checksum += lookup(query);
+    }
+    auto elapsed = chrono::steady_clock::now() - start;
+    return chrono::duration<double, nano>(elapsed).count() / static_cast<double>(queries.size());
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t wordCount = argc > 1 ? stoul(argv[1]) : 1000000;
+    size_t queryCount = argc > 2 ? stoul(argv[2]) : 2000000;
+
+    Logger::setLogLevel(Logger::Warning);
+    mt19937_64 rng(42);
+
+    Dictionary dictionary;
+    while (dictionary.size() < wordCount) {
+        dictionary.addWord(randomWord(rng));
+    }
+
+    auto buildStart = chrono::steady_clock::now();
+    FrozenDictionary frozen = dictionary.freeze();
+    double buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - buildStart).count();
+
+    vector<pair<string, int>> words = dictionary.getWordsAlphabetically();
+    map<string, int, less<>> wordMap(words.begin(), words.end());
+    vector<string> queries;
+    queries.reserve(queryCount);
+    uniform_int_distribution<size_t> pick(0, words.size() - 1);
+    for (size_t i = 0; i < queryCount; i++) {
+        queries.push_back(i % 4 == 3 ? randomWord(rng) + "#" : words[pick(rng)].first);
+    }
+
+    uint64_t mapChecksum = 0;
+    uint64_t frozenChecksum = 0;
+    double mapNs = nanosecondsPerLookup(queries, [&](const string& q) {
+        auto it = wordMap.find(q);
+        return it == wordMap.end() ? uint64_t(0) : static_cast<uint64_t>(it->second);
+    }, mapChecksum);
+    double frozenNs = nanosecondsPerLookup(queries, [&](const string& q) {
+        return frozen.count(q);
+    }, frozenChecksum);
+
+    cout << "words: " << words.size() << ", queries: " << queries.size() << " (25% misses)\n"
+         << "freeze: " << buildSeconds << " s, image: " << frozen.memoryUsage() << " bytes, "
+         << "hash overhead: " << frozen.hashBitsPerKey() << " bits/key\n"
+         << "std::map lookup:  " << mapNs << " ns\n"
+         << "frozen lookup:    " << frozenNs << " ns\n"
+         << "speedup:          " << mapNs / frozenNs << "x\n";
+
+    return mapChecksum == frozenChecksum ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+#include "../dictionary.h"
+#include "../logger.h"
+#include <QString>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    // Pass an existing text file to measure a real corpus.
+    string path = argc > 1 ? argv[1] : "ngram_ingest_bench.txt";
+    bool generated = argc <= 1;
+
+    Logger::setLogLevel(Logger::Warning);
+
+    if (generated) {
+        // Zipf-like word frequencies, so that frequent bigrams repeat and
+        // the long tail keeps the n-gram tables growing.
+        mt19937_64 rng(5);
+        exponential_distribution<double> rank(0.5);
+        ofstream out(path, ios::binary);
+        for (size_t i = 0; i < 5000000; i++) {
+            out << "w" << static_cast<uint64_t>(exp(rank(rng))) % 200000 << (i % 12 ? ' ' : '\n');
+        }
+    }
+
+    double unigramSeconds = 0;
+    for (int order : {1, 2, 3}) {
+        Dictionary dictionary;
+        dictionary.setNGramOrder(order);
+        auto start = chrono::steady_clock::now();
+        dictionary.addWordsFromFile(QString::fromStdString(path));
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (order == 1) unigramSeconds = seconds;
+
+        cout << "order " << order << ": " << seconds << " s, " << dictionary.size() << " words";
+        if (order > 1) {
+            cout << ", " << dictionary.nGramCount(order) << " " << order << "-grams ("
+                 << seconds / unigramSeconds << "x unigram)";
+        }
+        cout << "\n";
+    }
+
+    if (generated) remove(path.c_str());
+    return 0;
+}
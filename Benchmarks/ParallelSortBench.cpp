@@ -0,0 +1,58 @@
+#include "../parallelsort.h"
+#include "../logger.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    size_t wordCount = argc > 1 ? stoul(argv[1]) : 4000000;
+
+    Logger::setLogLevel(Logger::Warning);
+    mt19937_64 rng(5);
+
+    vector<pair<string, int>> words;
+    words.reserve(wordCount);
+    for (size_t i = 0; i < wordCount; i++) {
+        // Zipf-like counts: most words are rare, a few are very frequent.
+        int count = static_cast<int>(1 + (wordCount / (1 + rng() % wordCount)) % 1000000);
+        words.emplace_back("w" + to_string(rng() % (wordCount * 4)), count);
+    }
+
+    auto frequencyOrder = [](const auto& a, const auto& b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    };
+
+    auto comparison = words;
+    auto start = chrono::steady_clock::now();
+    sort(comparison.begin(), comparison.end(), frequencyOrder);
+    double comparisonSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    auto radix = words;
+    start = chrono::steady_clock::now();
+    ParallelSort::byFrequency(radix);
+    double radixSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    auto alphabetical = words;
+    start = chrono::steady_clock::now();
+    sort(alphabetical.begin(), alphabetical.end(),
+         [](const auto& a, const auto& b) { return a.first < b.first; });
+    double alphabeticalSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    auto msd = words;
+    start = chrono::steady_clock::now();
+    ParallelSort::alphabetically(msd);
+    double msdSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "words: " << words.size() << "\n"
+         << "frequency std::sort:    " << comparisonSeconds << " s\n"
+         << "frequency radix:        " << radixSeconds << " s (" << comparisonSeconds / radixSeconds << "x)\n"
+         << "alphabetical std::sort: " << alphabeticalSeconds << " s\n"
+         << "alphabetical MSD:       " << msdSeconds << " s (" << alphabeticalSeconds / msdSeconds << "x)\n";
+
+    bool same = comparison == radix;
+    for (size_t i = 0; same && i < msd.size(); i++) same = msd[i].first == alphabetical[i].first;
+    return same ? 0 : 1;
+}
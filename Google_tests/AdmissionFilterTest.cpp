@@ -0,0 +1,29 @@
+#include "gtest/gtest.h"
+#include "../admissionfilter.h"
+#include "../wordhashindex.h"
+#include <string>
+
+using namespace std;
+
+TEST(AdmissionFilterTest, AdmitsOnSecondSighting) {
+    AdmissionFilter filter(10000, 0.01);
+    EXPECT_GE(filter.hashCount(), 1);
+
+    size_t earlyAdmissions = 0;
+    for (int i = 0; i < 10000; i++) {
+        if (filter.admit(hashWord("once" + to_string(i)))) earlyAdmissions++;
+    }
+    EXPECT_EQ(filter.pending() + 2 * earlyAdmissions, 10000) << earlyAdmissions;
+    EXPECT_LT(earlyAdmissions, 300);
+    EXPECT_NEAR(static_cast<double>(earlyAdmissions), filter.expectedFalseAdmissions(), 100.0);
+    EXPECT_LT(filter.falsePositiveRate(), 0.03);
+
+    EXPECT_FALSE(filter.admit(hashWord("twice")));
+    EXPECT_TRUE(filter.admit(hashWord("twice")));
+    EXPECT_EQ(filter.admitted(), earlyAdmissions + 1);
+
+    filter.clear();
+    EXPECT_EQ(filter.pending(), 0);
+    EXPECT_EQ(filter.falsePositiveRate(), 0.0);
+    EXPECT_FALSE(filter.admit(hashWord("once0")));
+}
@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include "../asyncfilereader.h"
+#include <QTemporaryDir>
+#include <fstream>
+#include <set>
+
+using namespace std;
+
+class AsyncFileReaderTest : public ::testing::TestWithParam<AsyncFileReader::Backend> {
+protected:
+    QTemporaryDir dir;
+
+    string writeFile(const string& name, const string& content) {
+        string path = dir.path().toStdString() + "/" + name;
+        ofstream(path, ios::binary) << content;
+        return path;
+    }
+};
+
+TEST_P(AsyncFileReaderTest, DeliversBlocksInOrder) {
+    vector<string> contents;
+    vector<string> paths;
+    for (int i = 0; i < 12; i++) {
+        string content;
+        for (int j = 0; j < i * 900; j++) content += static_cast<char>('a' + (i * 7 + j) % 26);
+        contents.push_back(content);
+        paths.push_back(writeFile("file" + to_string(i), content));
+    }
+
+    AsyncFileReader reader(GetParam(), 4096, 3);
+    if (GetParam() != AsyncFileReader::Auto) {
+        EXPECT_EQ(reader.backend(), GetParam());
+    }
+
+    vector<string> received(paths.size());
+    vector<int> lastBlocks(paths.size(), 0);
+    set<const char*> buffers;
+    size_t expectedFile = 0;
+    ASSERT_TRUE(reader.read(paths, [&](const AsyncFileReader::Block& block) {
+        ASSERT_EQ(block.file, expectedFile);
+        ASSERT_EQ(block.offset, received[block.file].size());
+        ASSERT_FALSE(block.failed);
+        received[block.file].append(block.data ? block.data : "", block.size);
+        if (block.data) buffers.insert(block.data);
+        if (block.lastOfFile) {
+            lastBlocks[block.file]++;
+            expectedFile++;
+        }
+    }));
+
+    EXPECT_EQ(received, contents);
+    EXPECT_EQ(lastBlocks, vector<int>(paths.size(), 1));
+    EXPECT_LE(buffers.size(), 6);
+}
+
+TEST_P(AsyncFileReaderTest, ReportsMissingFilesAndContinues) {
+    vector<string> paths = {writeFile("before", "one"), dir.path().toStdString() + "/missing",
+                            writeFile("after", "two")};
+
+    AsyncFileReader reader(GetParam(), 4096, 2);
+    string received;
+    vector<bool> failed(paths.size(), false);
+    EXPECT_FALSE(reader.read(paths, [&](const AsyncFileReader::Block& block) {
+        if (block.failed) failed[block.file] = true;
+        received.append(block.data ? block.data : "", block.size);
+    }));
+
+    EXPECT_EQ(received, "onetwo");
+    EXPECT_EQ(failed, vector<bool>({false, true, false}));
+}
+
+TEST_P(AsyncFileReaderTest, HandlerExceptionStopsReading) {
+    vector<string> paths;
+    for (int i = 0; i < 20; i++) paths.push_back(writeFile("f" + to_string(i), string(10000, 'x')));
+
+    AsyncFileReader reader(GetParam(), 4096, 4);
+    size_t blocks = 0;
+    EXPECT_THROW(reader.read(paths, [&](const AsyncFileReader::Block&) {
+        if (++blocks == 5) throw runtime_error("stop");
+    }), runtime_error);
+
+    // The reader stays usable afterwards.
+    string received;
+    EXPECT_TRUE(reader.read({paths[0]}, [&](const AsyncFileReader::Block& block) {
+        received.append(block.data, block.size);
+    }));
+    EXPECT_EQ(received.size(), 10000);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, AsyncFileReaderTest,
+                         ::testing::Values(AsyncFileReader::Auto, AsyncFileReader::Pread));
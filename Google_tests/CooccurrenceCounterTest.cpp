@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "../cooccurrencecounter.h"
+#include <QTemporaryDir>
+#include <fstream>
+#include <iterator>
+
+using namespace std;
+
+class CooccurrenceCounterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(tempDir.isValid());
+    }
+
+    string path(const string& name) const {
+        return tempDir.path().toStdString() + "/" + name;
+    }
+
+    QTemporaryDir tempDir;
+};
+
+TEST_F(CooccurrenceCounterTest, CountsSymmetricWindow) {
+    CooccurrenceCounter counter(1, 2);
+    for (uint32_t id : {0u, 1u, 2u, 1u}) counter.push(id);
+
+    ASSERT_TRUE(counter.exportTriplets(path("window.cooc")));
+
+    vector<CooccurrenceCounter::Triplet> triplets;
+    ASSERT_TRUE(CooccurrenceCounter::readTriplets(path("window.cooc"), triplets));
+    ASSERT_EQ(triplets.size(), 4);
+    EXPECT_EQ(triplets[0].row, 0);
+    EXPECT_EQ(triplets[0].column, 1);
+    EXPECT_EQ(triplets[0].count, 1);
+    EXPECT_EQ(triplets[2].row, 1);
+    EXPECT_EQ(triplets[2].column, 2);
+    EXPECT_EQ(triplets[2].count, 2);
+}
+
+TEST_F(CooccurrenceCounterTest, SpilledRunsMergeIntoSameResult) {
+    CooccurrenceCounter inMemory(2, 3);
+    CooccurrenceCounter spilling(2, 3, 4, tempDir.path().toStdString());
+
+    for (int i = 0; i < 200; i++) {
+        uint32_t id = static_cast<uint32_t>((i * 7) % 11);
+        inMemory.push(id);
+        spilling.push(id);
+        if (i % 20 == 19) spilling.flush();
+    }
+    EXPECT_GT(spilling.spilledRuns(), 0);
+
+    ASSERT_TRUE(inMemory.exportTriplets(path("memory.cooc")));
+    ASSERT_TRUE(spilling.exportTriplets(path("spilled.cooc")));
+
+    vector<CooccurrenceCounter::Triplet> expected, actual;
+    ASSERT_TRUE(CooccurrenceCounter::readTriplets(path("memory.cooc"), expected));
+    ASSERT_TRUE(CooccurrenceCounter::readTriplets(path("spilled.cooc"), actual));
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(expected[i].row, actual[i].row);
+        EXPECT_EQ(expected[i].column, actual[i].column);
+        EXPECT_EQ(expected[i].count, actual[i].count);
+    }
+}
+
+TEST_F(CooccurrenceCounterTest, ExportIsLittleEndianAndCountIsChecked) {
+    CooccurrenceCounter counter(1, 2);
+    for (uint32_t id : {0u, 258u, 0u}) counter.push(id);
+    ASSERT_TRUE(counter.exportTriplets(path("layout.cooc")));
+
+    string bytes;
+    {
+        ifstream in(path("layout.cooc"), ios::binary);
+        bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    // Magic, version 1, two pairs: (0, 258, 2) and (258, 0, 2).
+    const string expected("COOC\1\0\0\0\2\0\0\0\0\0\0\0"
+                          "\0\0\0\0\2\1\0\0\2\0\0\0"
+                          "\2\1\0\0\0\0\0\0\2\0\0\0", 40);
+    EXPECT_EQ(bytes, expected);
+
+    // A count larger than the file holds is rejected before anything is allocated.
+    string inflated = bytes;
+    inflated[15] = '\x7f';
+    ofstream(path("inflated.cooc"), ios::binary) << inflated;
+    vector<CooccurrenceCounter::Triplet> triplets;
+    EXPECT_FALSE(CooccurrenceCounter::readTriplets(path("inflated.cooc"), triplets));
+
+    ofstream(path("truncated.cooc"), ios::binary) << bytes.substr(0, bytes.size() - 1);
+    EXPECT_FALSE(CooccurrenceCounter::readTriplets(path("truncated.cooc"), triplets));
+}
@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+#include "../countstatistics.h"
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <climits>
+
+using namespace std;
+
+TEST(CountStatisticsTest, MatchesSortedCountsAcrossOverflow) {
+    CountStatistics statistics(64);
+    vector<int> counts(500, 0);
+    mt19937 random(9);
+
+    for (int step = 0; step < 20000; step++) {
+        size_t word = random() % counts.size() % (1 + random() % counts.size());
+        statistics.move(counts[word], counts[word] + 1);
+        counts[word]++;
+    }
+
+    vector<int> present;
+    for (int count : counts) {
+        if (count > 0) present.push_back(count);
+    }
+    sort(present.begin(), present.end());
+    ASSERT_EQ(statistics.wordCount(), present.size());
+    ASSERT_GT(present.back(), 64);
+
+    for (int c : {0, 1, 5, 63, 64, 65, 100, 1000, 100000}) {
+        size_t expected = upper_bound(present.begin(), present.end(), c) - present.begin();
+        EXPECT_EQ(statistics.countAtMost(c), expected) << c;
+    }
+    EXPECT_EQ(statistics.countInRange(10, 100),
+              statistics.countAtMost(100) - statistics.countAtMost(9));
+    EXPECT_EQ(statistics.countInRange(100, 10), 0);
+
+    for (double q : {0.0, 0.1, 0.5, 0.9, 0.99, 1.0}) {
+        size_t k = max<size_t>(1, static_cast<size_t>(ceil(q * present.size())));
+        EXPECT_EQ(statistics.quantile(q), present[k - 1]) << q;
+    }
+
+    statistics.clear();
+    EXPECT_EQ(statistics.wordCount(), 0);
+    EXPECT_EQ(statistics.quantile(0.5), 0);
+}
+
+TEST(CountStatisticsTest, SparseOverflowCountsUpToIntMax) {
+    CountStatistics statistics(16);
+    vector<int> counts;
+    mt19937 random(3);
+
+    for (int i = 0; i < 300; i++) {
+        int count = i % 3 == 0 ? 16 + static_cast<int>(random() % 1000)
+                               : 16 + static_cast<int>(random() % (INT_MAX - 16));
+        counts.push_back(count);
+        statistics.move(0, count);
+    }
+    for (int i = 0; i < 100; i++) {
+        statistics.move(counts.back(), 0);
+        counts.pop_back();
+        statistics.move(counts[i], counts[i] + 1);
+        counts[i]++;
+    }
+    counts.push_back(INT_MAX);
+    statistics.move(0, INT_MAX);
+
+    vector<int> present = counts;
+    sort(present.begin(), present.end());
+    ASSERT_EQ(statistics.wordCount(), present.size());
+
+    for (int c : {15, 16, 17, 500, 1015, 1 << 20, present[100], present[150], INT_MAX - 1, INT_MAX}) {
+        size_t expected = upper_bound(present.begin(), present.end(), c) - present.begin();
+        EXPECT_EQ(statistics.countAtMost(c), expected) << c;
+    }
+    for (double q : {0.0, 0.25, 0.5, 0.75, 1.0}) {
+        size_t k = max<size_t>(1, static_cast<size_t>(ceil(q * present.size())));
+        EXPECT_EQ(statistics.quantile(q), present[k - 1]) << q;
+    }
+}
@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+#include "../decompressor.h"
+#include <cstring>
+#include <vector>
+
+#ifdef DICTIONARY_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef DICTIONARY_HAVE_LZMA
+#include <lzma.h>
+#endif
+
+using namespace std;
+
+static string sampleText(int lines) {
+    string text;
+    for (int i = 0; i < lines; i++) {
+        text += "line " + to_string(i) + " of the sample corpus\n";
+    }
+    return text;
+}
+
+// Feeds compressed through read() in pieces of readSize bytes.
+static bool decompressAll(Decompressor& decompressor, const string& compressed, size_t readSize, string& output) {
+    size_t position = 0;
+    auto read = [&](char* data, size_t size) -> int64_t {
+        size_t n = min({size, readSize, compressed.size() - position});
+        memcpy(data, compressed.data() + position, n);
+        position += n;
+        return static_cast<int64_t>(n);
+    };
+    return decompressor.pipeline(read, string_view(), [&](const char* data, size_t size) {
+        output.append(data, size);
+    });
+}
+
+TEST(DecompressorTest, DetectsMagicBytes) {
+    EXPECT_EQ(Decompressor::detect("\x1f\x8b\x08", 3), Decompressor::Gzip);
+    EXPECT_EQ(Decompressor::detect("\x28\xb5\x2f\xfd\x00", 5), Decompressor::Zstd);
+    EXPECT_EQ(Decompressor::detect("\xfd" "7zXZ\0\0", 7), Decompressor::Xz);
+    EXPECT_EQ(Decompressor::detect("\x1f", 1), Decompressor::Plain);
+    EXPECT_EQ(Decompressor::detect("plain text", 10), Decompressor::Plain);
+    EXPECT_EQ(Decompressor::create(Decompressor::Plain), nullptr);
+}
+
+#ifdef DICTIONARY_HAVE_ZLIB
+static string gzipCompress(const string& text) {
+    z_stream stream = {};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    string output(deflateBound(&stream, text.size()) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+    stream.avail_in = static_cast<uInt>(text.size());
+    stream.next_out = reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out = static_cast<uInt>(output.size());
+    deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return output;
+}
+
+TEST(DecompressorTest, GzipMultipleMembers) {
+    string first = sampleText(20000);
+    string second = sampleText(300);
+    string compressed = gzipCompress(first) + gzipCompress(second);
+
+    for (size_t readSize : {size_t(7), size_t(4096), compressed.size()}) {
+        auto decompressor = Decompressor::create(Decompressor::Gzip);
+        ASSERT_NE(decompressor, nullptr);
+
+        string output;
+        ASSERT_TRUE(decompressAll(*decompressor, compressed, readSize, output)) << decompressor->errorString();
+        EXPECT_EQ(output, first + second) << "readSize=" << readSize;
+    }
+}
+
+TEST(DecompressorTest, GzipReportsTruncationAndCorruption) {
+    string compressed = gzipCompress(sampleText(1000));
+
+    auto truncated = Decompressor::create(Decompressor::Gzip);
+    string output;
+    EXPECT_FALSE(decompressAll(*truncated, compressed.substr(0, compressed.size() / 2), 512, output));
+
+    string corrupt = compressed;
+    for (size_t i = 20; i < 60; i++) corrupt[i] = static_cast<char>(0xff);
+    auto damaged = Decompressor::create(Decompressor::Gzip);
+    output.clear();
+    EXPECT_FALSE(decompressAll(*damaged, corrupt, 512, output));
+    EXPECT_FALSE(damaged->errorString().empty());
+}
+
+TEST(DecompressorTest, HandlerExceptionStopsDecompression) {
+    string compressed = gzipCompress(sampleText(100000));
+    auto decompressor = Decompressor::create(Decompressor::Gzip);
+
+    size_t position = 0;
+    auto read = [&](char* data, size_t size) -> int64_t {
+        size_t n = min(size, compressed.size() - position);
+        memcpy(data, compressed.data() + position, n);
+        position += n;
+        return static_cast<int64_t>(n);
+    };
+    EXPECT_THROW(decompressor->pipeline(read, string_view(), [](const char*, size_t) {
+        throw runtime_error("stop");
+    }), runtime_error);
+}
+#endif
+
+#ifdef DICTIONARY_HAVE_LZMA
+TEST(DecompressorTest, XzConcatenatedStreams) {
+    string text = sampleText(5000);
+    string compressed;
+    for (int i = 0; i < 2; i++) {
+        vector<uint8_t> buffer(lzma_stream_buffer_bound(text.size()));
+        size_t size = 0;
+        ASSERT_EQ(lzma_easy_buffer_encode(6, LZMA_CHECK_CRC64, nullptr,
+                                          reinterpret_cast<const uint8_t*>(text.data()), text.size(),
+                                          buffer.data(), &size, buffer.size()), LZMA_OK);
+        compressed.append(reinterpret_cast<const char*>(buffer.data()), size);
+    }
+
+    auto decompressor = Decompressor::create(Decompressor::Xz);
+    ASSERT_NE(decompressor, nullptr);
+
+    string output;
+    ASSERT_TRUE(decompressAll(*decompressor, compressed, 1000, output)) << decompressor->errorString();
+    EXPECT_EQ(output, text + text);
+}
+#endif
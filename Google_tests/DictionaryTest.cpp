@@ -3,6 +3,13 @@
 #include <fstream>
 #include <QTemporaryFile>
 #include <QTemporaryDir>
+#include <thread>
+#include <filesystem>
+#include <unistd.h>
+
+#ifdef DICTIONARY_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 class DictionaryTest : public ::testing::Test {
 protected:
@@ -163,4 +170,1022 @@ TEST_F(DictionaryTest, EmptyString) {
 TEST_F(DictionaryTest, OnlySymbols) {
     dict->addWord("!@#$%^&*()");
     EXPECT_EQ(dict->size(), 0);
-} 
\ No newline at end of file
+} 
+TEST_F(DictionaryTest, SearchSubstring) {
+    dict->addWord("telephone");
+    dict->addWord("television");
+    dict->addWord("television");
+    dict->addWord("hotel");
+    dict->addWord("phone");
+
+    auto words = dict->search("tele");
+    ASSERT_EQ(words.size(), 2);
+    EXPECT_EQ(words[0].first, "telephone");
+    EXPECT_EQ(words[1].first, "television");
+    EXPECT_EQ(words[1].second, 2);
+
+    EXPECT_EQ(dict->search("TEL").size(), 3);
+    EXPECT_EQ(dict->search("el").size(), 3);
+    EXPECT_TRUE(dict->search("missing").empty());
+}
+
+TEST_F(DictionaryTest, SearchSubstringLowercasesCyrillic) {
+    dict->addWord("Телефон");
+    dict->addWord("телевизор");
+    dict->addWord("Отель");
+    dict->addWord("Ёлка");
+
+    EXPECT_EQ(dict->search("ТЕЛ").size(), 3);
+    auto words = dict->search("ТЕЛЕ");
+    ASSERT_EQ(words.size(), 2);
+    EXPECT_EQ(words[0].first, "телевизор");
+    EXPECT_EQ(words[1].first, "телефон");
+    EXPECT_EQ(dict->search("ЁЛ").size(), 1);
+    // Non-letters stay in the literal instead of being dropped.
+    EXPECT_TRUE(dict->search("ТЕЛ-").empty());
+}
+
+TEST_F(DictionaryTest, SearchRegex) {
+    dict->addWord("telephone");
+    dict->addWord("television");
+    dict->addWord("hotel");
+    dict->addWord("phone");
+
+    auto words = dict->search("^tele.*n$", Dictionary::Regex);
+    ASSERT_EQ(words.size(), 1);
+    EXPECT_EQ(words[0].first, "television");
+
+    EXPECT_EQ(dict->search("o(n|t)e", Dictionary::Regex).size(), 3);
+    EXPECT_TRUE(dict->search("([", Dictionary::Regex).empty());
+
+    dict->clear();
+    dict->addWord("phone");
+    EXPECT_EQ(dict->search("phone").size(), 1);
+}
+
+TEST_F(DictionaryTest, FuzzyLookupRanksByDistanceThenFrequency) {
+    for (int i = 0; i < 5; i++) dict->addWord("house");
+    for (int i = 0; i < 3; i++) dict->addWord("horse");
+    dict->addWord("hose");
+    dict->addWord("mouse");
+    dict->addWord("houses");
+    dict->addWord("elephant");
+
+    dict->enableFuzzyIndex(2);
+    EXPECT_TRUE(dict->isFuzzyIndexEnabled());
+    EXPECT_GT(dict->fuzzyIndexMemoryUsage(), 0);
+
+    auto matches = dict->fuzzyLookup("hause", 1);
+    ASSERT_EQ(matches.size(), 1);
+    EXPECT_EQ(matches[0].word, "house");
+
+    matches = dict->fuzzyLookup("hose", 2);
+    ASSERT_EQ(matches.size(), 5);
+    EXPECT_EQ(matches[0].word, "hose");
+    EXPECT_EQ(matches[0].distance, 0);
+    EXPECT_EQ(matches[1].word, "house");
+    EXPECT_EQ(matches[2].word, "horse");
+    EXPECT_EQ(matches[3].word, "houses");
+    EXPECT_EQ(matches[4].word, "mouse");
+
+    dict->addWord("hosue");
+    matches = dict->fuzzyLookup("house", 1);
+    ASSERT_EQ(matches.size(), 6);
+    EXPECT_EQ(matches[0].word, "house");
+    EXPECT_EQ(matches[1].word, "horse");
+    EXPECT_EQ(matches[3].word, "hosue");
+}
+
+TEST_F(DictionaryTest, FuzzyLookupWithoutIndexScans) {
+    dict->addWord("house");
+    dict->addWord("mouse");
+    dict->addWord("elephant");
+
+    auto matches = dict->fuzzyLookup("house", 1);
+    ASSERT_EQ(matches.size(), 2);
+    EXPECT_EQ(matches[0].word, "house");
+    EXPECT_EQ(matches[1].word, "mouse");
+}
+
+TEST_F(DictionaryTest, NGramCounting) {
+    dict->setNGramOrder(3);
+    EXPECT_EQ(dict->nGramOrder(), 3);
+
+    QString filePath = createTempTextFile("the cat sat\non the cat mat\nthe cat sat");
+    ASSERT_TRUE(dict->addWordsFromFile(filePath));
+
+    auto bigrams = dict->getNGramsByFrequency(2);
+    ASSERT_FALSE(bigrams.empty());
+    EXPECT_EQ(bigrams[0].first, "the cat");
+    EXPECT_EQ(bigrams[0].second, 3);
+    EXPECT_EQ(dict->nGramCount(2), 6);
+
+    auto trigrams = dict->getNGramsAlphabetically(3);
+    EXPECT_EQ(trigrams.size(), 7);
+    EXPECT_EQ(trigrams[0].first, "cat mat the");
+    EXPECT_EQ(trigrams[0].second, 1);
+
+    QString savePath = tempDir->path() + "/bigrams.dict";
+    ASSERT_TRUE(dict->saveNGramsToFile(savePath, 2));
+    QFile saved(savePath);
+    ASSERT_TRUE(saved.open(QIODevice::ReadOnly | QIODevice::Text));
+    QTextStream in(&saved);
+    EXPECT_EQ(in.readLine().toStdString(), "cat mat 1");
+}
+
+TEST_F(DictionaryTest, NGramsDoNotSpanFiles) {
+    dict->setNGramOrder(2);
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile("alpha beta")));
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile("gamma")));
+
+    auto bigrams = dict->getNGramsAlphabetically(2);
+    ASSERT_EQ(bigrams.size(), 1);
+    EXPECT_EQ(bigrams[0].first, "alpha beta");
+}
+
+TEST_F(DictionaryTest, ExportCooccurrences) {
+    dict->enableCooccurrence(2, 2);
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile("red green blue\nred green")));
+
+    QString exportPath = tempDir->path() + "/pairs.cooc";
+    ASSERT_TRUE(dict->exportCooccurrences(exportPath));
+
+    vector<CooccurrenceCounter::Triplet> triplets;
+    ASSERT_TRUE(CooccurrenceCounter::readTriplets(exportPath.toStdString(), triplets));
+    EXPECT_EQ(triplets.size(), 6);
+
+    QFile vocab(exportPath + ".vocab");
+    ASSERT_TRUE(vocab.open(QIODevice::ReadOnly | QIODevice::Text));
+    QTextStream in(&vocab);
+    EXPECT_EQ(in.readLine().toStdString(), "red 2");
+}
+
+TEST_F(DictionaryTest, DocumentIndexAndTfIdf) {
+    dict->enableDocumentIndex();
+
+    QString first = tempDir->path() + "/first.txt";
+    QString second = tempDir->path() + "/second.txt";
+    QFile::rename(createTempTextFile("apple banana apple"), first);
+    QFile::rename(createTempTextFile("banana cherry"), second);
+    ASSERT_TRUE(dict->addWordsFromFile(first));
+    ASSERT_TRUE(dict->addWordsFromFile(second));
+
+    EXPECT_EQ(dict->documentCount(), 2);
+    EXPECT_EQ(dict->documentFrequency("banana"), 2);
+    EXPECT_EQ(dict->documentFrequency("apple"), 1);
+    EXPECT_EQ(dict->documentFrequency("missing"), 0);
+
+    auto it = dict->postings("apple");
+    ASSERT_TRUE(it.next());
+    EXPECT_EQ(it.document(), 0);
+    EXPECT_EQ(it.frequency(), 2);
+    EXPECT_FALSE(it.next());
+
+    auto ranking = dict->rankDocuments("cherry apple");
+    ASSERT_EQ(ranking.size(), 2);
+    EXPECT_EQ(QFileInfo(QString::fromStdString(ranking[0].first)).fileName().toStdString(), "first.txt");
+}
+
+TEST_F(DictionaryTest, DocumentIndexPersistsWithDictionary) {
+    dict->enableDocumentIndex();
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile("zeta alpha zeta")));
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile("alpha beta")));
+
+    QString dictPath = tempDir->path() + "/indexed.dict";
+    ASSERT_TRUE(dict->saveToFile(dictPath));
+    EXPECT_TRUE(QFile::exists(dictPath + ".idx"));
+
+    Dictionary loaded;
+    ASSERT_TRUE(loaded.loadFromFile(dictPath));
+    ASSERT_TRUE(loaded.isDocumentIndexEnabled());
+    EXPECT_EQ(loaded.documentCount(), 2);
+    EXPECT_EQ(loaded.documentFrequency("alpha"), 2);
+    EXPECT_EQ(loaded.documentFrequency("zeta"), 1);
+
+    auto it = loaded.postings("zeta");
+    ASSERT_TRUE(it.next());
+    EXPECT_EQ(it.frequency(), 2);
+
+    ASSERT_TRUE(loaded.addWordsFromFile(createTempTextFile("zeta")));
+    EXPECT_EQ(loaded.documentFrequency("zeta"), 2);
+}
+
+TEST_F(DictionaryTest, SavingOverMappedIndexKeepsItIntact) {
+    dict->enableDocumentIndex();
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile("gamma delta")));
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile("gamma epsilon")));
+    QString dictPath = tempDir->path() + "/resaved.dict";
+    ASSERT_TRUE(dict->saveToFile(dictPath));
+
+    Dictionary loaded;
+    ASSERT_TRUE(loaded.loadFromFile(dictPath));
+    // New words shift every row of the file written next.
+    for (int i = 0; i < 50; i++) {
+        loaded.addWord("aaa" + to_string(i));
+    }
+    ASSERT_TRUE(loaded.saveToFile(dictPath));
+
+    EXPECT_EQ(loaded.documentFrequency("gamma"), 2);
+    EXPECT_EQ(loaded.rankDocuments("epsilon").size(), 1);
+
+    Dictionary reloaded;
+    ASSERT_TRUE(reloaded.loadFromFile(dictPath));
+    EXPECT_EQ(reloaded.documentFrequency("gamma"), 2);
+    EXPECT_EQ(reloaded.documentFrequency("epsilon"), 1);
+}
+
+TEST_F(DictionaryTest, IndexIsMatchedToTheSavedCounts) {
+    dict->enableDocumentIndex();
+    // Enough words that the dictionary is written and hashed in several blocks.
+    for (int i = 0; i < 100000; i++) {
+        dict->addWord("word" + to_string(i));
+    }
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile("gamma delta")));
+    QString dictPath = tempDir->path() + "/checkpointed.dict";
+    QString indexPath = dictPath + ".idx";
+    ASSERT_TRUE(dict->saveToFile(dictPath));
+    ASSERT_TRUE(QFile::copy(indexPath, indexPath + ".old"));
+
+    // Same vocabulary, new counts: only the checkpoint tells the indexes apart.
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile("delta gamma gamma")));
+    ASSERT_TRUE(dict->saveToFile(dictPath));
+
+    // A crash after the dictionary rename leaves the new index aside and
+    // the old one in place.
+    ASSERT_TRUE(QFile::rename(indexPath, indexPath + ".tmp"));
+    ASSERT_TRUE(QFile::copy(indexPath + ".old", indexPath));
+    Dictionary interrupted;
+    ASSERT_TRUE(interrupted.loadFromFile(dictPath));
+    EXPECT_EQ(interrupted.documentCount(), 2);
+    EXPECT_EQ(interrupted.documentFrequency("gamma"), 2);
+
+    // Without it, the old index does not match the counts and is ignored.
+    ASSERT_TRUE(QFile::remove(indexPath + ".tmp"));
+    Dictionary stale;
+    ASSERT_TRUE(stale.loadFromFile(dictPath));
+    EXPECT_EQ(stale.count("gamma"), 3);
+    EXPECT_EQ(stale.documentCount(), 0);
+}
+
+TEST_F(DictionaryTest, CorruptIndexOffsetsAreRejected) {
+    dict->enableDocumentIndex();
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile("gamma delta")));
+    QString dictPath = tempDir->path() + "/corrupt.dict";
+    ASSERT_TRUE(dict->saveToFile(dictPath));
+
+    // Point the second posting row far past the end of the file.
+    fstream index((dictPath + ".idx").toStdString(), ios::binary | ios::in | ios::out);
+    uint64_t offsetsOffset = 0;
+    index.seekg(32);
+    index.read(reinterpret_cast<char*>(&offsetsOffset), sizeof(offsetsOffset));
+    uint64_t bogus = 1ull << 40;
+    index.seekp(static_cast<streamoff>(offsetsOffset + sizeof(uint64_t)));
+    index.write(reinterpret_cast<const char*>(&bogus), sizeof(bogus));
+    index.close();
+
+    Dictionary loaded;
+    ASSERT_TRUE(loaded.loadFromFile(dictPath));
+    EXPECT_EQ(loaded.count("gamma"), 1);
+    EXPECT_EQ(loaded.documentFrequency("gamma"), 0);
+}
+
+TEST_F(DictionaryTest, CorruptPostingDocumentsAreSkipped) {
+    dict->enableDocumentIndex();
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile("gamma delta")));
+    QString dictPath = tempDir->path() + "/corrupt-postings.dict";
+    ASSERT_TRUE(dict->saveToFile(dictPath));
+
+    // Each row is a single (document 0, frequency 1) pair; point them all at
+    // a document that does not exist.
+    fstream index((dictPath + ".idx").toStdString(), ios::binary | ios::in | ios::out);
+    uint64_t postingsOffset = 0;
+    index.seekg(40);
+    index.read(reinterpret_cast<char*>(&postingsOffset), sizeof(postingsOffset));
+    for (int row = 0; row < 2; row++) {
+        index.seekp(static_cast<streamoff>(postingsOffset + row * 2));
+        index.put(5);
+    }
+    index.close();
+
+    Dictionary loaded;
+    ASSERT_TRUE(loaded.loadFromFile(dictPath));
+    EXPECT_EQ(loaded.documentCount(), 1);
+    EXPECT_TRUE(loaded.rankDocuments("gamma delta").empty());
+    EXPECT_FALSE(loaded.postings("gamma").next());
+}
+
+TEST_F(DictionaryTest, CountManyMatchesCount) {
+    for (int i = 0; i < 3000; i++) {
+        dict->addWord("w" + to_string(i % 1000));
+    }
+
+    vector<string> storage;
+    for (int i = 0; i < 100; i++) {
+        storage.push_back("w" + to_string(i * 13 % 1100));
+    }
+    vector<string_view> words(storage.begin(), storage.end());
+    vector<uint64_t> counts(words.size());
+
+    dict->countMany(words, counts);
+    for (size_t i = 0; i < words.size(); i++) {
+        EXPECT_EQ(counts[i], static_cast<uint64_t>(dict->count(words[i]))) << storage[i];
+    }
+    EXPECT_EQ(dict->count("w5"), 3);
+    EXPECT_EQ(dict->count("w1050"), 0);
+}
+
+TEST_F(DictionaryTest, SortedViewsAreCachedUntilModified) {
+    for (const char* word : {"pear", "apple", "fig", "apple", "pear", "apple"}) {
+        dict->addWord(word);
+    }
+
+    uint64_t version = dict->version();
+    auto alphabetical = dict->words(Dictionary::Alphabetical);
+    ASSERT_EQ(alphabetical.size(), 3);
+    EXPECT_EQ(alphabetical[0], make_pair(string_view("apple"), 3));
+    EXPECT_EQ(alphabetical[2], make_pair(string_view("pear"), 2));
+
+    auto frequency = dict->words(Dictionary::ByFrequency);
+    vector<string> ordered;
+    for (const auto& [word, count] : frequency) {
+        ordered.emplace_back(word);
+    }
+    EXPECT_EQ(ordered, (vector<string>{"apple", "pear", "fig"}));
+
+    EXPECT_EQ(dict->words(Dictionary::ByFrequency)[0].first.data(), frequency[0].first.data());
+    EXPECT_EQ(dict->version(), version);
+
+    dict->addWord("fig");
+    dict->addWord("fig");
+    dict->addWord("fig");
+    EXPECT_GT(dict->version(), version);
+    EXPECT_EQ(dict->words(Dictionary::ByFrequency)[0], make_pair(string_view("fig"), 4));
+
+    vector<pair<string, int>> copied = dict->getWordsByFrequency();
+    ASSERT_EQ(copied.size(), 3);
+    EXPECT_EQ(copied[1], make_pair(string("apple"), 3));
+}
+
+TEST_F(DictionaryTest, RankQuantileAndCountRange) {
+    const vector<pair<string, int>> words = {{"one", 1}, {"two", 2}, {"three", 3}, {"many", 10}, {"more", 10}};
+    for (const auto& [word, count] : words) {
+        for (int i = 0; i < count; i++) dict->addWord(word);
+    }
+
+    EXPECT_EQ(dict->rank("many"), 1);
+    EXPECT_EQ(dict->rank("more"), 1);
+    EXPECT_EQ(dict->rank("three"), 3);
+    EXPECT_EQ(dict->rank("One"), 5);
+    EXPECT_EQ(dict->rank("absent"), 0);
+
+    EXPECT_EQ(dict->frequencyQuantile(0.5), 3);
+    EXPECT_EQ(dict->frequencyQuantile(0.9), 10);
+    EXPECT_EQ(dict->countWordsInRange(2), 4);
+    EXPECT_EQ(dict->countWordsInRange(2, 3), 2);
+
+    auto filtered = dict->wordsInCountRange(2, 3);
+    ASSERT_EQ(filtered.size(), 2);
+    EXPECT_EQ(filtered[0], make_pair(string_view("three"), 3));
+    EXPECT_EQ(filtered[1], make_pair(string_view("two"), 2));
+
+    QString filePath = tempDir->path() + "/ranked.dict";
+    ASSERT_TRUE(dict->saveToFile(filePath));
+    Dictionary loaded;
+    ASSERT_TRUE(loaded.loadFromFile(filePath));
+    EXPECT_EQ(loaded.rank("three"), 3);
+    EXPECT_EQ(loaded.countWordsInRange(10), 2);
+}
+
+TEST_F(DictionaryTest, RangePagesAndCursorsStream) {
+    for (int i = 0; i < 250; i++) {
+        for (int j = 0; j <= i % 7; j++) {
+            dict->addWord("word" + to_string(1000 + i));
+        }
+    }
+    auto byFrequency = dict->getWordsByFrequency();
+    auto alphabetical = dict->getWordsAlphabetically();
+
+    auto page = dict->range(Dictionary::ByFrequency, 100, 30);
+    ASSERT_EQ(page.size(), 30);
+    for (size_t i = 0; i < page.size(); i++) {
+        EXPECT_EQ(page[i].first, byFrequency[100 + i].first);
+    }
+    EXPECT_EQ(dict->range(Dictionary::Alphabetical, 240, 30).size(), 10);
+    EXPECT_EQ(dict->range(Dictionary::Alphabetical, 400, 30).size(), 0);
+
+    for (auto order : {Dictionary::Alphabetical, Dictionary::ByFrequency}) {
+        const auto& expected = order == Dictionary::Alphabetical ? alphabetical : byFrequency;
+        auto cursor = dict->cursor(order, 5);
+        size_t seen = 0;
+        while (cursor.next()) {
+            ASSERT_EQ(cursor.position(), 5 + seen);
+            ASSERT_EQ(cursor.word(), expected[5 + seen].first);
+            ASSERT_EQ(cursor.count(), expected[5 + seen].second);
+            seen++;
+        }
+        EXPECT_EQ(seen, expected.size() - 5);
+        EXPECT_FALSE(cursor.next());
+    }
+}
+
+TEST_F(DictionaryTest, VocabularyLimitEvictsRareWords) {
+    ASSERT_TRUE(dict->setVocabularyLimit(100));
+    EXPECT_FALSE(dict->enableCooccurrence(2));
+    dict->setNGramOrder(2);
+
+    QString text;
+    uint64_t tokens = 0;
+    for (int i = 0; i < 2000; i++) {
+        text += "common" + QString::number(i % 10) + " rare" + QString::number(i) + " ";
+        tokens += 2;
+    }
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile(text)));
+    for (int i = 0; i < 500; i++) {
+        dict->addWord("single" + to_string(i));
+        tokens++;
+        ASSERT_LE(dict->size(), 100);
+    }
+
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(dict->count("common" + to_string(i)), 200);
+    }
+    EXPECT_EQ(dict->count("rare5"), 0);
+
+    uint64_t kept = 0;
+    for (const auto& [word, count] : dict->words(Dictionary::Alphabetical)) {
+        kept += count;
+        EXPECT_EQ(dict->count(word), count);
+    }
+    EXPECT_EQ(kept + dict->otherCount(), tokens);
+
+    auto statistics = dict->pruningStatistics();
+    EXPECT_GT(statistics.passes, 0);
+    EXPECT_GE(statistics.minCount, 1);
+    EXPECT_EQ(statistics.evictedOccurrences, dict->otherCount());
+
+    for (const auto& [bigram, count] : dict->getNGramsByFrequency(2)) {
+        EXPECT_EQ(bigram.rfind("common", 0), 0) << bigram;
+    }
+
+    dict->clear();
+    EXPECT_EQ(dict->otherCount(), 0);
+    ASSERT_TRUE(dict->setVocabularyLimit(0));
+    EXPECT_TRUE(dict->enableCooccurrence(2));
+    EXPECT_FALSE(dict->setVocabularyLimit(10));
+}
+
+TEST_F(DictionaryTest, AdmissionFilterSkipsSingletons) {
+    dict->enableAdmissionFilter(1000);
+
+    QString text;
+    for (int i = 0; i < 500; i++) {
+        text += "unique" + QString::number(i) + " ";
+    }
+    for (int i = 0; i < 30; i++) {
+        text += "repeated" + QString::number(i % 3) + " ";
+    }
+    ASSERT_TRUE(dict->addWordsFromFile(createTempTextFile(text)));
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(dict->count("repeated" + to_string(i)), 10);
+    }
+    EXPECT_LT(dict->size(), 3 + 25);
+
+    dict->addWord("late");
+    EXPECT_EQ(dict->count("late"), 0);
+    dict->addWord("late");
+    EXPECT_EQ(dict->count("late"), 2);
+
+    auto statistics = dict->admissionStatistics();
+    EXPECT_GT(statistics.pendingWords, 470);
+    EXPECT_GT(statistics.filterBytes, 0);
+    EXPECT_GT(statistics.falsePositiveRate, 0.0);
+
+    dict->disableAdmissionFilter();
+    dict->addWord("direct");
+    EXPECT_EQ(dict->count("direct"), 1);
+}
+
+TEST_F(DictionaryTest, StreamsFromPipe) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+
+    // Written in small pieces so that words are split between reads.
+    thread writer([fd = fds[1]]() {
+        string text;
+        for (int i = 0; i < 2000; i++) {
+            text += (i % 2 ? "stream\r\n" : "pipe ");
+        }
+        for (size_t i = 0; i < text.size(); i += 7) {
+            size_t n = min<size_t>(7, text.size() - i);
+            if (write(fd, text.data() + i, n) != static_cast<ssize_t>(n)) {
+                break;
+            }
+        }
+        close(fd);
+    });
+
+    bool ok = dict->addWordsFromFileDescriptor(fds[0], "<pipe>");
+    writer.join();
+    close(fds[0]);
+
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(dict->size(), 2);
+    EXPECT_EQ(dict->count("pipe"), 1000);
+    EXPECT_EQ(dict->count("stream"), 1000);
+}
+
+TEST_F(DictionaryTest, LargeFileGoesThroughPipeline) {
+    QString filePath = tempDir->path() + "/large.txt";
+    {
+        ofstream out(filePath.toStdString());
+        for (int i = 0; i < 300000; i++) {
+            out << (i % 3 ? "Pipeline " : "stage\n");
+        }
+    }
+
+    ASSERT_TRUE(dict->addWordsFromFile(filePath));
+    EXPECT_EQ(dict->size(), 2);
+    EXPECT_EQ(dict->count("pipeline"), 200000);
+    EXPECT_EQ(dict->count("stage"), 100000);
+
+    const IngestPipeline::Statistics& stats = dict->lastIngestStatistics();
+    EXPECT_EQ(stats.tokens, 300000);
+    EXPECT_EQ(stats.bytes, 200000 * 9 + 100000 * 6);
+    EXPECT_GT(stats.reader.items, 1);
+    EXPECT_EQ(stats.counter.items, stats.reader.items);
+}
+
+#ifdef DICTIONARY_HAVE_ZLIB
+TEST_F(DictionaryTest, ReadsGzipCompressedFile) {
+    QString filePath = tempDir->path() + "/corpus.txt.gz";
+    gzFile out = gzopen(filePath.toStdString().c_str(), "wb");
+    ASSERT_NE(out, nullptr);
+    for (int i = 0; i < 50000; i++) {
+        gzputs(out, i % 5 ? "common words\n" : "rare\n");
+    }
+    gzclose(out);
+
+    ASSERT_TRUE(dict->addWordsFromFile(filePath));
+    EXPECT_EQ(dict->count("common"), 40000);
+    EXPECT_EQ(dict->count("words"), 40000);
+    EXPECT_EQ(dict->count("rare"), 10000);
+    EXPECT_EQ(dict->size(), 3);
+}
+TEST_F(DictionaryTest, DetectsGzipFromPipeWithShortFirstRead) {
+    QString filePath = tempDir->path() + "/piped.txt.gz";
+    gzFile out = gzopen(filePath.toStdString().c_str(), "wb");
+    ASSERT_NE(out, nullptr);
+    for (int i = 0; i < 20000; i++) {
+        gzputs(out, "hello world\n");
+    }
+    gzclose(out);
+    string compressed;
+    {
+        ifstream in(filePath.toStdString(), ios::binary);
+        compressed.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    // The reader sees a single byte of the magic before the rest arrives.
+    thread writer([fd = fds[1], &compressed]() {
+        if (write(fd, compressed.data(), 1) == 1) {
+            this_thread::sleep_for(chrono::milliseconds(50));
+            size_t rest = compressed.size() - 1;
+            if (write(fd, compressed.data() + 1, rest) != static_cast<ssize_t>(rest)) {
+                ADD_FAILURE() << "short write to pipe";
+            }
+        }
+        close(fd);
+    });
+
+    bool ok = dict->addWordsFromFileDescriptor(fds[0], "<gzip pipe>");
+    writer.join();
+    close(fds[0]);
+
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(dict->size(), 2);
+    EXPECT_EQ(dict->count("hello"), 20000);
+    EXPECT_EQ(dict->count("world"), 20000);
+}
+
+TEST_F(DictionaryTest, DirectoryIngestDecompressesFiles) {
+    QString root = tempDir->path() + "/mixed";
+    filesystem::create_directories(root.toStdString());
+    gzFile out = gzopen((root + "/hello.log.gz").toStdString().c_str(), "wb");
+    ASSERT_NE(out, nullptr);
+    for (int i = 0; i < 20000; i++) {
+        gzputs(out, "hello world\n");
+    }
+    gzclose(out);
+    ofstream(root.toStdString() + "/plain.txt", ios::binary) << "hello plain\n";
+
+    vector<FileScheduler::Progress> reports;
+    ASSERT_TRUE(dict->addWordsFromDirectory(root, "*", true,
+                                            [&](const FileScheduler::Progress& progress) { reports.push_back(progress); }));
+    EXPECT_EQ(dict->size(), 3);
+    EXPECT_EQ(dict->count("hello"), 20001);
+    EXPECT_EQ(dict->count("world"), 20000);
+    EXPECT_EQ(dict->count("plain"), 1);
+    ASSERT_FALSE(reports.empty());
+    EXPECT_EQ(reports.back().filesDone, 2);
+    EXPECT_EQ(reports.back().fileCount, 2);
+}
+
+TEST_F(DictionaryTest, DirectoryIngestCachesCompressedFiles) {
+    QString root = tempDir->path() + "/compressed";
+    QString cache = tempDir->path() + "/compressed-cache";
+    filesystem::create_directories(root.toStdString());
+    string gzPath = root.toStdString() + "/hello.log.gz";
+    gzFile out = gzopen(gzPath.c_str(), "wb");
+    ASSERT_NE(out, nullptr);
+    for (int i = 0; i < 5000; i++) {
+        gzputs(out, "hello world\n");
+    }
+    gzclose(out);
+    ofstream(root.toStdString() + "/plain.txt", ios::binary) << "hello plain\n";
+
+    Dictionary first;
+    ASSERT_TRUE(first.setIngestCache(cache));
+    ASSERT_TRUE(first.addWordsFromDirectory(root, "*", true, nullptr, 2));
+    EXPECT_EQ(first.count("hello"), 5001);
+    EXPECT_EQ(distance(filesystem::directory_iterator(cache.toStdString()), filesystem::directory_iterator()), 2);
+
+    // Garbage of the same size and time is only readable from the cache.
+    auto gzTime = filesystem::last_write_time(gzPath);
+    uintmax_t gzSize = filesystem::file_size(gzPath);
+    ofstream(gzPath, ios::binary) << string(gzSize, 'x');
+    filesystem::last_write_time(gzPath, gzTime);
+
+    Dictionary second;
+    ASSERT_TRUE(second.setIngestCache(cache));
+    ASSERT_TRUE(second.addWordsFromDirectory(root, "*", true, nullptr, 2));
+    EXPECT_EQ(second.count("hello"), 5001);
+    EXPECT_EQ(second.count("world"), 5000);
+}
+
+#endif
+
+TEST_F(DictionaryTest, FollowModeResumesWithoutDoubleCounting) {
+    string logPath = tempDir->path().toStdString() + "/service.log";
+    auto append = [&](const string& text) {
+        ofstream out(logPath, ios::binary | ios::app);
+        out << text;
+    };
+
+    append("error timeout\nerror ret");
+    ASSERT_TRUE(dict->followFile(QString::fromStdString(logPath)));
+    EXPECT_EQ(dict->count("error"), 1);
+    EXPECT_EQ(dict->count("ret"), 0);
+
+    append("ry\n");
+    EXPECT_EQ(dict->pollFollowedFiles(), 12);
+    EXPECT_EQ(dict->count("error"), 2);
+    EXPECT_EQ(dict->count("retry"), 1);
+    EXPECT_EQ(dict->pollFollowedFiles(), 0);
+
+    QString dictPath = tempDir->path() + "/live.dict";
+    ASSERT_TRUE(dict->saveToFile(dictPath));
+    append("timeout\n");
+
+    Dictionary restarted;
+    ASSERT_TRUE(restarted.loadFromFile(dictPath));
+    EXPECT_EQ(restarted.followedFiles().size(), 1);
+    restarted.pollFollowedFiles();
+    EXPECT_EQ(restarted.count("error"), 2);
+    EXPECT_EQ(restarted.count("timeout"), 2);
+
+    restarted.clear();
+    EXPECT_TRUE(restarted.followedFiles().empty());
+}
+
+TEST_F(DictionaryTest, FollowStateMatchesDictionaryAfterInterruptedSave) {
+    string logPath = tempDir->path().toStdString() + "/app.log";
+    auto append = [&](const string& text) {
+        ofstream out(logPath, ios::binary | ios::app);
+        out << text;
+    };
+    auto readFile = [](const QString& path) {
+        ifstream in(path.toStdString(), ios::binary);
+        return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    };
+    auto writeFile = [](const QString& path, const string& text) {
+        ofstream(path.toStdString(), ios::binary) << text;
+    };
+
+    append("start\n");
+    ASSERT_TRUE(dict->followFile(QString::fromStdString(logPath)));
+    QString dictPath = tempDir->path() + "/live.dict";
+    ASSERT_TRUE(dict->saveToFile(dictPath));
+    EXPECT_FALSE(QFile::exists(dictPath + ".tmp"));
+    EXPECT_FALSE(QFile::exists(dictPath + ".follow.tmp"));
+    string oldDictionary = readFile(dictPath);
+    string oldState = readFile(dictPath + ".follow");
+
+    append("more\n");
+    dict->pollFollowedFiles();
+    QString nextPath = tempDir->path() + "/next.dict";
+    ASSERT_TRUE(dict->saveToFile(nextPath));
+    string newDictionary = readFile(nextPath);
+    string newState = readFile(nextPath + ".follow");
+    append("last\n");
+
+    // Killed after the dictionary was renamed into place, before the state.
+    writeFile(dictPath, newDictionary);
+    writeFile(dictPath + ".follow", oldState);
+    writeFile(dictPath + ".follow.tmp", newState);
+    Dictionary afterCommit;
+    ASSERT_TRUE(afterCommit.loadFromFile(dictPath));
+    afterCommit.pollFollowedFiles();
+    EXPECT_EQ(afterCommit.count("start"), 1);
+    EXPECT_EQ(afterCommit.count("more"), 1);
+    EXPECT_EQ(afterCommit.count("last"), 1);
+
+    // Killed before the dictionary was renamed: the new state is stale.
+    writeFile(dictPath, oldDictionary);
+    Dictionary beforeCommit;
+    ASSERT_TRUE(beforeCommit.loadFromFile(dictPath));
+    beforeCommit.pollFollowedFiles();
+    EXPECT_EQ(beforeCommit.count("start"), 1);
+    EXPECT_EQ(beforeCommit.count("more"), 1);
+    EXPECT_EQ(beforeCommit.count("last"), 1);
+}
+
+TEST_F(DictionaryTest, DirectoryIngestMatchesSerialReading) {
+    QString root = tempDir->path() + "/corpus";
+    vector<string> files;
+    for (int i = 0; i < 30; i++) {
+        string path = root.toStdString() + "/part" + to_string(i / 10) + "/doc" + to_string(i) + ".txt";
+        filesystem::create_directories(filesystem::path(path).parent_path());
+        ofstream out(path);
+        for (int j = 0; j <= i * 50; j++) {
+            out << "Word" << (j * 7 + i) % 41 << (j % 9 ? ' ' : '\n');
+        }
+        files.push_back(path);
+    }
+    ofstream(root.toStdString() + "/ignored.bin") << "binary blob";
+
+    Dictionary serial;
+    for (const string& path : files) {
+        ASSERT_TRUE(serial.addWordsFromFile(QString::fromStdString(path)));
+    }
+
+    for (int threads : {1, 4}) {
+        Dictionary parallel;
+        size_t lastFilesDone = 0;
+        ASSERT_TRUE(parallel.addWordsFromDirectory(root, "*.txt", true,
+            [&](const FileScheduler::Progress& progress) { lastFilesDone = progress.filesDone; }, threads));
+
+        EXPECT_EQ(lastFilesDone, files.size());
+        EXPECT_EQ(parallel.getWordsAlphabetically(), serial.getWordsAlphabetically()) << "threads=" << threads;
+        EXPECT_EQ(parallel.count("binary"), 0);
+    }
+
+    // Order-dependent features fall back to reading file by file, still
+    // reporting each file as it completes.
+    dict->setNGramOrder(2);
+    vector<FileScheduler::Progress> reports;
+    ASSERT_TRUE(dict->addWordsFromDirectory(root, "*.txt", true,
+        [&](const FileScheduler::Progress& progress) { reports.push_back(progress); }));
+    EXPECT_EQ(dict->getWordsAlphabetically(), serial.getWordsAlphabetically());
+    EXPECT_GT(dict->nGramCount(2), 0);
+
+    uint64_t totalBytes = 0;
+    for (const string& path : files) {
+        totalBytes += filesystem::file_size(path);
+    }
+    ASSERT_EQ(reports.size(), files.size());
+    for (size_t i = 0; i < reports.size(); i++) {
+        EXPECT_EQ(reports[i].filesDone, i + 1);
+        EXPECT_EQ(reports[i].fileCount, files.size());
+        EXPECT_EQ(reports[i].byteCount, totalBytes);
+        EXPECT_LE(reports[i].bytesDone, totalBytes);
+    }
+    EXPECT_GT(reports.front().bytesDone, 0);
+    EXPECT_EQ(reports.back().bytesDone, totalBytes);
+
+    EXPECT_FALSE(dict->addWordsFromDirectory(root + "/missing"));
+}
+
+TEST_F(DictionaryTest, DirectoryIngestSplitsFilesByEncoding) {
+    QString root = tempDir->path() + "/mixed-corpus";
+    filesystem::create_directories(root.toStdString());
+    // Both large files span more than one chunk. The CP1251 file is split
+    // like UTF-8; the UTF-16 file has to be read by a single worker.
+    const uint64_t large = FileScheduler::DefaultChunkSize + (1 << 20);
+    {
+        ofstream out(root.toStdString() + "/cp1251.txt", ios::binary);
+        const char* words[] = {"\xEF\xF0\xE8\xE2\xE5\xF2", "\xEC\xE8\xF0", "\xF1\xEB\xEE\xE2\xEE"};
+        for (uint64_t i = 0, written = 0; written < large; i++) {
+            string word = string(words[i % 3]) + to_string(i % 97) + (i % 13 ? " " : "\n");
+            out << word;
+            written += word.size();
+        }
+    }
+    uint64_t utf16Words = 0;
+    {
+        ofstream out(root.toStdString() + "/utf16.txt", ios::binary);
+        out << "\xFF\xFE";
+        // Every word is "don\u2019t " in six units, and the chunk boundary
+        // falls before the apostrophe. Its bytes are 19 20, so a byte split
+        // would resume after the 20 at an odd offset.
+        const string word("d\0o\0n\0\x19\x20t\0 \0", 12);
+        for (uint64_t written = 0; written < large; written += word.size()) {
+            out << word;
+            utf16Words++;
+        }
+    }
+    ofstream(root.toStdString() + "/plain.txt", ios::binary) << "don\xE2\x80\x99t plain\n";
+
+    Dictionary serial;
+    for (const char* name : {"/cp1251.txt", "/utf16.txt", "/plain.txt"}) {
+        ASSERT_TRUE(serial.addWordsFromFile(root + name));
+    }
+
+    Dictionary parallel;
+    ASSERT_TRUE(parallel.addWordsFromDirectory(root, "*.txt", true, nullptr, 4));
+    EXPECT_EQ(parallel.getWordsAlphabetically(), serial.getWordsAlphabetically());
+    EXPECT_EQ(parallel.count("dont"), utf16Words + 1);
+    EXPECT_GT(parallel.count("\xD0\xBC\xD0\xB8\xD1\x80" "1"), 0);
+}
+
+TEST_F(DictionaryTest, DirectoryIngestReusesCachedCounts) {
+    QString root = tempDir->path() + "/corpus";
+    QString cache = tempDir->path() + "/cache";
+    auto writeDoc = [&](int i, const string& text) {
+        string path = root.toStdString() + "/doc" + to_string(i) + ".txt";
+        filesystem::create_directories(filesystem::path(path).parent_path());
+        ofstream(path) << text;
+        return path;
+    };
+    for (int i = 0; i < 10; i++) {
+        writeDoc(i, "shared doc" + to_string(i) + " shared\n");
+    }
+
+    Dictionary first;
+    ASSERT_TRUE(first.setIngestCache(cache));
+    ASSERT_TRUE(first.addWordsFromDirectory(root, "*.txt", true, nullptr, 2));
+    EXPECT_EQ(first.count("shared"), 20);
+
+    // An unchanged file comes from the cache: rewriting it with the same
+    // size and time goes unnoticed. A changed file is read again.
+    string kept = root.toStdString() + "/doc3.txt";
+    auto keptTime = filesystem::last_write_time(kept);
+    writeDoc(3, "secret doc3 shared\n");
+    filesystem::last_write_time(kept, keptTime);
+    writeDoc(7, "changed doc7 shared shared\n");
+
+    Dictionary second;
+    size_t filesDone = 0;
+    ASSERT_TRUE(second.setIngestCache(cache));
+    ASSERT_TRUE(second.addWordsFromDirectory(root, "*.txt", true,
+        [&](const FileScheduler::Progress& progress) { filesDone = progress.filesDone; }, 2));
+    EXPECT_EQ(filesDone, 10);
+    EXPECT_EQ(second.count("secret"), 0);
+    EXPECT_EQ(second.count("changed"), 1);
+    EXPECT_EQ(second.count("shared"), 20);
+
+    Dictionary uncached;
+    ASSERT_TRUE(uncached.addWordsFromDirectory(root, "*.txt"));
+    EXPECT_EQ(uncached.count("secret"), 1);
+
+    EXPECT_FALSE(second.setIngestCache(tempDir->path() + "/corpus/doc0.txt"));
+    EXPECT_TRUE(second.setIngestCache(""));
+}
+
+TEST_F(DictionaryTest, CachedDirectoryIngestStreamsLargeFiles) {
+    QString root = tempDir->path() + "/large-corpus";
+    QString cache = tempDir->path() + "/large-cache";
+    filesystem::create_directories(root.toStdString());
+    {
+        // Several stream blocks, with words of varying length across their edges.
+        ofstream out(root.toStdString() + "/big.txt", ios::binary);
+        for (int i = 0; i < 400000; i++) {
+            out << "w" << (i * 37) % 1013 << (i % 11 ? " " : "\n");
+        }
+    }
+    ofstream(root.toStdString() + "/small.txt", ios::binary) << "w1 tail\n";
+
+    Dictionary uncached;
+    ASSERT_TRUE(uncached.addWordsFromDirectory(root, "*", true, nullptr, 2));
+
+    Dictionary first;
+    ASSERT_TRUE(first.setIngestCache(cache));
+    ASSERT_TRUE(first.addWordsFromDirectory(root, "*", true, nullptr, 2));
+    EXPECT_EQ(first.getWordsAlphabetically(), uncached.getWordsAlphabetically());
+    EXPECT_EQ(distance(filesystem::directory_iterator(cache.toStdString()), filesystem::directory_iterator()), 2);
+
+    Dictionary second;
+    ASSERT_TRUE(second.setIngestCache(cache));
+    ASSERT_TRUE(second.addWordsFromDirectory(root, "*", true, nullptr, 2));
+    EXPECT_EQ(second.getWordsAlphabetically(), uncached.getWordsAlphabetically());
+}
+
+TEST_F(DictionaryTest, CrlfFilesMatchLfFiles) {
+    string text = "The quick brown fox\njumps over\tthe lazy dog.\n\nThe end\n";
+    string crlf;
+    for (char c : text) crlf += c == '\n' ? string("\r\n") : string(1, c);
+
+    QString lfText = tempDir->path() + "/lf.txt";
+    QString crlfText = tempDir->path() + "/crlf.txt";
+    ofstream(lfText.toStdString(), ios::binary) << text;
+    ofstream(crlfText.toStdString(), ios::binary) << crlf;
+
+    Dictionary fromLf;
+    Dictionary fromCrlf;
+    ASSERT_TRUE(fromLf.addWordsFromFile(lfText));
+    ASSERT_TRUE(fromCrlf.addWordsFromFile(crlfText));
+    EXPECT_EQ(fromCrlf.getWordsAlphabetically(), fromLf.getWordsAlphabetically());
+    EXPECT_EQ(fromCrlf.count("end"), 1);
+
+    // A saved dictionary that went through a Windows editor loads the same.
+    QString lfDict = tempDir->path() + "/lf.dict";
+    ASSERT_TRUE(fromLf.saveToFile(lfDict));
+    string saved;
+    {
+        ifstream in(lfDict.toStdString(), ios::binary);
+        saved.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    string savedCrlf;
+    for (char c : saved) savedCrlf += c == '\n' ? string("\r\n") : string(1, c);
+    QString crlfDict = tempDir->path() + "/crlf.dict";
+    ofstream(crlfDict.toStdString(), ios::binary) << savedCrlf;
+
+    Dictionary loaded;
+    ASSERT_TRUE(loaded.loadFromFile(crlfDict));
+    EXPECT_EQ(loaded.getWordsAlphabetically(), fromLf.getWordsAlphabetically());
+}
+
+TEST_F(DictionaryTest, CountsRussianTextInAnyEncoding) {
+    // "Привет, мир! ПРИВЕТ Ёлка" in each encoding.
+    const string utf8 = "Привет, мир! ПРИВЕТ Ёлка\n";
+    const string cp1251 = "\xCF\xF0\xE8\xE2\xE5\xF2, \xEC\xE8\xF0! \xCF\xD0\xC8\xC2\xC5\xD2 \xA8\xEB\xEA\xE0\n";
+    string utf16 = "\xFF\xFE";
+    for (char16_t unit : u16string(u"Привет, мир! ПРИВЕТ Ёлка\n")) {
+        utf16 += static_cast<char>(unit & 0xFF);
+        utf16 += static_cast<char>(unit >> 8);
+    }
+
+    QString root = tempDir->path() + "/russian";
+    vector<string> paths;
+    int index = 0;
+    for (const string& text : {utf8, cp1251, utf16}) {
+        string path = root.toStdString() + "/text" + to_string(index++) + ".txt";
+        filesystem::create_directories(root.toStdString());
+        ofstream(path, ios::binary) << text;
+        paths.push_back(path);
+    }
+
+    for (const string& path : paths) {
+        Dictionary single;
+        ASSERT_TRUE(single.addWordsFromFile(QString::fromStdString(path)));
+        EXPECT_EQ(single.getWordsAlphabetically(),
+                  (vector<pair<string, int>>{{"мир", 1}, {"привет", 2}, {"ёлка", 1}})) << path;
+    }
+
+    Dictionary files;
+    ASSERT_TRUE(files.addWordsFromFiles(paths));
+    EXPECT_EQ(files.count("привет"), 6);
+    EXPECT_EQ(files.count("ёлка"), 3);
+
+    Dictionary directory;
+    ASSERT_TRUE(directory.addWordsFromDirectory(root));
+    EXPECT_EQ(directory.getWordsAlphabetically(), files.getWordsAlphabetically());
+
+    // Larger than one read buffer, so it goes through the pipeline.
+    QString large = tempDir->path() + "/large1251.txt";
+    {
+        ofstream out(large.toStdString(), ios::binary);
+        for (int i = 0; i < 100000; i++) out << cp1251;
+    }
+    Dictionary streamed;
+    ASSERT_TRUE(streamed.addWordsFromFile(large));
+    EXPECT_EQ(streamed.count("привет"), 200000);
+    EXPECT_EQ(streamed.count("мир"), 100000);
+}
+
+TEST_F(DictionaryTest, AddWordsFromFilesMatchesSingleFiles) {
+    vector<string> paths;
+    for (int i = 0; i < 5; i++) {
+        string path = tempDir->path().toStdString() + "/batch" + to_string(i) + ".txt";
+        ofstream out(path);
+        for (int j = 0; j < 40000 * i; j++) {
+            out << "term" << (j * 13 + i) % 57 << (j % 11 ? ' ' : '\n');
+        }
+        paths.push_back(path);
+    }
+
+    Dictionary serial;
+    for (const string& path : paths) {
+        ASSERT_TRUE(serial.addWordsFromFile(QString::fromStdString(path)));
+    }
+
+    dict->enableDocumentIndex();
+    ASSERT_TRUE(dict->addWordsFromFiles(paths));
+    EXPECT_EQ(dict->getWordsAlphabetically(), serial.getWordsAlphabetically());
+    EXPECT_EQ(dict->documentCount(), paths.size());
+
+    EXPECT_FALSE(dict->addWordsFromFiles({tempDir->path().toStdString() + "/missing.txt"}));
+    EXPECT_EQ(dict->documentCount(), paths.size());
+}
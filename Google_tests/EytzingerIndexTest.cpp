@@ -0,0 +1,46 @@
+#include "gtest/gtest.h"
+#include "../eytzingerindex.h"
+#include <algorithm>
+
+using namespace std;
+
+TEST(EytzingerIndexTest, LowerBoundMatchesBinarySearch) {
+    for (size_t n : {0, 1, 2, 7, 8, 100, 1023, 1024, 1500}) {
+        vector<pair<string, int>> words;
+        for (size_t i = 0; i < n; i++) {
+            words.emplace_back("key" + to_string(i * 2 + 10000), static_cast<int>(i));
+        }
+        sort(words.begin(), words.end());
+
+        EytzingerIndex index;
+        index.build(words);
+        ASSERT_EQ(index.size(), n);
+
+        for (size_t i = 0; i < n; i++) {
+            ASSERT_EQ(index.keyAt(i), words[i].first);
+        }
+
+        for (size_t probe = 9990; probe < 10000 + 2 * n + 10; probe++) {
+            string key = "key" + to_string(probe);
+            size_t expected = lower_bound(words.begin(), words.end(), key,
+                                          [](const auto& a, const string& b) { return a.first < b; }) -
+                              words.begin();
+            ASSERT_EQ(index.lowerBound(key), expected) << "n=" << n << " key=" << key;
+        }
+    }
+}
+
+TEST(EytzingerIndexTest, FindUsesFullKeyBeyondPrefix) {
+    vector<pair<string, int>> words = {
+        {"abcdefgh", 1}, {"abcdefgh_one", 2}, {"abcdefgh_two", 3}, {"b", 4}};
+
+    EytzingerIndex index;
+    index.build(words);
+
+    EXPECT_EQ(index.find("abcdefgh_two"), 2);
+    EXPECT_EQ(index.countAt(index.find("abcdefgh_one")), 2);
+    EXPECT_EQ(index.find("abcdefgh_three"), EytzingerIndex::npos);
+    EXPECT_EQ(index.lowerBound("abcdefgh_p"), 2);
+    EXPECT_EQ(index.lowerBound("c"), 4);
+    EXPECT_EQ(index.lowerBound(""), 0);
+}
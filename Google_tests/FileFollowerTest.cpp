@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+#include "../filefollower.h"
+#include <QTemporaryDir>
+#include <fstream>
+#include <cstdio>
+
+using namespace std;
+
+static void appendText(const string& path, const string& text) {
+    ofstream out(path, ios::binary | ios::app);
+    out << text;
+}
+
+static string readAllNew(FileFollower& follower, size_t index = 0) {
+    string result;
+    follower.readNew(index, [&](const char* data, size_t size) { result.append(data, size); });
+    return result;
+}
+
+class FileFollowerTest : public ::testing::Test {
+protected:
+    QTemporaryDir dir;
+    string path = dir.path().toStdString() + "/app.log";
+};
+
+TEST_F(FileFollowerTest, HandsOverOnlyCompleteLines) {
+    appendText(path, "first line\nsecond");
+
+    FileFollower follower;
+    ASSERT_TRUE(follower.add({path, 0, 0}));
+    EXPECT_FALSE(follower.add({path, 0, 0}));
+
+    EXPECT_EQ(readAllNew(follower), "first line\n");
+    EXPECT_EQ(readAllNew(follower), "");
+
+    appendText(path, " half\nthird\n");
+    EXPECT_EQ(readAllNew(follower), "second half\nthird\n");
+    EXPECT_EQ(follower.file(0).offset, 29);
+}
+
+TEST_F(FileFollowerTest, RestartsAfterTruncation) {
+    appendText(path, "old content here\n");
+
+    FileFollower follower;
+    ASSERT_TRUE(follower.add({path, 0, 0}));
+    EXPECT_EQ(readAllNew(follower), "old content here\n");
+
+    { ofstream truncate(path, ios::binary | ios::trunc); }
+    appendText(path, "new\n");
+    EXPECT_EQ(readAllNew(follower), "new\n");
+}
+
+TEST_F(FileFollowerTest, DrainsRotatedFile) {
+    appendText(path, "before\n");
+
+    FileFollower follower;
+    ASSERT_TRUE(follower.add({path, 0, 0}));
+    EXPECT_EQ(readAllNew(follower), "before\n");
+
+    appendText(path, "late write\nunterminated");
+    ASSERT_EQ(rename(path.c_str(), (path + ".1").c_str()), 0);
+    appendText(path, "fresh\n");
+
+    EXPECT_EQ(readAllNew(follower), "late write\nunterminated\nfresh\n");
+    EXPECT_EQ(follower.file(0).offset, 6);
+}
+
+TEST_F(FileFollowerTest, ResumesFromSavedState) {
+    appendText(path, "one\ntwo\n");
+    QString statePath = dir.path() + "/state.follow";
+
+    {
+        FileFollower follower;
+        ASSERT_TRUE(follower.add({path, 0, 0}));
+        EXPECT_EQ(readAllNew(follower), "one\ntwo\n");
+        ASSERT_TRUE(follower.save(statePath, 0x1234abcd5678ULL));
+    }
+    EXPECT_EQ(FileFollower::checkpoint(statePath), 0x1234abcd5678ULL);
+    EXPECT_EQ(FileFollower::checkpoint(dir.path() + "/missing.follow"), 0);
+
+    appendText(path, "three\n");
+
+    FileFollower resumed;
+    ASSERT_TRUE(resumed.load(statePath));
+    ASSERT_EQ(resumed.size(), 1);
+    EXPECT_EQ(resumed.file(0).path, path);
+    EXPECT_EQ(readAllNew(resumed), "three\n");
+}
+
+#ifdef __linux__
+TEST_F(FileFollowerTest, WakesUpOnAppend) {
+    appendText(path, "");
+
+    FileFollower follower;
+    ASSERT_TRUE(follower.add({path, 0, 0}));
+    EXPECT_FALSE(follower.waitForChanges(0));
+
+    appendText(path, "event\n");
+    EXPECT_TRUE(follower.waitForChanges(1000));
+    EXPECT_EQ(readAllNew(follower), "event\n");
+}
+#endif
@@ -0,0 +1,154 @@
+#include "gtest/gtest.h"
+#include "../filescheduler.h"
+#include "../streamtokenizer.h"
+#include <QTemporaryDir>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+static void writeFile(const string& path, const string& text) {
+    filesystem::create_directories(filesystem::path(path).parent_path());
+    ofstream out(path, ios::binary);
+    out << text;
+}
+
+static map<string, int> countTokens(const string& text) {
+    map<string, int> counts;
+    StreamTokenizer tokenizer;
+    auto handler = [&](string_view token) { counts[string(token)]++; };
+    tokenizer.feed(text.data(), text.size(), handler);
+    tokenizer.finish(handler);
+    return counts;
+}
+
+TEST(FileSchedulerTest, MatchesWildcardPatterns) {
+    EXPECT_TRUE(FileScheduler::matchesPattern("notes.txt", "*"));
+    EXPECT_TRUE(FileScheduler::matchesPattern("notes.txt", "*.txt"));
+    EXPECT_TRUE(FileScheduler::matchesPattern("app.log", "*.txt;*.log"));
+    EXPECT_TRUE(FileScheduler::matchesPattern("part-07.txt", "part-??.*"));
+    EXPECT_FALSE(FileScheduler::matchesPattern("part-7.txt", "part-??.*"));
+    EXPECT_FALSE(FileScheduler::matchesPattern("notes.txt.bak", "*.txt"));
+    EXPECT_FALSE(FileScheduler::matchesPattern("notes", "*.txt;*.log"));
+}
+
+TEST(FileSchedulerTest, ListsMatchingFilesSorted) {
+    QTemporaryDir dir;
+    string root = dir.path().toStdString();
+    writeFile(root + "/b.txt", "b");
+    writeFile(root + "/a.txt", "a");
+    writeFile(root + "/skip.bin", "x");
+    writeFile(root + "/sub/c.txt", "c");
+
+    vector<string> recursive = FileScheduler::listFiles(root, "*.txt");
+    ASSERT_EQ(recursive.size(), 3);
+    EXPECT_EQ(filesystem::path(recursive[0]).filename(), "a.txt");
+    EXPECT_EQ(filesystem::path(recursive[2]).filename(), "c.txt");
+
+    EXPECT_EQ(FileScheduler::listFiles(root, "*.txt", false).size(), 2);
+    EXPECT_TRUE(FileScheduler::listFiles(root + "/missing").empty());
+}
+
+TEST(FileSchedulerTest, SplitRangesKeepTokensWhole) {
+    QTemporaryDir dir;
+    string root = dir.path().toStdString();
+
+    string large;
+    for (int i = 0; i < 3000; i++) {
+        large += "token" + to_string(i % 97) + (i % 7 ? " " : "\r\n");
+    }
+    large += string(300, 'z');
+    string text = large;
+    writeFile(root + "/large.txt", large);
+    for (int i = 0; i < 40; i++) {
+        string small = "small" + to_string(i) + " shared\n";
+        writeFile(root + "/small" + to_string(i) + ".txt", small);
+        text += " " + small;
+    }
+    map<string, int> expected = countTokens(text);
+
+    for (int threads : {1, 3}) {
+        FileScheduler scheduler(FileScheduler::listFiles(root), 64);
+        EXPECT_GT(scheduler.unitCount(), 100);
+
+        mutex countsMutex;
+        map<string, int> counts;
+        vector<FileScheduler::Progress> reports;
+        bool ok = scheduler.run(threads, [&](size_t worker, size_t file, const char* data, size_t size) {
+            EXPECT_LT(worker, static_cast<size_t>(threads));
+            EXPECT_LT(file, scheduler.fileCount());
+            map<string, int> local = countTokens(string(data, size));
+            lock_guard<mutex> lock(countsMutex);
+            for (const auto& [token, count] : local) counts[token] += count;
+        }, [&](const FileScheduler::Progress& progress) { reports.push_back(progress); });
+
+        ASSERT_TRUE(ok);
+        EXPECT_EQ(counts, expected) << "threads=" << threads;
+        ASSERT_FALSE(reports.empty());
+        EXPECT_EQ(reports.back().filesDone, 41);
+        EXPECT_EQ(reports.back().bytesDone, scheduler.byteCount());
+    }
+}
+
+TEST(FileSchedulerTest, UnsplitFilesArriveWhole) {
+    QTemporaryDir dir;
+    string root = dir.path().toStdString();
+    vector<string> contents;
+    for (int i = 0; i < 5; i++) {
+        contents.push_back(string(1000 * (i + 1), 'a' + i) + " end" + to_string(i));
+        writeFile(root + "/file" + to_string(i) + ".txt", contents.back());
+    }
+
+    FileScheduler scheduler(FileScheduler::listFiles(root), UINT64_MAX);
+    mutex seenMutex;
+    vector<string> seen(scheduler.fileCount());
+    ASSERT_TRUE(scheduler.run(2, [&](size_t, size_t file, const char* data, size_t size) {
+        lock_guard<mutex> lock(seenMutex);
+        EXPECT_TRUE(seen[file].empty());
+        seen[file] = string(data, size);
+    }));
+
+    EXPECT_EQ(seen, contents);
+}
+
+TEST(FileSchedulerTest, StreamedFilesArriveInOrderFromOneWorker) {
+    QTemporaryDir dir;
+    string root = dir.path().toStdString();
+    string large;
+    for (int i = 0; large.size() < 2 * FileScheduler::StreamBlockSize + 1000; i++) {
+        large += "word" + to_string(i) + " ";
+    }
+    writeFile(root + "/a-large.txt", large);
+    writeFile(root + "/b-small.txt", "small streamed");
+    writeFile(root + "/c-split.txt", string(200, 'x') + " " + string(200, 'y'));
+
+    FileScheduler scheduler(FileScheduler::listFiles(root), 64, {true, true, false});
+    mutex stateMutex;
+    vector<string> seen(scheduler.fileCount());
+    vector<size_t> pieces(scheduler.fileCount(), 0);
+    vector<int> done(scheduler.fileCount(), 0);
+    vector<size_t> streamWorker(scheduler.fileCount(), SIZE_MAX);
+    ASSERT_TRUE(scheduler.run(3, [&](size_t worker, size_t file, const char* data, size_t size) {
+        lock_guard<mutex> lock(stateMutex);
+        EXPECT_EQ(done[file], 0);
+        if (file < 2) {
+            if (streamWorker[file] == SIZE_MAX) streamWorker[file] = worker;
+            EXPECT_EQ(streamWorker[file], worker);
+            seen[file].append(data, size);
+        }
+        pieces[file]++;
+    }, nullptr, [&](size_t worker, size_t file, bool complete) {
+        lock_guard<mutex> lock(stateMutex);
+        EXPECT_TRUE(complete);
+        if (file < 2) EXPECT_EQ(streamWorker[file], worker);
+        done[file]++;
+    }));
+
+    EXPECT_EQ(seen[0], large);
+    EXPECT_EQ(pieces[0], 3);
+    EXPECT_EQ(seen[1], "small streamed");
+    EXPECT_GT(pieces[2], 1);
+    EXPECT_EQ(done, (vector<int>{1, 1, 1}));
+}
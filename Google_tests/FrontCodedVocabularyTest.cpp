@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+#include "../frontcodedvocabulary.h"
+#include "../frozendictionary.h"
+#include "../dictionary.h"
+#include <algorithm>
+#include <QTemporaryDir>
+
+using namespace std;
+
+TEST(FrontCodedVocabularyTest, RankAndKeyAccessMatchSortedInput) {
+    vector<pair<string, int>> words;
+    for (int i = 0; i < 1000; i++) {
+        words.emplace_back("prefix_shared_" + to_string(i * 3), i + 1);
+    }
+    sort(words.begin(), words.end());
+
+    for (size_t blockSize : {16, 32, 64}) {
+        FrontCodedVocabulary vocabulary(blockSize);
+        vocabulary.build(words);
+        ASSERT_EQ(vocabulary.size(), words.size());
+
+        for (size_t i = 0; i < words.size(); i++) {
+            ASSERT_EQ(vocabulary.at(i), words[i]);
+            ASSERT_EQ(vocabulary.find(words[i].first), i);
+            ASSERT_EQ(vocabulary.count(words[i].first), words[i].second);
+        }
+        EXPECT_EQ(vocabulary.find("prefix_shared_1"), FrontCodedVocabulary::npos);
+        EXPECT_EQ(vocabulary.find("a"), FrontCodedVocabulary::npos);
+        EXPECT_EQ(vocabulary.find("z"), FrontCodedVocabulary::npos);
+        EXPECT_GT(vocabulary.compressionRatio(), 2.0);
+    }
+}
+
+TEST(FrontCodedVocabularyTest, BlockSizeIsClamped) {
+    EXPECT_EQ(FrontCodedVocabulary(4).blockSize(), 16);
+    EXPECT_EQ(FrontCodedVocabulary(1000).blockSize(), 64);
+
+    FrontCodedVocabulary empty;
+    empty.build(vector<pair<string, int>>{});
+    EXPECT_EQ(empty.size(), 0);
+    EXPECT_EQ(empty.find("word"), FrontCodedVocabulary::npos);
+}
+
+TEST(FrontCodedVocabularyTest, LoadsFrozenAndTextDictionaries) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    Dictionary dictionary;
+    for (int i = 0; i < 100; i++) {
+        for (int j = 0; j <= i % 5; j++) {
+            dictionary.addWord("word" + to_string(i));
+        }
+    }
+    QString textPath = dir.path() + "/words.dict";
+    QString frozenPath = dir.path() + "/words.fdic";
+    ASSERT_TRUE(dictionary.saveToFile(textPath));
+    ASSERT_TRUE(dictionary.freeze().saveToFile(frozenPath));
+
+    auto expected = dictionary.getWordsAlphabetically();
+    for (const QString& path : {textPath, frozenPath}) {
+        FrontCodedVocabulary vocabulary;
+        ASSERT_TRUE(vocabulary.loadFromFile(path));
+        ASSERT_EQ(vocabulary.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            ASSERT_EQ(vocabulary.at(i), expected[i]);
+        }
+    }
+
+    FrontCodedVocabulary missing;
+    EXPECT_FALSE(missing.loadFromFile(dir.path() + "/missing.dict"));
+}
@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+#include "../dictionary.h"
+#include "../frozendictionary.h"
+#include <QTemporaryDir>
+#include <QFile>
+#include <QTextStream>
+#include <cstring>
+
+using namespace std;
+
+class FrozenDictionaryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(tempDir.isValid());
+        for (int i = 0; i < 5000; i++) {
+            words.emplace_back("word" + to_string(i * 7919 % 100003), i + 1);
+        }
+    }
+
+    QTemporaryDir tempDir;
+    vector<pair<string, int>> words;
+};
+
+TEST_F(FrozenDictionaryTest, LooksUpEveryKeyAndRejectsOthers) {
+    FrozenDictionary frozen;
+    frozen.build(words);
+
+    ASSERT_EQ(frozen.size(), words.size());
+    for (const auto& [word, count] : words) {
+        EXPECT_EQ(frozen.count(word), static_cast<uint64_t>(count)) << word;
+    }
+    EXPECT_EQ(frozen.count("absent"), 0);
+    EXPECT_FALSE(frozen.contains("word100004"));
+    EXPECT_FALSE(frozen.contains(""));
+    EXPECT_LT(frozen.hashBitsPerKey(), 4.5);
+}
+
+TEST_F(FrozenDictionaryTest, CountManyMatchesCount) {
+    FrozenDictionary frozen;
+    frozen.build(words);
+
+    vector<string> storage{"absent"};
+    for (size_t i = 0; i < words.size(); i += 37) storage.push_back(words[i].first);
+    vector<string_view> queries(storage.begin(), storage.end());
+    vector<uint64_t> counts(queries.size());
+
+    frozen.countMany(queries, counts);
+    for (size_t i = 0; i < queries.size(); i++) {
+        EXPECT_EQ(counts[i], frozen.count(queries[i]));
+    }
+    EXPECT_EQ(counts[0], 0);
+}
+
+TEST_F(FrozenDictionaryTest, BinaryImageRoundTrip) {
+    FrozenDictionary frozen;
+    frozen.build(words);
+
+    QString path = tempDir.path() + "/frozen.fdic";
+    ASSERT_TRUE(frozen.saveToFile(path));
+
+    FrozenDictionary mapped;
+    ASSERT_TRUE(mapped.loadFromFile(path));
+    ASSERT_EQ(mapped.size(), words.size());
+    EXPECT_EQ(mapped.count(words[42].first), static_cast<uint64_t>(words[42].second));
+    EXPECT_EQ(mapped.count("absent"), 0);
+
+    FrozenDictionary moved = std::move(mapped);
+    EXPECT_EQ(moved.count(words[7].first), static_cast<uint64_t>(words[7].second));
+}
+
+TEST_F(FrozenDictionaryTest, CorruptImagesAreRejected) {
+    FrozenDictionary frozen;
+    frozen.build(words);
+    QString path = tempDir.path() + "/frozen.fdic";
+    ASSERT_TRUE(frozen.saveToFile(path));
+
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    const QByteArray image = file.readAll();
+    file.close();
+    auto field = [&](int offset) {
+        uint64_t value;
+        memcpy(&value, image.constData() + offset, sizeof(value));
+        return value;
+    };
+    const uint64_t keyCount = field(8);
+    const uint64_t blobSize = field(48);
+    const uint64_t levelSizesOffset = field(64);
+    const uint64_t keyOffsetsOffset = field(104);
+
+    // Each case patches one value: an empty hash level, a rank table too
+    // short for the bit array, a key offset past the blob and a bit count
+    // whose byte size wraps around.
+    struct Patch {
+        uint64_t offset;
+        uint64_t value;
+        size_t width;
+    };
+    const Patch patches[] = {
+        {levelSizesOffset, 0, sizeof(uint64_t)},
+        {32, 0, sizeof(uint64_t)},
+        {keyOffsetsOffset + keyCount * sizeof(uint32_t), blobSize + 1, sizeof(uint32_t)},
+        {24, 1ULL << 61, sizeof(uint64_t)},
+    };
+
+    for (size_t i = 0; i < size(patches); i++) {
+        QByteArray corrupt = image;
+        memcpy(corrupt.data() + patches[i].offset, &patches[i].value, patches[i].width);
+
+        QString corruptPath = tempDir.path() + "/corrupt" + QString::number(i) + ".fdic";
+        QFile out(corruptPath);
+        ASSERT_TRUE(out.open(QIODevice::WriteOnly));
+        out.write(corrupt);
+        out.close();
+
+        FrozenDictionary loaded;
+        EXPECT_FALSE(loaded.loadFromFile(corruptPath)) << "patch " << i;
+        EXPECT_EQ(loaded.count(words[0].first), 0);
+    }
+}
+
+TEST_F(FrozenDictionaryTest, FreezeAndTextLoaderAgree) {
+    Dictionary dict;
+    dict.addWord("alpha");
+    dict.addWord("alpha");
+    dict.addWord("beta");
+
+    FrozenDictionary frozen = dict.freeze();
+    EXPECT_EQ(frozen.count("alpha"), 2);
+    EXPECT_EQ(frozen.count("beta"), 1);
+    EXPECT_EQ(dict.count("alpha"), 2);
+
+    QString dictPath = tempDir.path() + "/plain.dict";
+    ASSERT_TRUE(dict.saveToFile(dictPath));
+
+    FrozenDictionary loaded;
+    ASSERT_TRUE(loaded.loadFromFile(dictPath));
+    EXPECT_EQ(loaded.size(), 2);
+    EXPECT_EQ(loaded.count("alpha"), 2);
+    EXPECT_EQ(loaded.count("gamma"), 0);
+}
@@ -0,0 +1,153 @@
+#include "gtest/gtest.h"
+#include "../fstdictionary.h"
+#include "../dictionary.h"
+#include <algorithm>
+#include <random>
+#include <QTemporaryDir>
+#include <QFileInfo>
+#include <QFile>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+vector<pair<string, int>> inflectedVocabulary() {
+    const vector<string> endings = {"", "a", "u", "om", "e", "y", "ov", "am", "ami", "ah", "ej", "oj"};
+    mt19937 random(7);
+    vector<pair<string, int>> words;
+    for (int stem = 0; stem < 400; stem++) {
+        string base;
+        for (int length = 4 + stem % 5, i = 0; i < length; i++) {
+            base.push_back(static_cast<char>('a' + random() % 26));
+        }
+        for (const string& ending : endings) {
+            words.emplace_back(base + ending, 1 + static_cast<int>(random() % 4));
+        }
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end(),
+                       [](const auto& a, const auto& b) { return a.first == b.first; }),
+                words.end());
+    return words;
+}
+
+}
+
+TEST(FstDictionaryTest, LookupAndOrderedStreaming) {
+    vector<pair<string, int>> words = {
+        {"ab", 5}, {"abc", 3}, {"abd", 9}, {"b", 1}, {"bar", 12}, {"baz", 12}, {"car", 2}};
+
+    FstDictionary fst;
+    ASSERT_TRUE(fst.build(words));
+    EXPECT_EQ(fst.size(), words.size());
+
+    for (const auto& [word, count] : words) {
+        EXPECT_EQ(fst.count(word), static_cast<uint64_t>(count)) << word;
+        EXPECT_TRUE(fst.contains(word));
+    }
+    EXPECT_FALSE(fst.contains("a"));
+    EXPECT_FALSE(fst.contains("ba"));
+    EXPECT_EQ(fst.count("abcd"), 0);
+    EXPECT_EQ(fst.count(""), 0);
+
+    vector<pair<string, int>> streamed;
+    fst.forEach([&](string_view word, uint64_t count) { streamed.emplace_back(word, static_cast<int>(count)); });
+    EXPECT_EQ(streamed, words);
+
+    vector<string> prefixed;
+    fst.forEachWithPrefix("ba", [&](string_view word, uint64_t) { prefixed.emplace_back(word); });
+    EXPECT_EQ(prefixed, (vector<string>{"bar", "baz"}));
+
+    FstBuilder builder;
+    EXPECT_TRUE(builder.add("b", 1));
+    EXPECT_FALSE(builder.add("a", 1));
+    EXPECT_FALSE(builder.add("b", 1));
+}
+
+TEST(FstDictionaryTest, MappedImageIsSmallerThanTextDictionary) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    Dictionary dictionary;
+    for (const auto& [word, count] : inflectedVocabulary()) {
+        for (int i = 0; i < count; i++) dictionary.addWord(word);
+    }
+    QString textPath = dir.path() + "/words.dict";
+    QString fstPath = dir.path() + "/words.fst";
+    ASSERT_TRUE(dictionary.saveToFile(textPath));
+    ASSERT_TRUE(dictionary.toFst().saveToFile(fstPath));
+
+    FstDictionary fst;
+    ASSERT_TRUE(fst.loadFromFile(fstPath));
+    auto expected = dictionary.getWordsAlphabetically();
+    ASSERT_EQ(fst.size(), expected.size());
+    for (const auto& [word, count] : expected) {
+        ASSERT_EQ(fst.count(word), static_cast<uint64_t>(count)) << word;
+    }
+
+    qint64 textSize = QFileInfo(textPath).size();
+    qint64 fstSize = QFileInfo(fstPath).size();
+    EXPECT_LT(fstSize * 2, textSize) << "fst " << fstSize << " text " << textSize;
+
+    FstDictionary missing;
+    EXPECT_FALSE(missing.loadFromFile(dir.path() + "/missing.fst"));
+    EXPECT_FALSE(missing.loadFromFile(textPath));
+}
+
+TEST(FstDictionaryTest, CorruptNodesAreDeadEnds) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    vector<pair<string, int>> words = inflectedVocabulary();
+    FstDictionary built;
+    ASSERT_TRUE(built.build(words));
+    QString fstPath = dir.path() + "/words.fst";
+    ASSERT_TRUE(built.saveToFile(fstPath));
+
+    QFile file(fstPath);
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    const QByteArray image = file.readAll();
+    file.close();
+    const size_t headerSize = 40;
+    uint64_t rootAddress = 0;
+    uint64_t nodesSize = 0;
+    memcpy(&rootAddress, image.constData() + 16, sizeof(rootAddress));
+    memcpy(&nodesSize, image.constData() + 24, sizeof(nodesSize));
+
+    auto loadCorrupt = [&](const QByteArray& corrupt, FstDictionary& fst) {
+        QFile out(fstPath);
+        ASSERT_TRUE(out.open(QIODevice::WriteOnly));
+        out.write(corrupt);
+        out.close();
+        ASSERT_TRUE(fst.loadFromFile(fstPath));
+    };
+
+    // A root whose transition count runs past the end of the nodes.
+    QByteArray truncated = image;
+    memset(truncated.data() + headerSize + rootAddress, 0x7f, nodesSize - rootAddress);
+    FstDictionary deadRoot;
+    loadCorrupt(truncated, deadRoot);
+    size_t visited = 0;
+    deadRoot.forEach([&](string_view, uint64_t) { visited++; });
+    EXPECT_EQ(visited, 0);
+    EXPECT_EQ(deadRoot.count(words[0].first), 0);
+
+    // Runs of noise anywhere in the nodes; every lookup has to stay inside
+    // the image and terminate.
+    mt19937 random(11);
+    for (int round = 0; round < 20; round++) {
+        QByteArray corrupt = image;
+        for (int run = 0; run < 8; run++) {
+            size_t start = headerSize + random() % nodesSize;
+            for (size_t i = start; i < min<size_t>(start + 4, headerSize + nodesSize); i++) {
+                corrupt.data()[i] = static_cast<char>(round % 2 ? 0xff : random());
+            }
+        }
+        FstDictionary fst;
+        loadCorrupt(corrupt, fst);
+        for (const auto& [word, count] : words) {
+            fst.count(word);
+            fst.contains(word);
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#include "gtest/gtest.h"
+#include "../ingestpipeline.h"
+#include "../streamtokenizer.h"
+#include "../wordhashindex.h"
+#include <cctype>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static void lowercase(string_view token, string& word) {
+    word.clear();
+    for (char c : token) {
+        if (isalnum(static_cast<unsigned char>(c))) word.push_back(static_cast<char>(tolower(static_cast<unsigned char>(c))));
+    }
+}
+
+static IngestPipeline::Producer piecesOf(const string& input, size_t pieceSize) {
+    return [&input, pieceSize](const IngestPipeline::ChunkSink& sink) {
+        for (size_t i = 0; i < input.size(); i += pieceSize) {
+            sink(input.data() + i, min(pieceSize, input.size() - i));
+        }
+        return true;
+    };
+}
+
+static vector<string> serialWords(const string& input) {
+    StreamTokenizer tokenizer;
+    vector<string> words;
+    auto handler = [&](string_view token) {
+        string word;
+        lowercase(token, word);
+        if (!word.empty()) words.push_back(word);
+    };
+    tokenizer.feed(input.data(), input.size(), handler);
+    tokenizer.finish(handler);
+    return words;
+}
+
+static string sampleInput() {
+    string input;
+    for (int i = 0; i < 60000; i++) {
+        input += "Word" + to_string(i % 997) + (i % 7 ? " " : "\r\n");
+        if (i % 5000 == 0) input += "... ";
+    }
+    // Longer than a chunk, so it has to be truncated across chunk boundaries.
+    input += string(StreamTokenizer::MaxTokenLength * 5, 'x') + " end";
+    return input;
+}
+
+TEST(IngestPipelineTest, MatchesSerialTokenizingInOrder) {
+    string input = sampleInput();
+    vector<string> expected = serialWords(input);
+
+    for (size_t threads : {1, 2, 4}) {
+        for (size_t pieceSize : {1000, 65536, 1 << 20}) {
+            IngestPipeline pipeline(threads, 0, 2);
+            vector<string> words;
+            uint64_t tokens = 0;
+            bool ok = pipeline.run(piecesOf(input, pieceSize), lowercase, [&](const IngestPipeline::TokenBatch& batch) {
+                for (size_t i = 0; i < batch.size; i++) {
+                    EXPECT_EQ(batch.hashes[i], hashWord(batch.words[i]));
+                    words.push_back(batch.words[i]);
+                }
+                tokens += batch.tokens;
+            });
+
+            ASSERT_TRUE(ok);
+            EXPECT_EQ(words, expected) << "threads=" << threads << " piece=" << pieceSize;
+            EXPECT_EQ(pipeline.statistics().tokens, tokens);
+            EXPECT_EQ(pipeline.statistics().bytes, input.size());
+        }
+    }
+}
+
+TEST(IngestPipelineTest, SlowCounterHoldsBackReader) {
+    string input = sampleInput();
+    IngestPipeline pipeline(2, 0, 1);
+
+    size_t batches = 0;
+    ASSERT_TRUE(pipeline.run(piecesOf(input, 4096), lowercase, [&](const IngestPipeline::TokenBatch&) {
+        this_thread::sleep_for(chrono::milliseconds(20));
+        batches++;
+    }));
+
+    const IngestPipeline::Statistics& stats = pipeline.statistics();
+    EXPECT_EQ(stats.tokenizerThreads, 2);
+    EXPECT_EQ(stats.reader.items, batches);
+    EXPECT_EQ(stats.tokenizer.items, batches);
+    EXPECT_EQ(stats.counter.items, batches);
+    EXPECT_GT(batches, 4);
+    // Only three slots exist, so the reader spent most of the run waiting.
+    EXPECT_GT(stats.reader.waitSeconds, stats.reader.busySeconds);
+    EXPECT_GE(stats.counter.busySeconds, 0.02 * batches * 0.9);
+}
+
+TEST(IngestPipelineTest, ReportsProducerFailure) {
+    IngestPipeline pipeline(1);
+    vector<string> words;
+    bool ok = pipeline.run(
+        [](const IngestPipeline::ChunkSink& sink) {
+            sink("counted before ", 15);
+            return false;
+        },
+        lowercase,
+        [&](const IngestPipeline::TokenBatch& batch) {
+            words.insert(words.end(), batch.words.begin(), batch.words.begin() + batch.size);
+        });
+
+    EXPECT_FALSE(ok);
+    EXPECT_EQ(words, (vector<string>{"counted", "before"}));
+}
+
+TEST(IngestPipelineTest, RethrowsCounterException) {
+    string input = sampleInput();
+    IngestPipeline pipeline(2, 0, 1);
+
+    EXPECT_THROW(pipeline.run(piecesOf(input, 4096), lowercase,
+                              [](const IngestPipeline::TokenBatch&) { throw runtime_error("counter failed"); }),
+                 runtime_error);
+}
+
+TEST(IngestPipelineTest, RethrowsProducerException) {
+    IngestPipeline pipeline(2);
+
+    EXPECT_THROW(pipeline.run([](const IngestPipeline::ChunkSink& sink) -> bool {
+                                  sink("some words ", 11);
+                                  throw runtime_error("reader failed");
+                              },
+                              lowercase, [](const IngestPipeline::TokenBatch&) {}),
+                 runtime_error);
+}
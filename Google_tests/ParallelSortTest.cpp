@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+#include "../parallelsort.h"
+#include "../threadpool.h"
+#include <algorithm>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+vector<pair<string, int>> randomItems(size_t n, unsigned seed) {
+    const vector<string> prefixes = {"", "a", "common_prefix_", "common_prefix_longer_than_eight_"};
+    mt19937 random(seed);
+    vector<pair<string, int>> items;
+    for (size_t i = 0; i < n; i++) {
+        string word = prefixes[random() % prefixes.size()];
+        for (size_t length = 1 + random() % 6; length > 0; length--) {
+            word.push_back(static_cast<char>('a' + random() % 4));
+        }
+        int count = random() % 3 == 0 ? static_cast<int>(random() % 100000) : static_cast<int>(random() % 5);
+        items.emplace_back(std::move(word), count);
+    }
+    return items;
+}
+
+}
+
+TEST(ParallelSortTest, AlphabeticalMatchesStdSort) {
+    for (size_t n : {0, 1, 31, 33, 1000, 100000}) {
+        auto items = randomItems(n, static_cast<unsigned>(n));
+        auto expected = items;
+        stable_sort(expected.begin(), expected.end(),
+                    [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        ParallelSort::alphabetically(items);
+        ASSERT_EQ(items.size(), expected.size());
+        for (size_t i = 0; i < items.size(); i++) {
+            ASSERT_EQ(items[i].first, expected[i].first) << "n=" << n << " i=" << i;
+        }
+    }
+}
+
+TEST(ParallelSortTest, FrequencyOrderBreaksTiesAlphabetically) {
+    for (size_t n : {2, 500, 100000}) {
+        auto items = randomItems(n, static_cast<unsigned>(n) + 1);
+        sort(items.begin(), items.end());
+        items.erase(unique(items.begin(), items.end(),
+                           [](const auto& a, const auto& b) { return a.first == b.first; }),
+                    items.end());
+        shuffle(items.begin(), items.end(), mt19937(3));
+
+        auto expected = items;
+        sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) {
+            return a.second > b.second || (a.second == b.second && a.first < b.first);
+        });
+
+        ParallelSort::byFrequency(items);
+        ASSERT_EQ(items, expected) << "n=" << n;
+    }
+}
+
+TEST(ParallelSortTest, TaskGroupsCanNest) {
+    ThreadPool pool(2);
+    atomic<int> total(0);
+    {
+        ThreadPool::TaskGroup outer(pool);
+        for (int i = 0; i < 8; i++) {
+            outer.run([&]() {
+                ThreadPool::TaskGroup inner(pool);
+                for (int j = 0; j < 8; j++) {
+                    inner.run([&]() { total++; });
+                }
+                inner.wait();
+            });
+        }
+        outer.wait();
+    }
+    EXPECT_EQ(total.load(), 64);
+}
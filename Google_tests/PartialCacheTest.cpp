@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+#include "../partialcache.h"
+#include <QTemporaryDir>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+
+static void writeFile(const string& path, const string& text) {
+    ofstream out(path, ios::binary);
+    out << text;
+}
+
+static PartialCache::Fingerprint fingerprintOf(const string& path, const string& text) {
+    PartialCache::Fingerprint fingerprint;
+    EXPECT_TRUE(PartialCache::stat(path, fingerprint));
+    PartialCache::ContentHasher hasher;
+    hasher.update(text.data(), text.size());
+    fingerprint.contentHash = hasher.value();
+    return fingerprint;
+}
+
+static PartialCache::Partial samplePartial() {
+    PartialCache::Partial partial;
+    partial.counts = {{"apple", 3}, {"applet", 1}, {"banana", 70000}, {"band", 2}};
+    partial.tokens = 70010;
+    return partial;
+}
+
+TEST(PartialCacheTest, HashDoesNotDependOnChunking) {
+    string text = "The quick brown fox jumps over the lazy dog, twice over.";
+    PartialCache::ContentHasher whole;
+    whole.update(text.data(), text.size());
+
+    for (size_t piece : {1, 3, 7, 8, 9}) {
+        PartialCache::ContentHasher chunked;
+        for (size_t i = 0; i < text.size(); i += piece) {
+            chunked.update(text.data() + i, min(piece, text.size() - i));
+        }
+        EXPECT_EQ(chunked.value(), whole.value()) << "piece=" << piece;
+    }
+
+    PartialCache::ContentHasher other;
+    other.update(text.data(), text.size() - 1);
+    EXPECT_NE(other.value(), whole.value());
+}
+
+TEST(PartialCacheTest, StoresAndLooksUpCounts) {
+    QTemporaryDir dir;
+    string source = dir.path().toStdString() + "/source.txt";
+    string text = "apple apple apple applet banana band band";
+    writeFile(source, text);
+
+    PartialCache cache(dir.path().toStdString() + "/cache");
+    PartialCache::Fingerprint fingerprint = fingerprintOf(source, text);
+    PartialCache::Partial stored = samplePartial();
+    ASSERT_TRUE(cache.store(source, fingerprint, stored));
+
+    PartialCache::Partial loaded;
+    ASSERT_TRUE(cache.lookup(source, fingerprint, loaded));
+    EXPECT_EQ(loaded.counts, stored.counts);
+    EXPECT_EQ(loaded.tokens, stored.tokens);
+
+    PartialCache::Partial missing;
+    EXPECT_FALSE(cache.lookup(dir.path().toStdString() + "/other.txt", fingerprint, missing));
+}
+
+TEST(PartialCacheTest, ChangedFileMisses) {
+    QTemporaryDir dir;
+    string source = dir.path().toStdString() + "/source.txt";
+    writeFile(source, "one two three");
+
+    PartialCache cache(dir.path().toStdString() + "/cache");
+    ASSERT_TRUE(cache.store(source, fingerprintOf(source, "one two three"), samplePartial()));
+
+    // Same size, different content and time.
+    writeFile(source, "one two thref");
+    PartialCache::Fingerprint current;
+    ASSERT_TRUE(PartialCache::stat(source, current));
+    current.modified += 1000000000;
+    PartialCache::Partial partial;
+    EXPECT_FALSE(cache.lookup(source, current, partial));
+
+    writeFile(source, "one two three four");
+    ASSERT_TRUE(PartialCache::stat(source, current));
+    EXPECT_FALSE(cache.lookup(source, current, partial));
+}
+
+TEST(PartialCacheTest, TouchedFileIsRevivedByContentHash) {
+    QTemporaryDir dir;
+    string source = dir.path().toStdString() + "/source.txt";
+    writeFile(source, "unchanged content");
+
+    PartialCache cache(dir.path().toStdString() + "/cache");
+    PartialCache::Fingerprint fingerprint = fingerprintOf(source, "unchanged content");
+    ASSERT_TRUE(cache.store(source, fingerprint, samplePartial()));
+
+    filesystem::last_write_time(source, filesystem::last_write_time(source) + chrono::hours(1));
+    PartialCache::Fingerprint touched;
+    ASSERT_TRUE(PartialCache::stat(source, touched));
+    ASSERT_NE(touched.modified, fingerprint.modified);
+
+    PartialCache::Partial partial;
+    ASSERT_TRUE(cache.lookup(source, touched, partial));
+    EXPECT_EQ(partial.counts, samplePartial().counts);
+
+    // The entry now carries the new time, so the content no longer matters.
+    writeFile(source, "different content");
+    PartialCache::Fingerprint rewritten;
+    ASSERT_TRUE(PartialCache::stat(source, rewritten));
+    rewritten.modified = touched.modified;
+    EXPECT_TRUE(cache.lookup(source, rewritten, partial));
+}
+
+TEST(PartialCacheTest, RejectsDamagedEntries) {
+    QTemporaryDir dir;
+    string source = dir.path().toStdString() + "/source.txt";
+    writeFile(source, "some words");
+    string cacheDirectory = dir.path().toStdString() + "/cache";
+
+    PartialCache cache(cacheDirectory);
+    PartialCache::Fingerprint fingerprint = fingerprintOf(source, "some words");
+    ASSERT_TRUE(cache.store(source, fingerprint, samplePartial()));
+
+    for (const auto& entry : filesystem::directory_iterator(cacheDirectory)) {
+        filesystem::resize_file(entry.path(), filesystem::file_size(entry.path()) - 3);
+    }
+    PartialCache::Partial partial;
+    EXPECT_FALSE(cache.lookup(source, fingerprint, partial));
+}
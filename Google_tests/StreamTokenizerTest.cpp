@@ -0,0 +1,40 @@
+#include "gtest/gtest.h"
+#include "../streamtokenizer.h"
+#include <vector>
+
+using namespace std;
+
+static vector<string> tokenize(const string& input, size_t chunkSize) {
+    StreamTokenizer tokenizer;
+    vector<string> tokens;
+    auto handler = [&](string_view token) { tokens.emplace_back(token); };
+    for (size_t i = 0; i < input.size(); i += chunkSize) {
+        tokenizer.feed(input.data() + i, min(chunkSize, input.size() - i), handler);
+    }
+    tokenizer.finish(handler);
+    return tokens;
+}
+
+TEST(StreamTokenizerTest, JoinsTokensAcrossChunks) {
+    string input = "alpha  beta\tgamma\r\ndelta\n\nepsilon";
+    vector<string> expected = {"alpha", "beta", "gamma", "delta", "epsilon"};
+
+    for (size_t chunk : {1, 2, 3, 5, 7, 64}) {
+        EXPECT_EQ(tokenize(input, chunk), expected) << "chunk=" << chunk;
+    }
+}
+
+TEST(StreamTokenizerTest, IgnoresSeparatorRuns) {
+    EXPECT_TRUE(tokenize("", 4).empty());
+    EXPECT_TRUE(tokenize(" \r\n\t\v\f ", 2).empty());
+    EXPECT_EQ(tokenize("\r\none\r\n", 3), vector<string>{"one"});
+}
+
+TEST(StreamTokenizerTest, TruncatesOverlongTokens) {
+    string huge(StreamTokenizer::MaxTokenLength * 3, 'x');
+    vector<string> tokens = tokenize(huge + " tail", 4096);
+
+    ASSERT_EQ(tokens.size(), 2);
+    EXPECT_EQ(tokens[0].size(), StreamTokenizer::MaxTokenLength);
+    EXPECT_EQ(tokens[1], "tail");
+}
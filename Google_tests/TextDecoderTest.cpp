@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+#include "../textdecoder.h"
+#include <string>
+
+using namespace std;
+
+static const string Russian = "Привет, мир! Ёлка №5 — ёж stays ASCII";
+
+// Russian in CP1251.
+static const string Cp1251Text =
+    "\xCF\xF0\xE8\xE2\xE5\xF2, \xEC\xE8\xF0! \xA8\xEB\xEA\xE0 \xB9" "5 \x97 \xB8\xE6 stays ASCII";
+
+static string toUtf16(const u16string& text, bool bigEndian, bool bom) {
+    string bytes;
+    if (bom) bytes += bigEndian ? "\xFE\xFF" : "\xFF\xFE";
+    for (char16_t unit : text) {
+        char high = static_cast<char>(unit >> 8);
+        char low = static_cast<char>(unit & 0xFF);
+        bytes += bigEndian ? string{high, low} : string{low, high};
+    }
+    return bytes;
+}
+
+// The first chunk decides the encoding, so it is never cut below a usable
+// sample; an odd length makes UTF-16 units straddle every later boundary.
+static string decode(TextDecoder& decoder, const string& input, size_t chunkSize) {
+    string output;
+    auto append = [&](const char* data, size_t size) { output.append(data, size); };
+    size_t first = min(input.size(), max<size_t>(chunkSize, 63));
+    decoder.feed(input.data(), first, append);
+    for (size_t i = first; i < input.size(); i += chunkSize) {
+        decoder.feed(input.data() + i, min(chunkSize, input.size() - i), append);
+    }
+    return output;
+}
+
+TEST(TextDecoderTest, DetectsByteOrderMarks) {
+    EXPECT_EQ(TextDecoder::detect("\xEF\xBB\xBFtext", 7), TextDecoder::Utf8);
+    EXPECT_EQ(TextDecoder::detect("\xFF\xFEt\0", 4), TextDecoder::Utf16LE);
+    EXPECT_EQ(TextDecoder::detect("\xFE\xFF\0t", 4), TextDecoder::Utf16BE);
+}
+
+TEST(TextDecoderTest, DetectsFromStatistics) {
+    EXPECT_EQ(TextDecoder::detect(Russian.data(), Russian.size()), TextDecoder::Utf8);
+    EXPECT_EQ(TextDecoder::detect(Cp1251Text.data(), Cp1251Text.size()), TextDecoder::Cp1251);
+    EXPECT_EQ(TextDecoder::detect("plain ascii", 11), TextDecoder::Utf8);
+
+    string little = toUtf16(u"Привет, world", false, false);
+    string big = toUtf16(u"Привет, world", true, false);
+    EXPECT_EQ(TextDecoder::detect(little.data(), little.size()), TextDecoder::Utf16LE);
+    EXPECT_EQ(TextDecoder::detect(big.data(), big.size()), TextDecoder::Utf16BE);
+
+    // A UTF-8 sequence cut off by the end of the sample is still UTF-8.
+    string cut = "abc" + Russian.substr(0, 1);
+    EXPECT_EQ(TextDecoder::detect(cut.data(), cut.size()), TextDecoder::Utf8);
+}
+
+TEST(TextDecoderTest, PassesUtf8ThroughWithoutCopying) {
+    string input = "\xEF\xBB\xBF" + Russian;
+    TextDecoder decoder;
+    const char* seen = nullptr;
+    size_t seenSize = 0;
+    decoder.feed(input.data(), input.size(), [&](const char* data, size_t size) {
+        seen = data;
+        seenSize = size;
+    });
+
+    EXPECT_EQ(decoder.encoding(), TextDecoder::Utf8);
+    EXPECT_EQ(seen, input.data() + 3);
+    EXPECT_EQ(seenSize, Russian.size());
+}
+
+TEST(TextDecoderTest, ConvertsCp1251) {
+    // Long enough for the ASCII runs to take the vector path.
+    string input;
+    string expected;
+    for (int i = 0; i < 20; i++) {
+        input += Cp1251Text + " and a rather long ASCII tail to copy in blocks\n";
+        expected += Russian + " and a rather long ASCII tail to copy in blocks\n";
+    }
+
+    for (size_t chunk : {1, 5, 64, 100000}) {
+        TextDecoder decoder;
+        EXPECT_EQ(decode(decoder, input, chunk), expected) << "chunk=" << chunk;
+        EXPECT_EQ(decoder.encoding(), TextDecoder::Cp1251);
+    }
+    TextDecoder forced(TextDecoder::Cp1251);
+    EXPECT_EQ(decode(forced, "\x88\x98", 2), "€\xEF\xBF\xBD");
+}
+
+TEST(TextDecoderTest, ConvertsUtf16AcrossChunks) {
+    u16string text;
+    string expected;
+    for (int i = 0; i < 10; i++) {
+        text += u"Привет, мир! Ёж 😀 and some ASCII text for the vector path\n";
+        expected += "Привет, мир! Ёж 😀 and some ASCII text for the vector path\n";
+    }
+
+    for (bool bigEndian : {false, true}) {
+        string input = toUtf16(text, bigEndian, true);
+        for (size_t chunk : {1, 3, 7, 16, 100000}) {
+            TextDecoder decoder;
+            EXPECT_EQ(decode(decoder, input, chunk), expected) << "big=" << bigEndian << " chunk=" << chunk;
+            EXPECT_EQ(decoder.encoding(), bigEndian ? TextDecoder::Utf16BE : TextDecoder::Utf16LE);
+        }
+    }
+}
+
+TEST(TextDecoderTest, ReplacesLoneSurrogates) {
+    TextDecoder decoder(TextDecoder::Utf16LE);
+    string input = toUtf16(u"a", false, false) + string("\x00\xD8", 2) + toUtf16(u"b", false, false) +
+                   string("\x00\xDC", 2);
+    EXPECT_EQ(decode(decoder, input, 2), "a\xEF\xBF\xBD" "b\xEF\xBF\xBD");
+}
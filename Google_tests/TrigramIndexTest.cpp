@@ -0,0 +1,43 @@
+#include "gtest/gtest.h"
+#include "../trigramindex.h"
+
+using namespace std;
+
+TEST(TrigramIndexTest, CandidatesContainAllTrigrams) {
+    TrigramIndex index;
+    index.addWord(0, "telephone");
+    index.addWord(1, "television");
+    index.addWord(2, "hotel");
+    index.addWord(3, "phone");
+
+    vector<uint32_t> ids;
+    ASSERT_TRUE(index.candidates({"tele"}, ids));
+    EXPECT_EQ(ids, (vector<uint32_t>{0, 1}));
+
+    ASSERT_TRUE(index.candidates({"phone"}, ids));
+    EXPECT_EQ(ids, (vector<uint32_t>{0, 3}));
+
+    ASSERT_TRUE(index.candidates({"xyz"}, ids));
+    EXPECT_TRUE(ids.empty());
+
+    EXPECT_FALSE(index.candidates({"te"}, ids));
+}
+
+TEST(TrigramIndexTest, LargeIdGapsSurviveEncoding) {
+    TrigramIndex index;
+    index.addWord(5, "abcd");
+    index.addWord(300, "abce");
+    index.addWord(70000, "zabc");
+
+    vector<uint32_t> ids;
+    ASSERT_TRUE(index.candidates({"abc"}, ids));
+    EXPECT_EQ(ids, (vector<uint32_t>{5, 300, 70000}));
+}
+
+TEST(TrigramIndexTest, RequiredLiteralsFromRegex) {
+    EXPECT_EQ(TrigramIndex::requiredLiterals("^tele.*on$"), (vector<string>{"tele"}));
+    EXPECT_EQ(TrigramIndex::requiredLiterals("abcd?ef"), (vector<string>{"abc"}));
+    EXPECT_EQ(TrigramIndex::requiredLiterals("[a-z]+ing"), (vector<string>{"ing"}));
+    EXPECT_EQ(TrigramIndex::requiredLiterals("(foo|bar)baz"), (vector<string>{"baz"}));
+    EXPECT_TRUE(TrigramIndex::requiredLiterals("foo|bar").empty());
+}
@@ -0,0 +1,53 @@
+#include "gtest/gtest.h"
+#include "../wordcountreader.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+
+static vector<pair<string, int>> readEntries(const string& path, const string& text) {
+    ofstream(path, ios::binary) << text;
+    QFile file(QString::fromStdString(path));
+    EXPECT_TRUE(file.open(QIODevice::ReadOnly));
+    vector<pair<string, int>> entries;
+    EXPECT_TRUE(WordCountReader::read(file, [&](const string& word, int count) {
+        entries.emplace_back(word, count);
+    }));
+    return entries;
+}
+
+TEST(WordCountReaderTest, CrlfReadsLikeLf) {
+    QTemporaryDir dir;
+    string lf = "apple 3\nbanana\t17\n\n  cherry 5\nпривет 2";
+    string crlf = "apple 3\r\nbanana\t17\r\n\r\n  cherry 5\r\nпривет 2";
+
+    vector<pair<string, int>> expected = {{"apple", 3}, {"banana", 17}, {"cherry", 5}, {"привет", 2}};
+    EXPECT_EQ(readEntries(dir.path().toStdString() + "/lf.txt", lf), expected);
+    EXPECT_EQ(readEntries(dir.path().toStdString() + "/crlf.txt", crlf), expected);
+}
+
+TEST(WordCountReaderTest, SkipsMalformedLines) {
+    QTemporaryDir dir;
+    string text = "apple 3\nbroken\nbanana 5\nx y\ncherry 2 extra\ndate 4\n12abc 7\n";
+
+    vector<pair<string, int>> expected = {{"apple", 3}, {"banana", 5}, {"cherry", 2}, {"date", 4}, {"12abc", 7}};
+    EXPECT_EQ(readEntries(dir.path().toStdString() + "/broken.txt", text), expected);
+}
+
+TEST(WordCountReaderTest, EntriesSpanReadBlocks) {
+    QTemporaryDir dir;
+    string text;
+    int lines = 0;
+    while (text.size() < 3 * WordCountReader::ReadBufferSize) {
+        text += "word" + to_string(lines) + " " + to_string(lines) + "\r\n";
+        lines++;
+    }
+
+    vector<pair<string, int>> entries = readEntries(dir.path().toStdString() + "/large.txt", text);
+    ASSERT_EQ(entries.size(), static_cast<size_t>(lines));
+    for (int i = 0; i < lines; i++) {
+        ASSERT_EQ(entries[i], make_pair("word" + to_string(i), i));
+    }
+}
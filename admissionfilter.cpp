@@ -0,0 +1,108 @@
+#include "admissionfilter.h"
+#include "wordhashindex.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+constexpr unsigned CounterMax = 15;
+
+}
+
+AdmissionFilter::AdmissionFilter(size_t expectedWords, double falsePositiveRate) {
+    const double n = static_cast<double>(max<size_t>(expectedWords, 64));
+    const double p = clamp(falsePositiveRate, 1e-6, 0.5);
+    const double ln2 = log(2.0);
+
+    counterTotal = static_cast<size_t>(ceil(-n * log(p) / (ln2 * ln2)));
+    hashes = clamp(static_cast<int>(lround(static_cast<double>(counterTotal) / n * ln2)), 1, 16);
+    counters.assign((counterTotal + 1) / 2, 0);
+    clear();
+}
+
+bool AdmissionFilter::admit(uint64_t hash) {
+    bool seen = true;
+    for (int i = 0; i < hashes && seen; i++) {
+        seen = counterAt(position(hash, i)) != 0;
+    }
+
+    if (seen) {
+        for (int i = 0; i < hashes; i++) {
+            size_t index = position(hash, i);
+            unsigned value = counterAt(index);
+            if (value == 0 || value == CounterMax) continue;
+            setCounter(index, value - 1);
+            if (value == 1) nonZero--;
+        }
+        if (pendingWords > 0) pendingWords--;
+        admittedWords++;
+        return true;
+    }
+
+    double rate = falsePositiveRate();
+    falseAdmissions += rate / (1.0 - min(rate, 0.999));
+
+    for (int i = 0; i < hashes; i++) {
+        size_t index = position(hash, i);
+        unsigned value = counterAt(index);
+        if (value == CounterMax) continue;
+        setCounter(index, value + 1);
+        if (value == 0) nonZero++;
+    }
+    pendingWords++;
+    return false;
+}
+
+void AdmissionFilter::clear() {
+    fill(counters.begin(), counters.end(), 0);
+    nonZero = 0;
+    pendingWords = 0;
+    admittedWords = 0;
+    falseAdmissions = 0.0;
+}
+
+size_t AdmissionFilter::pending() const {
+    return pendingWords;
+}
+
+uint64_t AdmissionFilter::admitted() const {
+    return admittedWords;
+}
+
+double AdmissionFilter::expectedFalseAdmissions() const {
+    return falseAdmissions;
+}
+
+double AdmissionFilter::falsePositiveRate() const {
+    return pow(static_cast<double>(nonZero) / static_cast<double>(counterTotal), hashes);
+}
+
+int AdmissionFilter::hashCount() const {
+    return hashes;
+}
+
+size_t AdmissionFilter::counterCount() const {
+    return counterTotal;
+}
+
+size_t AdmissionFilter::memoryUsage() const {
+    return counters.capacity();
+}
+
+size_t AdmissionFilter::position(uint64_t hash, int i) const {
+    // Double hashing: the second hash is forced odd so the probes differ.
+    uint64_t second = mixHash(hash) | 1;
+    return static_cast<size_t>((hash + static_cast<uint64_t>(i) * second) % counterTotal);
+}
+
+unsigned AdmissionFilter::counterAt(size_t index) const {
+    return (counters[index / 2] >> (index % 2 * 4)) & 0x0f;
+}
+
+void AdmissionFilter::setCounter(size_t index, unsigned value) {
+    uint8_t& byte = counters[index / 2];
+    unsigned shift = index % 2 * 4;
+    byte = static_cast<uint8_t>((byte & ~(0x0f << shift)) | (value << shift));
+}
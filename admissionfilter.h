@@ -0,0 +1,55 @@
+#ifndef ADMISSIONFILTER_H
+#define ADMISSIONFILTER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Counting Bloom filter with 4-bit counters that holds the first sighting of
+// words not yet stored exactly. admit() records an unseen hash and reports it
+// as new; on a repeat sighting it reports the word as seen and removes it
+// again, so the filter only carries pending singletons and its false positive
+// rate follows their number rather than the whole vocabulary. A false
+// positive admits a new word one sighting early; removing it then can also
+// clear one pending word, which is held back for one more sighting.
+class AdmissionFilter {
+public:
+    explicit AdmissionFilter(size_t expectedWords, double falsePositiveRate = 0.01);
+
+    bool admit(uint64_t hash);
+
+    void clear();
+
+    size_t pending() const;
+
+    uint64_t admitted() const;
+
+    // Estimated words admitted on their first sighting because of false positives.
+    double expectedFalseAdmissions() const;
+
+    // False positive probability for a new word at the current fill.
+    double falsePositiveRate() const;
+
+    int hashCount() const;
+
+    size_t counterCount() const;
+
+    size_t memoryUsage() const;
+
+private:
+    vector<uint8_t> counters;
+    size_t counterTotal;
+    int hashes;
+    size_t nonZero;
+    size_t pendingWords;
+    uint64_t admittedWords;
+    double falseAdmissions;
+
+    size_t position(uint64_t hash, int i) const;
+    unsigned counterAt(size_t index) const;
+    void setCounter(size_t index, unsigned value);
+};
+
+#endif // ADMISSIONFILTER_H
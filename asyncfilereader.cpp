@@ -0,0 +1,415 @@
+#include "asyncfilereader.h"
+#include "boundedqueue.h"
+#include "logger.h"
+#include <thread>
+#include <stdexcept>
+#include <exception>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ASYNCFILEREADER_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+using namespace std;
+
+struct ReadRequest {
+    int fd;
+    char* data;
+    size_t size;
+    uint64_t offset;
+    uint32_t buffer;
+    uint64_t tag;
+};
+
+struct ReadCompletion {
+    uint64_t tag;
+    int64_t result;
+};
+
+class ReadBackend {
+public:
+    virtual ~ReadBackend() = default;
+
+    virtual void submit(const ReadRequest& request) = 0;
+
+    // Blocks until at least one submitted read has finished.
+    virtual void wait(vector<ReadCompletion>& completions) = 0;
+};
+
+namespace {
+
+constexpr size_t NoBuffer = SIZE_MAX;
+
+#ifdef ASYNCFILEREADER_IO_URING
+// Talks to the kernel directly through the io_uring system calls, so no
+// liburing is needed.
+class IoUringBackend : public ReadBackend {
+public:
+    ~IoUringBackend() override {
+        if (sqes) munmap(sqes, sqesSize);
+        if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing) munmap(sqRing, sqRingSize);
+        if (ringFd >= 0) close(ringFd);
+    }
+
+    bool init(unsigned entries, const vector<char*>& buffers, size_t bufferSize) {
+        io_uring_params params = {};
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ringFd < 0) return false;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMap) sqRingSize = cqRingSize = max(sqRingSize, cqRingSize);
+
+        sqRing = mapRing(sqRingSize, IORING_OFF_SQ_RING);
+        cqRing = singleMap ? sqRing : mapRing(cqRingSize, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mapRing(sqesSize, IORING_OFF_SQES));
+        if (!sqRing || !cqRing || !sqes) return false;
+
+        char* sq = static_cast<char*>(sqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        char* cq = static_cast<char*>(cqRing);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // Registered buffers spare the kernel pinning pages on every read;
+        // a low memlock limit only costs that optimisation.
+        vector<iovec> vectors;
+        for (char* buffer : buffers) vectors.push_back(iovec{buffer, bufferSize});
+        fixedBuffers = syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS,
+                               vectors.data(), static_cast<unsigned>(vectors.size())) == 0;
+        return true;
+    }
+
+    void submit(const ReadRequest& request) override {
+        unsigned tail = *sqTail;
+        unsigned index = tail & sqMask;
+
+        io_uring_sqe& sqe = sqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = fixedBuffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe.fd = request.fd;
+        sqe.addr = reinterpret_cast<uint64_t>(request.data);
+        sqe.len = static_cast<uint32_t>(request.size);
+        sqe.off = request.offset;
+        sqe.buf_index = static_cast<uint16_t>(request.buffer);
+        sqe.user_data = request.tag;
+
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        unsubmitted++;
+    }
+
+    void wait(vector<ReadCompletion>& completions) override {
+        while (true) {
+            long submitted = syscall(__NR_io_uring_enter, ringFd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (submitted >= 0) {
+                unsubmitted -= min<unsigned>(unsubmitted, static_cast<unsigned>(submitted));
+                break;
+            }
+            if (errno != EINTR) throw runtime_error(string("io_uring_enter: ") + strerror(errno));
+        }
+
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = cqes[head & cqMask];
+            completions.push_back(ReadCompletion{cqe.user_data, cqe.res});
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    bool usesFixedBuffers() const {
+        return fixedBuffers;
+    }
+
+private:
+    int ringFd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned unsubmitted = 0;
+    bool fixedBuffers = false;
+
+    void* mapRing(size_t size, off_t offset) {
+        void* ring = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+        return ring == MAP_FAILED ? nullptr : ring;
+    }
+};
+#endif
+
+class PreadBackend : public ReadBackend {
+public:
+    PreadBackend(size_t threads, size_t depth) : requests(depth), completions(depth) {
+        for (size_t i = 0; i < threads; i++) {
+            workers.emplace_back([this]() {
+                ReadRequest request;
+                while (requests.pop(request)) {
+                    completions.push(ReadCompletion{request.tag, readFully(request)});
+                }
+            });
+        }
+    }
+
+    ~PreadBackend() override {
+        requests.close();
+        completions.close();
+        for (auto& worker : workers) worker.join();
+    }
+
+    void submit(const ReadRequest& request) override {
+        requests.push(request);
+    }
+
+    void wait(vector<ReadCompletion>& completed) override {
+        ReadCompletion completion;
+        if (!completions.pop(completion)) return;
+        completed.push_back(completion);
+        while (completions.tryPop(completion)) completed.push_back(completion);
+    }
+
+private:
+    BoundedQueue<ReadRequest> requests;
+    BoundedQueue<ReadCompletion> completions;
+    vector<thread> workers;
+
+    static int64_t readFully(const ReadRequest& request) {
+        size_t total = 0;
+        while (total < request.size) {
+            ssize_t bytesRead = pread(request.fd, request.data + total, request.size - total,
+                                      static_cast<off_t>(request.offset + total));
+            if (bytesRead < 0) {
+                if (errno == EINTR) continue;
+                return -errno;
+            }
+            if (bytesRead == 0) break;
+            total += static_cast<size_t>(bytesRead);
+        }
+        return static_cast<int64_t>(total);
+    }
+};
+
+}
+
+AsyncFileReader::AsyncFileReader(Backend backend, size_t blockSize, size_t depth)
+    : blockSize(max<size_t>(blockSize, 4096)), depth(max<size_t>(depth, 1)), active(Pread) {
+    size_t bufferCount = this->depth * 2;
+    storage.resize(bufferCount * this->blockSize);
+    for (size_t i = 0; i < bufferCount; i++) {
+        buffers.push_back(storage.data() + i * this->blockSize);
+    }
+
+#ifdef ASYNCFILEREADER_IO_URING
+    if (backend != Pread) {
+        auto ring = make_unique<IoUringBackend>();
+        if (ring->init(static_cast<unsigned>(this->depth), buffers, this->blockSize)) {
+            Logger::log(Logger::Debug, string("io_uring reader ready") +
+                       (ring->usesFixedBuffers() ? " with registered buffers" : ""));
+            io = std::move(ring);
+            active = IoUring;
+        } else {
+            Logger::log(Logger::Info, "io_uring unavailable, reading with pread threads");
+        }
+    }
+#else
+    (void)backend;
+#endif
+
+    if (!io) io = make_unique<PreadBackend>(PreadThreads, this->depth);
+}
+
+AsyncFileReader::~AsyncFileReader() = default;
+
+AsyncFileReader::Backend AsyncFileReader::backend() const {
+    return active;
+}
+
+string AsyncFileReader::backendName(Backend backend) {
+    switch (backend) {
+    case Auto: return "auto";
+    case IoUring: return "io_uring";
+    case Pread: return "pread";
+    }
+    return "unknown";
+}
+
+bool AsyncFileReader::read(const vector<string>& paths, const BlockHandler& handler) {
+    struct Slot {
+        size_t file;
+        uint64_t offset;
+        size_t buffer;
+        int fd;
+        bool last;
+        bool completed;
+        bool failed;
+        size_t requested;
+        size_t size;
+    };
+
+    struct Ready {
+        Block block;
+        size_t buffer;
+    };
+
+    // Reads finish in any order but are handed over by sequence number; the
+    // window keeps every slot between the next one to hand over and the
+    // newest one in a fixed ring.
+    const size_t window = buffers.size();
+    vector<Slot> slots(window);
+    BoundedQueue<size_t> freeBuffers(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) freeBuffers.push(i);
+    BoundedQueue<Ready> ready(window);
+
+    bool failed = false;
+    exception_ptr ioError;
+
+    thread ioThread([&]() {
+        vector<ReadCompletion> completions;
+        completions.reserve(depth);
+        uint64_t nextSequence = 0;
+        uint64_t nextToHand = 0;
+        size_t inFlight = 0;
+        size_t file = 0;
+        int fd = -1;
+        uint64_t fileSize = 0;
+        uint64_t offset = 0;
+        size_t spare = NoBuffer;
+        bool stopping = false;
+
+        auto addMarker = [&](bool markerFailed) {
+            slots[nextSequence % window] = Slot{file, 0, NoBuffer, -1, true, true, markerFailed, 0, 0};
+            nextSequence++;
+            file++;
+        };
+
+        try {
+            while (true) {
+                while (!stopping && file < paths.size() && inFlight < depth && nextSequence - nextToHand < window) {
+                    if (fd < 0) {
+                        fd = open(paths[file].c_str(), O_RDONLY | O_CLOEXEC);
+                        struct stat info;
+                        if (fd < 0 || fstat(fd, &info) != 0) {
+                            Logger::log(Logger::Error, "Failed to open file: " + paths[file]);
+                            if (fd >= 0) close(fd);
+                            fd = -1;
+                            addMarker(true);
+                            continue;
+                        }
+                        fileSize = static_cast<uint64_t>(info.st_size);
+                        offset = 0;
+                        if (fileSize == 0) {
+                            close(fd);
+                            fd = -1;
+                            addMarker(false);
+                            continue;
+                        }
+                    }
+
+                    if (spare == NoBuffer && !freeBuffers.tryPop(spare)) break;
+
+                    size_t size = static_cast<size_t>(min<uint64_t>(blockSize, fileSize - offset));
+                    bool last = offset + size >= fileSize;
+                    slots[nextSequence % window] = Slot{file, offset, spare, fd, last, false, false, size, 0};
+                    io->submit(ReadRequest{fd, buffers[spare], size, offset, static_cast<uint32_t>(spare), nextSequence});
+                    nextSequence++;
+                    inFlight++;
+                    spare = NoBuffer;
+                    offset += size;
+                    if (last) {
+                        // Closed when this read completes.
+                        fd = -1;
+                        file++;
+                    }
+                }
+
+                while (nextToHand < nextSequence && slots[nextToHand % window].completed) {
+                    const Slot& slot = slots[nextToHand % window];
+                    Block block{slot.file, slot.offset, slot.buffer == NoBuffer ? nullptr : buffers[slot.buffer],
+                                slot.size, slot.last, slot.failed};
+                    if (slot.failed) failed = true;
+                    if (!stopping && !ready.push(Ready{block, slot.buffer})) stopping = true;
+                    nextToHand++;
+                }
+
+                if (inFlight > 0) {
+                    completions.clear();
+                    io->wait(completions);
+                    for (const ReadCompletion& completion : completions) {
+                        Slot& slot = slots[completion.tag % window];
+                        // io_uring may return fewer bytes than asked for; like
+                        // pread, the rest is read until the block is full or
+                        // the file ends.
+                        if (completion.result > 0 && slot.size + static_cast<size_t>(completion.result) < slot.requested) {
+                            slot.size += static_cast<size_t>(completion.result);
+                            io->submit(ReadRequest{slot.fd, buffers[slot.buffer] + slot.size, slot.requested - slot.size,
+                                                   slot.offset + slot.size, static_cast<uint32_t>(slot.buffer),
+                                                   completion.tag});
+                            continue;
+                        }
+                        slot.completed = true;
+                        slot.failed = completion.result < 0;
+                        slot.size = slot.failed ? 0 : slot.size + static_cast<size_t>(completion.result);
+                        if (slot.failed) {
+                            Logger::log(Logger::Error, "Read error on file: " + paths[slot.file] + ": " +
+                                       strerror(static_cast<int>(-completion.result)));
+                        }
+                        if (slot.last) close(slot.fd);
+                        inFlight--;
+                    }
+                } else if (!stopping && file < paths.size() && nextToHand == nextSequence) {
+                    if (spare == NoBuffer && !freeBuffers.pop(spare)) stopping = true;
+                } else if (stopping || (file >= paths.size() && nextToHand == nextSequence)) {
+                    break;
+                }
+            }
+        } catch (...) {
+            ioError = current_exception();
+        }
+
+        if (fd >= 0) close(fd);
+        ready.close();
+    });
+
+    try {
+        Ready item;
+        while (ready.pop(item)) {
+            handler(item.block);
+            if (item.buffer != NoBuffer) freeBuffers.push(item.buffer);
+        }
+    } catch (...) {
+        ready.close();
+        freeBuffers.close();
+        ioThread.join();
+        throw;
+    }
+    ioThread.join();
+
+    if (ioError) rethrow_exception(ioError);
+    return !failed;
+}
@@ -0,0 +1,75 @@
+#ifndef ASYNCFILEREADER_H
+#define ASYNCFILEREADER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+class ReadBackend;
+
+// Reads whole files in large blocks with several reads in flight at once,
+// spanning file boundaries, on a dedicated I/O thread. On Linux the reads
+// go through io_uring with registered buffers; where io_uring is missing
+// or refused, a few pread() threads take its place. The buffers are
+// allocated once per reader and circulate between the I/O thread and the
+// caller, so reading allocates nothing per block.
+class AsyncFileReader {
+public:
+    enum Backend {
+        Auto,
+        IoUring,
+        Pread
+    };
+
+    struct Block {
+        size_t file;
+        uint64_t offset;
+        const char* data;
+        size_t size;
+        // Set on the final block of each file, which may be empty.
+        bool lastOfFile;
+        bool failed;
+    };
+
+    using BlockHandler = function<void(const Block&)>;
+
+    static constexpr size_t DefaultBlockSize = 1 << 20;
+    static constexpr size_t DefaultDepth = 8;
+    static constexpr size_t PreadThreads = 4;
+
+    // Auto tries io_uring first. depth is the number of reads in flight;
+    // twice as many buffers are allocated, so the caller can work on
+    // blocks while the next ones load.
+    explicit AsyncFileReader(Backend backend = Auto, size_t blockSize = DefaultBlockSize,
+                             size_t depth = DefaultDepth);
+    ~AsyncFileReader();
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    // The backend actually in use, never Auto.
+    Backend backend() const;
+
+    static string backendName(Backend backend);
+
+    // handler runs on the calling thread for every block, in file and
+    // offset order. False if any file could not be opened or read; its
+    // blocks then carry failed. An exception from handler stops the reads
+    // and is rethrown.
+    bool read(const vector<string>& paths, const BlockHandler& handler);
+
+private:
+    size_t blockSize;
+    size_t depth;
+    vector<char> storage;
+    vector<char*> buffers;
+    unique_ptr<ReadBackend> io;
+    Backend active;
+};
+
+#endif // ASYNCFILEREADER_H
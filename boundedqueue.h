@@ -0,0 +1,80 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+using namespace std;
+
+// Blocking FIFO of at most capacity items connecting producer and consumer
+// threads, any number on either side. The items live in a ring allocated
+// once, so a full queue holds the producers back instead of growing.
+// close() wakes both sides: push() then fails, pop() drains what is left
+// and then fails.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : ring(capacity == 0 ? 1 : capacity) {}
+
+    bool push(T item) {
+        unique_lock<mutex> lock(queueMutex);
+        notFull.wait(lock, [this]() { return closed || count < ring.size(); });
+        if (closed) return false;
+
+        ring[(head + count) % ring.size()] = std::move(item);
+        count++;
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        unique_lock<mutex> lock(queueMutex);
+        notEmpty.wait(lock, [this]() { return closed || count > 0; });
+        if (count == 0) return false;
+
+        take(item);
+        notFull.notify_one();
+        return true;
+    }
+
+    // Like pop(), but returns false at once instead of waiting for an item.
+    bool tryPop(T& item) {
+        lock_guard<mutex> lock(queueMutex);
+        if (count == 0) return false;
+
+        take(item);
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        lock_guard<mutex> lock(queueMutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    bool isClosed() const {
+        lock_guard<mutex> lock(queueMutex);
+        return closed;
+    }
+
+private:
+    vector<T> ring;
+    size_t head = 0;
+    size_t count = 0;
+    mutable mutex queueMutex;
+    condition_variable notFull;
+    condition_variable notEmpty;
+    bool closed = false;
+
+    void take(T& item) {
+        item = std::move(ring[head]);
+        head = (head + 1) % ring.size();
+        count--;
+    }
+};
+
+#endif // BOUNDEDQUEUE_H
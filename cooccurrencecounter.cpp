@@ -0,0 +1,297 @@
+#include "cooccurrencecounter.h"
+#include "logger.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <queue>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+const char TripletMagic[4] = {'C', 'O', 'O', 'C'};
+const uint32_t TripletVersion = 1;
+const size_t PendingFlushSize = 1 << 20;
+const size_t TripletBytes = 3 * sizeof(uint32_t);
+const size_t TripletReadBatch = 4096;
+
+void putLittleEndian(char* data, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; i++) {
+        data[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+uint64_t getLittleEndian(const char* data, size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; i++) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+size_t partitionOf(uint64_t key, size_t partitionCount) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return static_cast<size_t>(key % partitionCount);
+}
+
+vector<pair<uint64_t, uint32_t>> sortedEntries(const unordered_map<uint64_t, uint32_t>& table) {
+    vector<pair<uint64_t, uint32_t>> entries(table.begin(), table.end());
+    sort(entries.begin(), entries.end());
+    return entries;
+}
+
+class RunReader {
+public:
+    explicit RunReader(const string& path) : in(path, ios::binary) {}
+
+    bool next(pair<uint64_t, uint32_t>& entry) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&entry.first), sizeof(entry.first)) &&
+                                 in.read(reinterpret_cast<char*>(&entry.second), sizeof(entry.second)));
+    }
+
+private:
+    ifstream in;
+};
+
+}
+
+CooccurrenceCounter::CooccurrenceCounter(int window, int threads, size_t maxPairsInMemory,
+                                         const string& spillDirectory)
+    : windowSize(max(window, 1)),
+      partitionCount(threads > 0 ? threads : max(1u, thread::hardware_concurrency())),
+      memoryBudget(max<size_t>(maxPairsInMemory, 1)),
+      spillDir(spillDirectory.empty() ? filesystem::temp_directory_path().string() : spillDirectory),
+      runPrefix(to_string(random_device{}())),
+      recent(windowSize, 0),
+      recentStart(0),
+      pendingSize(0),
+      pending(partitionCount),
+      partitions(partitionCount) {
+}
+
+CooccurrenceCounter::~CooccurrenceCounter() {
+    removeRuns();
+}
+
+void CooccurrenceCounter::push(uint32_t wordId) {
+    size_t window = min(recentStart, static_cast<size_t>(windowSize));
+    for (size_t i = 1; i <= window; i++) {
+        uint32_t context = recent[(recentStart - i) % windowSize];
+        add(context, wordId);
+        add(wordId, context);
+    }
+
+    recent[recentStart % windowSize] = wordId;
+    recentStart++;
+
+    if (pendingSize >= PendingFlushSize) flush();
+}
+
+void CooccurrenceCounter::reset() {
+    recentStart = 0;
+}
+
+void CooccurrenceCounter::flush() {
+    if (pendingSize == 0) return;
+
+    ThreadPool::TaskGroup group(ThreadPool::shared());
+    for (size_t p = 0; p < partitionCount; p++) {
+        group.run([this, p]() {
+            auto& table = partitions[p];
+            for (uint64_t key : pending[p]) {
+                table[key]++;
+            }
+            pending[p].clear();
+        });
+    }
+    group.wait();
+    pendingSize = 0;
+
+    if (pairsInMemory() > memoryBudget) spill();
+}
+
+bool CooccurrenceCounter::exportTriplets(const string& filePath) {
+    flush();
+
+    vector<RunReader> runs;
+    runs.reserve(runFiles.size());
+    for (const auto& runFile : runFiles) {
+        runs.emplace_back(runFile);
+    }
+
+    vector<vector<pair<uint64_t, uint32_t>>> memoryRuns;
+    for (const auto& table : partitions) {
+        memoryRuns.push_back(sortedEntries(table));
+    }
+
+    using Head = pair<pair<uint64_t, uint32_t>, size_t>;
+    priority_queue<Head, vector<Head>, greater<Head>> heads;
+    vector<size_t> memoryPositions(memoryRuns.size(), 0);
+
+    auto advance = [&](size_t source) {
+        pair<uint64_t, uint32_t> entry;
+        if (source < runs.size()) {
+            if (runs[source].next(entry)) heads.push({entry, source});
+        } else {
+            size_t m = source - runs.size();
+            if (memoryPositions[m] < memoryRuns[m].size()) {
+                heads.push({memoryRuns[m][memoryPositions[m]++], source});
+            }
+        }
+    };
+    for (size_t source = 0; source < runs.size() + memoryRuns.size(); source++) {
+        advance(source);
+    }
+
+    ofstream out(filePath, ios::binary | ios::trunc);
+    if (!out) {
+        Logger::log(Logger::Error, "Failed to open co-occurrence export file: " + filePath);
+        return false;
+    }
+
+    uint64_t total = 0;
+    char header[sizeof(TripletMagic) + sizeof(uint32_t) + sizeof(uint64_t)];
+    memcpy(header, TripletMagic, sizeof(TripletMagic));
+    putLittleEndian(header + sizeof(TripletMagic), TripletVersion, sizeof(uint32_t));
+    putLittleEndian(header + sizeof(TripletMagic) + sizeof(uint32_t), total, sizeof(uint64_t));
+    out.write(header, sizeof(header));
+
+    while (!heads.empty()) {
+        auto [entry, source] = heads.top();
+        heads.pop();
+        advance(source);
+
+        while (!heads.empty() && heads.top().first.first == entry.first) {
+            entry.second += heads.top().first.second;
+            size_t other = heads.top().second;
+            heads.pop();
+            advance(other);
+        }
+
+        char triplet[TripletBytes];
+        putLittleEndian(triplet, entry.first >> 32, sizeof(uint32_t));
+        putLittleEndian(triplet + sizeof(uint32_t), static_cast<uint32_t>(entry.first), sizeof(uint32_t));
+        putLittleEndian(triplet + 2 * sizeof(uint32_t), entry.second, sizeof(uint32_t));
+        out.write(triplet, sizeof(triplet));
+        total++;
+    }
+
+    char totalBytes[sizeof(uint64_t)];
+    putLittleEndian(totalBytes, total, sizeof(totalBytes));
+    out.seekp(sizeof(TripletMagic) + sizeof(uint32_t));
+    out.write(totalBytes, sizeof(totalBytes));
+    out.close();
+
+    if (!out) {
+        Logger::log(Logger::Error, "Failed to write co-occurrence export file: " + filePath);
+        return false;
+    }
+
+    Logger::log(Logger::Info, "Co-occurrences exported to: " + filePath +
+               ", pairs: " + to_string(total) + ", merged runs: " + to_string(runFiles.size()));
+    return true;
+}
+
+bool CooccurrenceCounter::readTriplets(const string& filePath, vector<Triplet>& triplets) {
+    ifstream in(filePath, ios::binary);
+    char header[sizeof(TripletMagic) + sizeof(uint32_t) + sizeof(uint64_t)];
+    if (!in.read(header, sizeof(header)) || !equal(header, header + sizeof(TripletMagic), TripletMagic) ||
+        getLittleEndian(header + sizeof(TripletMagic), sizeof(uint32_t)) != TripletVersion) {
+        return false;
+    }
+
+    // The count comes from the file; it has to fit in what the file holds.
+    uint64_t total = getLittleEndian(header + sizeof(TripletMagic) + sizeof(uint32_t), sizeof(uint64_t));
+    error_code error;
+    uint64_t fileSize = filesystem::file_size(filePath, error);
+    if (error || total > (fileSize - sizeof(header)) / TripletBytes) return false;
+
+    triplets.resize(total);
+    vector<char> buffer(TripletReadBatch * TripletBytes);
+    for (uint64_t done = 0; done < total;) {
+        size_t batch = static_cast<size_t>(min<uint64_t>(TripletReadBatch, total - done));
+        if (!in.read(buffer.data(), static_cast<streamsize>(batch * TripletBytes))) return false;
+        for (size_t i = 0; i < batch; i++) {
+            const char* data = buffer.data() + i * TripletBytes;
+            triplets[done + i] = Triplet{static_cast<uint32_t>(getLittleEndian(data, sizeof(uint32_t))),
+                                         static_cast<uint32_t>(getLittleEndian(data + sizeof(uint32_t), sizeof(uint32_t))),
+                                         static_cast<uint32_t>(getLittleEndian(data + 2 * sizeof(uint32_t), sizeof(uint32_t)))};
+        }
+        done += batch;
+    }
+    return true;
+}
+
+void CooccurrenceCounter::clear() {
+    for (auto& buffer : pending) buffer.clear();
+    for (auto& table : partitions) table.clear();
+    pendingSize = 0;
+    removeRuns();
+    reset();
+}
+
+int CooccurrenceCounter::window() const {
+    return windowSize;
+}
+
+size_t CooccurrenceCounter::pairsInMemory() const {
+    size_t total = 0;
+    for (const auto& table : partitions) {
+        total += table.size();
+    }
+    return total;
+}
+
+size_t CooccurrenceCounter::spilledRuns() const {
+    return runFiles.size();
+}
+
+void CooccurrenceCounter::add(uint32_t row, uint32_t column) {
+    uint64_t key = (static_cast<uint64_t>(row) << 32) | column;
+    pending[partitionOf(key, partitionCount)].push_back(key);
+    pendingSize++;
+}
+
+void CooccurrenceCounter::spill() {
+    vector<pair<uint64_t, uint32_t>> entries;
+    entries.reserve(pairsInMemory());
+    for (const auto& table : partitions) {
+        entries.insert(entries.end(), table.begin(), table.end());
+    }
+    sort(entries.begin(), entries.end());
+
+    string runFile = (filesystem::path(spillDir) /
+                      ("cooccurrence-" + runPrefix + "-" + to_string(runFiles.size()) + ".run")).string();
+    ofstream out(runFile, ios::binary | ios::trunc);
+    for (const auto& [key, count] : entries) {
+        out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+    out.close();
+
+    if (!out) {
+        Logger::log(Logger::Error, "Failed to spill co-occurrences to: " + runFile +
+                   ", keeping them in memory");
+        return;
+    }
+
+    for (auto& table : partitions) {
+        table = unordered_map<uint64_t, uint32_t>();
+    }
+    runFiles.push_back(runFile);
+    Logger::log(Logger::Debug, "Spilled " + to_string(entries.size()) + " co-occurrences to " + runFile);
+}
+
+void CooccurrenceCounter::removeRuns() {
+    for (const auto& runFile : runFiles) {
+        error_code ignored;
+        filesystem::remove(runFile, ignored);
+    }
+    runFiles.clear();
+}
@@ -0,0 +1,69 @@
+#ifndef COOCCURRENCECOUNTER_H
+#define COOCCURRENCECOUNTER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+// Sparse word co-occurrence accumulator over a sliding window of +-window
+// tokens. Pairs are buffered per hash partition and folded into per-partition
+// tables by tasks on the shared thread pool; when the tables outgrow the
+// memory budget they are spilled to sorted run files that are merged again on
+// export.
+class CooccurrenceCounter {
+public:
+    struct Triplet {
+        uint32_t row;
+        uint32_t column;
+        uint32_t count;
+    };
+
+    CooccurrenceCounter(int window = 5, int threads = 0, size_t maxPairsInMemory = 1 << 24,
+                        const string& spillDirectory = "");
+    ~CooccurrenceCounter();
+
+    void push(uint32_t wordId);
+
+    // Starts a new token sequence, so no pair spans the boundary.
+    void reset();
+
+    // Folds buffered pairs into the partition tables, spilling if needed.
+    void flush();
+
+    // Writes all pairs sorted by (row, column): "COOC", uint32 version,
+    // uint64 count, then count little-endian (row, column, count) uint32 triplets.
+    bool exportTriplets(const string& filePath);
+
+    static bool readTriplets(const string& filePath, vector<Triplet>& triplets);
+
+    void clear();
+
+    int window() const;
+
+    size_t pairsInMemory() const;
+
+    size_t spilledRuns() const;
+
+private:
+    int windowSize;
+    size_t partitionCount;
+    size_t memoryBudget;
+    string spillDir;
+    string runPrefix;
+
+    vector<uint32_t> recent;
+    size_t recentStart;
+    size_t pendingSize;
+    vector<vector<uint64_t>> pending;
+    vector<unordered_map<uint64_t, uint32_t>> partitions;
+    vector<string> runFiles;
+
+    void add(uint32_t row, uint32_t column);
+    void spill();
+    void removeRuns();
+};
+
+#endif // COOCCURRENCECOUNTER_H
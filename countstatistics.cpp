@@ -0,0 +1,115 @@
+#include "countstatistics.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+// Power of two covering every overflow index count - limit + 1 <= INT_MAX.
+constexpr uint64_t overflowSpan = uint64_t(1) << 31;
+
+}
+
+CountStatistics::CountStatistics(int histogramLimit)
+    : limit(max(histogramLimit, 2)), tree(limit, 0), total(0), overflowTotal(0) {
+}
+
+void CountStatistics::move(int from, int to) {
+    if (from == to) return;
+    if (from > 0) update(from, -1);
+    if (to > 0) update(to, 1);
+}
+
+void CountStatistics::clear() {
+    fill(tree.begin(), tree.end(), 0);
+    overflow.clear();
+    total = 0;
+    overflowTotal = 0;
+}
+
+size_t CountStatistics::wordCount() const {
+    return total;
+}
+
+size_t CountStatistics::countAtMost(int count) const {
+    if (count <= 0) return 0;
+    if (count < limit) return prefix(count);
+
+    return total - overflowTotal + overflowPrefix(count);
+}
+
+size_t CountStatistics::countInRange(int minCount, int maxCount) const {
+    if (maxCount < minCount) return 0;
+    return countAtMost(maxCount) - countAtMost(minCount - 1);
+}
+
+int CountStatistics::quantile(double q) const {
+    if (total == 0) return 0;
+
+    size_t k = static_cast<size_t>(ceil(clamp(q, 0.0, 1.0) * static_cast<double>(total)));
+    k = clamp<size_t>(k, 1, total);
+
+    if (k <= total - overflowTotal) {
+        // Descend the tree for the smallest count whose prefix reaches k.
+        size_t position = 0;
+        size_t step = 1;
+        while (step * 2 < tree.size()) step *= 2;
+        for (; step > 0; step /= 2) {
+            if (position + step < tree.size() && tree[position + step] < k) {
+                position += step;
+                k -= tree[position];
+            }
+        }
+        return static_cast<int>(position + 1);
+    }
+
+    // Same descent over the sparse overflow tree; absent nodes are empty.
+    k -= total - overflowTotal;
+    uint64_t position = 0;
+    for (uint64_t step = overflowSpan / 2; step > 0; step /= 2) {
+        size_t words = overflowNode(static_cast<uint32_t>(position + step));
+        if (words < k) {
+            position += step;
+            k -= words;
+        }
+    }
+    return static_cast<int>(position) + limit;
+}
+
+void CountStatistics::update(int count, int delta) {
+    total += delta;
+    if (count >= limit) {
+        overflowTotal += delta;
+        for (uint64_t i = static_cast<uint64_t>(count - limit) + 1; i < overflowSpan; i += i & (~i + 1)) {
+            auto& words = overflow[static_cast<uint32_t>(i)];
+            words += delta;
+            if (words == 0) overflow.erase(static_cast<uint32_t>(i));
+        }
+        return;
+    }
+    for (size_t i = static_cast<size_t>(count); i < tree.size(); i += i & (~i + 1)) {
+        tree[i] += delta;
+    }
+}
+
+size_t CountStatistics::prefix(int count) const {
+    size_t sum = 0;
+    for (size_t i = static_cast<size_t>(count); i > 0; i &= i - 1) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+size_t CountStatistics::overflowPrefix(int count) const {
+    size_t sum = 0;
+    for (uint64_t i = static_cast<uint64_t>(count - limit) + 1; i > 0; i &= i - 1) {
+        sum += overflowNode(static_cast<uint32_t>(i));
+    }
+    return sum;
+}
+
+size_t CountStatistics::overflowNode(uint32_t index) const {
+    auto it = overflow.find(index);
+    return it == overflow.end() ? 0 : it->second;
+}
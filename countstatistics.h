@@ -0,0 +1,47 @@
+#ifndef COUNTSTATISTICS_H
+#define COUNTSTATISTICS_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Histogram of word counts kept as a Fenwick tree for counts below
+// histogramLimit. Larger counts (few words, but any value up to INT_MAX) go
+// to a sparse Fenwick tree whose nodes live in a hash map, so only the nodes
+// on the paths of counts actually present are stored. Answers "how many words have count <= c" and the inverse quantile query in
+// logarithmic time while counts change one increment at a time.
+class CountStatistics {
+public:
+    explicit CountStatistics(int histogramLimit = 1 << 16);
+
+    // A word's count changed from `from` to `to`; 0 means absent.
+    void move(int from, int to);
+
+    void clear();
+
+    size_t wordCount() const;
+
+    size_t countAtMost(int count) const;
+
+    size_t countInRange(int minCount, int maxCount) const;
+
+    // Smallest count c such that at least fraction q of words have count <= c.
+    int quantile(double q) const;
+
+private:
+    int limit;
+    vector<uint32_t> tree;
+    unordered_map<uint32_t, size_t> overflow;
+    size_t total;
+    size_t overflowTotal;
+
+    void update(int count, int delta);
+    size_t prefix(int count) const;
+    size_t overflowPrefix(int count) const;
+    size_t overflowNode(uint32_t index) const;
+};
+
+#endif // COUNTSTATISTICS_H
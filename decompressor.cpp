@@ -0,0 +1,346 @@
+#include "decompressor.h"
+#include "boundedqueue.h"
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef DICTIONARY_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef DICTIONARY_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef DICTIONARY_HAVE_LZMA
+#include <lzma.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr size_t InputBufferSize = 1 << 18;
+
+bool startsWith(const char* data, size_t size, const char* magic, size_t magicSize) {
+    return size >= magicSize && memcmp(data, magic, magicSize) == 0;
+}
+
+#ifdef DICTIONARY_HAVE_ZLIB
+class GzipDecompressor : public Decompressor {
+public:
+    GzipDecompressor() {
+        // 15 + 32: largest window, gzip or zlib header detected automatically.
+        if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+            throw runtime_error("inflateInit2 failed");
+        }
+    }
+
+    ~GzipDecompressor() override {
+        inflateEnd(&stream);
+    }
+
+    void setInput(const char* data, size_t size) override {
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = static_cast<uInt>(size);
+    }
+
+    int64_t decompress(char* output, size_t capacity) override {
+        stream.next_out = reinterpret_cast<Bytef*>(output);
+        stream.avail_out = static_cast<uInt>(capacity);
+
+        while (stream.avail_out > 0) {
+            if (memberEnded) {
+                if (stream.avail_in == 0) break;
+                // Another gzip member follows.
+                inflateReset(&stream);
+                memberEnded = false;
+            }
+
+            int result = inflate(&stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END) {
+                memberEnded = true;
+            } else if (result == Z_BUF_ERROR) {
+                break;
+            } else if (result != Z_OK) {
+                error = stream.msg ? stream.msg : "inflate error " + to_string(result);
+                return -1;
+            }
+        }
+        return static_cast<int64_t>(capacity - stream.avail_out);
+    }
+
+    bool atStreamEnd() const override {
+        return memberEnded && stream.avail_in == 0;
+    }
+
+private:
+    z_stream stream = {};
+    bool memberEnded = false;
+};
+#endif
+
+#ifdef DICTIONARY_HAVE_ZSTD
+class ZstdDecompressor : public Decompressor {
+public:
+    ZstdDecompressor() : context(ZSTD_createDCtx()) {
+        if (!context) throw runtime_error("ZSTD_createDCtx failed");
+    }
+
+    ~ZstdDecompressor() override {
+        ZSTD_freeDCtx(context);
+    }
+
+    void setInput(const char* data, size_t size) override {
+        input = {data, size, 0};
+    }
+
+    int64_t decompress(char* output, size_t capacity) override {
+        ZSTD_outBuffer out = {output, capacity, 0};
+
+        while (out.pos < out.size) {
+            size_t inputBefore = input.pos;
+            size_t outputBefore = out.pos;
+
+            // Moves on to the next frame by itself.
+            size_t result = ZSTD_decompressStream(context, &out, &input);
+            if (ZSTD_isError(result)) {
+                error = ZSTD_getErrorName(result);
+                return -1;
+            }
+            frameEnded = result == 0;
+            if (input.pos == inputBefore && out.pos == outputBefore) break;
+        }
+        return static_cast<int64_t>(out.pos);
+    }
+
+    bool atStreamEnd() const override {
+        return frameEnded && input.pos == input.size;
+    }
+
+private:
+    ZSTD_DCtx* context;
+    ZSTD_inBuffer input = {nullptr, 0, 0};
+    bool frameEnded = false;
+};
+#endif
+
+#ifdef DICTIONARY_HAVE_LZMA
+class XzDecompressor : public Decompressor {
+public:
+    XzDecompressor() {
+        if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+            throw runtime_error("lzma_stream_decoder failed");
+        }
+    }
+
+    ~XzDecompressor() override {
+        lzma_end(&stream);
+    }
+
+    void setInput(const char* data, size_t size) override {
+        stream.next_in = reinterpret_cast<const uint8_t*>(data);
+        stream.avail_in = size;
+    }
+
+    // LZMA_CONCATENATED only reports the end once it is told no input follows.
+    void endInput() override {
+        finishing = true;
+    }
+
+    int64_t decompress(char* output, size_t capacity) override {
+        stream.next_out = reinterpret_cast<uint8_t*>(output);
+        stream.avail_out = capacity;
+
+        while (stream.avail_out > 0 && !ended) {
+            size_t inputBefore = stream.avail_in;
+            size_t outputBefore = stream.avail_out;
+
+            lzma_ret result = lzma_code(&stream, finishing ? LZMA_FINISH : LZMA_RUN);
+            if (result == LZMA_STREAM_END) {
+                ended = true;
+            } else if (result == LZMA_BUF_ERROR) {
+                break;
+            } else if (result != LZMA_OK) {
+                error = "xz decoder error " + to_string(static_cast<int>(result));
+                return -1;
+            }
+            if (stream.avail_in == inputBefore && stream.avail_out == outputBefore) break;
+        }
+        return static_cast<int64_t>(capacity - stream.avail_out);
+    }
+
+    bool atStreamEnd() const override {
+        return ended;
+    }
+
+private:
+    lzma_stream stream = LZMA_STREAM_INIT;
+    bool finishing = false;
+    bool ended = false;
+};
+#endif
+
+}
+
+Decompressor::Format Decompressor::detect(const char* data, size_t size) {
+    if (startsWith(data, size, "\x1f\x8b", 2)) return Gzip;
+    if (startsWith(data, size, "\x28\xb5\x2f\xfd", 4)) return Zstd;
+    if (startsWith(data, size, "\xfd" "7zXZ\0", 6)) return Xz;
+    return Plain;
+}
+
+bool Decompressor::isAvailable(Format format) {
+    switch (format) {
+    case Plain:
+        return true;
+    case Gzip:
+#ifdef DICTIONARY_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Zstd:
+#ifdef DICTIONARY_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    case Xz:
+#ifdef DICTIONARY_HAVE_LZMA
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+string Decompressor::formatName(Format format) {
+    switch (format) {
+    case Plain: return "plain";
+    case Gzip: return "gzip";
+    case Zstd: return "zstd";
+    case Xz: return "xz";
+    }
+    return "unknown";
+}
+
+unique_ptr<Decompressor> Decompressor::create(Format format) {
+    switch (format) {
+#ifdef DICTIONARY_HAVE_ZLIB
+    case Gzip:
+        return make_unique<GzipDecompressor>();
+#endif
+#ifdef DICTIONARY_HAVE_ZSTD
+    case Zstd:
+        return make_unique<ZstdDecompressor>();
+#endif
+#ifdef DICTIONARY_HAVE_LZMA
+    case Xz:
+        return make_unique<XzDecompressor>();
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+bool Decompressor::pipeline(const ReadFunction& read, string_view prefix, const ChunkHandler& handler) {
+    struct Chunk {
+        vector<char> data;
+        size_t size = 0;
+    };
+
+    // Chunks circulate between the two queues, so no allocation happens
+    // after start-up.
+    BoundedQueue<Chunk> filled(QueueDepth);
+    BoundedQueue<Chunk> empty(QueueDepth + 1);
+    for (size_t i = 0; i < QueueDepth + 1; i++) {
+        empty.push(Chunk{vector<char>(ChunkSize), 0});
+    }
+
+    string failure;
+
+    thread producer([&]() {
+        Chunk chunk;
+        if (!empty.pop(chunk)) {
+            filled.close();
+            return;
+        }
+
+        try {
+            vector<char> input(InputBufferSize);
+            string_view pending = prefix;
+            bool inputEnded = false;
+
+            while (true) {
+                int64_t produced = decompress(chunk.data.data() + chunk.size, chunk.data.size() - chunk.size);
+                if (produced < 0) {
+                    failure = error;
+                    break;
+                }
+
+                if (produced == 0) {
+                    if (inputEnded) {
+                        if (!atStreamEnd()) failure = "unexpected end of compressed input";
+                        break;
+                    }
+                    if (!pending.empty()) {
+                        setInput(pending.data(), pending.size());
+                        pending = string_view();
+                        continue;
+                    }
+
+                    int64_t bytesRead = read(input.data(), input.size());
+                    if (bytesRead < 0) {
+                        failure = "read error";
+                        break;
+                    }
+                    if (bytesRead == 0) {
+                        inputEnded = true;
+                        setInput(nullptr, 0);
+                        endInput();
+                    } else {
+                        setInput(input.data(), static_cast<size_t>(bytesRead));
+                    }
+                    continue;
+                }
+
+                chunk.size += static_cast<size_t>(produced);
+                if (chunk.size == chunk.data.size()) {
+                    if (!filled.push(std::move(chunk)) || !empty.pop(chunk)) break;
+                    chunk.size = 0;
+                }
+            }
+        } catch (const exception& e) {
+            failure = e.what();
+        }
+
+        if (chunk.size > 0) filled.push(std::move(chunk));
+        filled.close();
+    });
+
+    try {
+        Chunk chunk;
+        while (filled.pop(chunk)) {
+            handler(chunk.data.data(), chunk.size);
+            chunk.size = 0;
+            empty.push(std::move(chunk));
+        }
+    } catch (...) {
+        filled.close();
+        empty.close();
+        producer.join();
+        throw;
+    }
+    producer.join();
+
+    if (!failure.empty()) {
+        error = failure;
+        return false;
+    }
+    return true;
+}
+
+const string& Decompressor::errorString() const {
+    return error;
+}
@@ -0,0 +1,71 @@
+#ifndef DECOMPRESSOR_H
+#define DECOMPRESSOR_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Streaming decoder for compressed input, chosen from the magic bytes.
+// Each codec is compiled in only when its library was found at configure
+// time (DICTIONARY_HAVE_ZLIB, DICTIONARY_HAVE_ZSTD, DICTIONARY_HAVE_LZMA).
+// Concatenated gzip members, zstd frames and xz streams decode as one stream.
+class Decompressor {
+public:
+    enum Format {
+        Plain,
+        Gzip,
+        Zstd,
+        Xz
+    };
+
+    // Returns at most size bytes, 0 at the end of the input, -1 on error.
+    using ReadFunction = function<int64_t(char* data, size_t size)>;
+    using ChunkHandler = function<void(const char* data, size_t size)>;
+
+    static constexpr size_t ChunkSize = 1 << 18;
+    static constexpr size_t QueueDepth = 4;
+    // Longest magic; detect() needs this many bytes to tell formats apart.
+    static constexpr size_t MagicSize = 6;
+
+    static Format detect(const char* data, size_t size);
+
+    static bool isAvailable(Format format);
+
+    static string formatName(Format format);
+
+    // nullptr for Plain and for formats that were not compiled in.
+    static unique_ptr<Decompressor> create(Format format);
+
+    virtual ~Decompressor() = default;
+
+    // The data must stay valid until decompress() returns 0.
+    virtual void setInput(const char* data, size_t size) = 0;
+
+    // No input follows the current one.
+    virtual void endInput() {}
+
+    // Writes up to capacity bytes; 0 once the current input is used up and
+    // all of its output has been returned, -1 on corrupt data.
+    virtual int64_t decompress(char* output, size_t capacity) = 0;
+
+    // True when the input ended on a stream boundary, i.e. was not cut short.
+    virtual bool atStreamEnd() const = 0;
+
+    // Decompresses everything read returns, starting with the bytes already
+    // in prefix, on a separate thread. handler runs on the calling thread
+    // for each chunk of output in order; at most QueueDepth chunks are
+    // waiting at any time, so memory stays fixed however large the input.
+    bool pipeline(const ReadFunction& read, string_view prefix, const ChunkHandler& handler);
+
+    const string& errorString() const;
+
+protected:
+    string error;
+};
+
+#endif // DECOMPRESSOR_H
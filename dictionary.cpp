@@ -1,12 +1,98 @@
 #include "dictionary.h"
 #include "logger.h"
+#include "parallelsort.h"
+#include "threadpool.h"
+#include "streamtokenizer.h"
+#include "decompressor.h"
+#include "asyncfilereader.h"
+#include "ingestpipeline.h"
+#include "partialcache.h"
+#include "textdecoder.h"
+#include "wordcountreader.h"
 #include <cctype>
 #include <locale>
 #include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <QFileInfo>
+#include <regex>
 
 using namespace std;
 
+namespace {
+
+// QIODevice::read() that keeps waiting on sockets and processes, which
+// return 0 before their real end. 0 at the end, -1 on error.
+int64_t readDevice(QIODevice& device, char* data, size_t size) {
+    while (true) {
+        qint64 bytesRead = device.read(data, static_cast<qint64>(size));
+        if (bytesRead != 0) return bytesRead;
+        if (!device.isSequential() || device.atEnd() || !device.waitForReadyRead(-1)) return 0;
+    }
+}
+
+// Compression and encoding of a file judged from its first SniffSize bytes.
+void sniffFile(const string& path, Decompressor::Format& format, TextDecoder::Encoding& encoding) {
+    constexpr size_t SniffSize = 4096;
+    format = Decompressor::Plain;
+    encoding = TextDecoder::Utf8;
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    char sample[SniffSize];
+    qint64 bytesRead = file.read(sample, static_cast<qint64>(sizeof(sample)));
+    file.close();
+    if (bytesRead <= 0) return;
+    format = Decompressor::detect(sample, static_cast<size_t>(bytesRead));
+    if (format == Decompressor::Plain) encoding = TextDecoder::detect(sample, static_cast<size_t>(bytesRead));
+}
+
+// U+0400-U+052F without the combining marks and signs at U+0482-U+0489.
+bool isCyrillicLetter(uint32_t codePoint) {
+    return codePoint >= 0x400 && codePoint <= 0x52F && !(codePoint >= 0x482 && codePoint <= 0x489);
+}
+
+uint32_t lowerCyrillic(uint32_t codePoint) {
+    if (codePoint < 0x410) return codePoint + 0x50;
+    if (codePoint < 0x430) return codePoint + 0x20;
+    if (codePoint < 0x460) return codePoint;
+    if (codePoint == 0x4C0) return 0x4CF;
+    // From U+0460 on, capitals and small letters alternate; the capital
+    // comes first except in U+04C1-U+04CE.
+    bool oddCapitals = codePoint >= 0x4C1 && codePoint <= 0x4CE;
+    bool capital = (codePoint % 2 == 1) == oddCapitals;
+    return capital ? codePoint + 1 : codePoint;
+}
+
+// Lowercases ASCII and Cyrillic letters as normalizeWord() does, keeping every other byte.
+string lowerCase(string_view text) {
+    const locale current;
+    string result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if ((c & 0xE0) == 0xC0 && i + 1 < text.size() && (static_cast<unsigned char>(text[i + 1]) & 0xC0) == 0x80) {
+            uint32_t codePoint = (static_cast<uint32_t>(c) & 0x1F) << 6 | (static_cast<unsigned char>(text[i + 1]) & 0x3F);
+            if (isCyrillicLetter(codePoint)) {
+                codePoint = lowerCyrillic(codePoint);
+                result.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+                result.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+                i++;
+                continue;
+            }
+        }
+        result.push_back(c < 0x80 ? tolower(text[i], current) : text[i]);
+    }
+    return result;
+}
+
+string describeStage(const string& name, const IngestPipeline::StageTiming& timing) {
+    auto milliseconds = [](double seconds) { return to_string(llround(seconds * 1000)) + " ms"; };
+    return name + " " + milliseconds(timing.busySeconds) + " busy / " + milliseconds(timing.waitSeconds) + " waiting";
+}
+
+}
+
 Dictionary::Dictionary() {
     Logger::log(Logger::Info, "Dictionary created");
 }
@@ -16,70 +102,640 @@ Dictionary::~Dictionary() {
 }
 
 void Dictionary::addWord(const string& word) {
-    if (word.empty()) return;
-
-    string normalizedWord = normalizeWord(word);
-    if (!normalizedWord.empty()) {
-        wordMap[normalizedWord]++;
-        Logger::log(Logger::Debug, "Added word: " + normalizedWord);
-    }
+    countWord(word);
+    if (maxVocabulary && wordMap.size() > maxVocabulary) pruneVocabulary(nullptr);
 }
 
 bool Dictionary::addWordsFromFile(const QString& filePath) {
     QFileInfo fileInfo(filePath);
-    if (!fileInfo.exists() || !fileInfo.isFile() || !fileInfo.isReadable()) {
+    if (!fileInfo.exists() || fileInfo.isDir() || !fileInfo.isReadable()) {
         Logger::log(Logger::Error, "Cannot open file: " + filePath.toStdString());
         return false;
     }
 
     try {
         QFile file(filePath);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (!file.open(QIODevice::ReadOnly)) {
             Logger::log(Logger::Error, "Failed to open file: " + filePath.toStdString());
             return false;
         }
 
-        QTextStream in(&file);
-        QString line;
-        int wordCount = 0;
+        bool result = addWordsFromDevice(file, fileInfo.absoluteFilePath().toStdString());
+        file.close();
+        return result;
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Exception while reading file: " + string(e.what()));
+        return false;
+    }
+}
 
-        while (!in.atEnd()) {
-            line = in.readLine();
-            istringstream iss(line.toStdString());
-            string word;
+bool Dictionary::addWordsFromDevice(QIODevice& device, const string& documentName) {
+    if (!device.isOpen()) {
+        Logger::log(Logger::Error, "Device is not open: " + documentName);
+        return false;
+    }
 
-            while (iss >> word) {
-                addWord(word);
-                wordCount++;
+    try {
+        vector<char> buffer(StreamBufferSize);
+        int64_t bytesRead = readDevice(device, buffer.data(), buffer.size());
+        // A pipe may deliver the magic bytes over several reads.
+        while (bytesRead > 0 && static_cast<size_t>(bytesRead) < Decompressor::MagicSize) {
+            int64_t more = readDevice(device, buffer.data() + bytesRead, buffer.size() - static_cast<size_t>(bytesRead));
+            if (more <= 0) {
+                if (more < 0) bytesRead = more;
+                break;
             }
+            bytesRead += more;
         }
 
-        file.close();
-        Logger::log(Logger::Info, "File processed: " + filePath.toStdString() +
+        Decompressor::Format format = Decompressor::Plain;
+        if (bytesRead > 0) {
+            format = Decompressor::detect(buffer.data(), static_cast<size_t>(bytesRead));
+        }
+        unique_ptr<Decompressor> decompressor;
+        if (format != Decompressor::Plain) {
+            decompressor = Decompressor::create(format);
+            if (!decompressor) {
+                Logger::log(Logger::Error, documentName + " is " + Decompressor::formatName(format) +
+                           "-compressed, but this build has no " + Decompressor::formatName(format) + " support");
+                return false;
+            }
+        }
+
+        IngestBatch batch;
+        TextDecoder decoder;
+        uint64_t wordCount = 0;
+        bool ok = true;
+
+        beginDocument();
+
+        if (!decompressor && bytesRead >= 0 && !device.isSequential() && device.atEnd()) {
+            // The whole input is already in the buffer; not worth the threads.
+            StreamTokenizer tokenizer;
+            auto handler = [&](string_view token) {
+                addToken(batch, token);
+                wordCount++;
+            };
+            decoder.feed(buffer.data(), static_cast<size_t>(bytesRead),
+                         [&](const char* text, size_t length) { tokenizer.feed(text, length, handler); });
+            tokenizer.finish(handler);
+        } else {
+            auto readInput = [&device](char* data, size_t size) { return readDevice(device, data, size); };
+            auto produce = [&](const IngestPipeline::ChunkSink& sink) {
+                if (decompressor) {
+                    // One more thread, which reads the device and inflates.
+                    bool decoded = decompressor->pipeline(
+                        readInput, string_view(buffer.data(), static_cast<size_t>(bytesRead)),
+                        [&](const char* data, size_t size) { decoder.feed(data, size, sink); });
+                    if (!decoded) {
+                        Logger::log(Logger::Error, "Decompression failed for " + documentName + ": " +
+                                   decompressor->errorString());
+                    }
+                    return decoded;
+                }
+
+                int64_t chunkSize = bytesRead;
+                while (chunkSize > 0) {
+                    decoder.feed(buffer.data(), static_cast<size_t>(chunkSize), sink);
+                    chunkSize = readInput(buffer.data(), buffer.size());
+                }
+                if (chunkSize < 0) {
+                    Logger::log(Logger::Error, "Read error on " + documentName + ": " +
+                               device.errorString().toStdString());
+                    return false;
+                }
+                return true;
+            };
+
+            IngestPipeline pipeline;
+            ok = pipeline.run(
+                produce,
+                [this](string_view token, string& word) { normalizeWord(token, word); },
+                [&](const IngestPipeline::TokenBatch& tokens) {
+                    for (size_t i = 0; i < tokens.size; i += IngestBatchSize) {
+                        countTokens(batch, &tokens.words[i], &tokens.hashes[i], min(IngestBatchSize, tokens.size - i));
+                    }
+                });
+
+            ingestStatistics = pipeline.statistics();
+            wordCount = ingestStatistics.tokens;
+            Logger::log(Logger::Debug, "Pipeline for " + documentName + ": " +
+                       describeStage("read", ingestStatistics.reader) + ", " +
+                       describeStage("tokenize", ingestStatistics.tokenizer) + ", " +
+                       describeStage("count", ingestStatistics.counter));
+        }
+
+        // Words read before an error stay counted, as with a short read.
+        endDocument(batch, documentName);
+        if (!ok) return false;
+
+        string details;
+        if (decompressor) details = Decompressor::formatName(format);
+        if (decoder.encoding() != TextDecoder::Utf8) {
+            details += (details.empty() ? "" : ", ") + TextDecoder::encodingName(decoder.encoding());
+        }
+        Logger::log(Logger::Info, "Stream processed: " + documentName +
+                   (details.empty() ? string() : " (" + details + ")") +
                    ", words added: " + to_string(wordCount));
         return true;
     } catch (const exception& e) {
-        Logger::log(Logger::Error, "Exception while reading file: " + string(e.what()));
+        Logger::log(Logger::Error, "Exception while reading stream: " + string(e.what()));
+        return false;
+    }
+}
+
+bool Dictionary::addWordsFromFileDescriptor(int fd, const string& documentName) {
+    QFile file;
+    if (!file.open(fd, QIODevice::ReadOnly)) {
+        Logger::log(Logger::Error, "Failed to open file descriptor " + to_string(fd));
+        return false;
+    }
+
+    bool result = addWordsFromDevice(file, documentName);
+    file.close();
+    return result;
+}
+
+bool Dictionary::addWordsFromStdin() {
+    return addWordsFromFileDescriptor(0, "<stdin>");
+}
+
+const IngestPipeline::Statistics& Dictionary::lastIngestStatistics() const {
+    return ingestStatistics;
+}
+
+bool Dictionary::addWordsFromFiles(const vector<string>& filePaths, const FileScheduler::ProgressCallback& progress) {
+    try {
+        AsyncFileReader reader;
+        StreamTokenizer tokenizer;
+        TextDecoder decoder;
+        IngestBatch batch;
+        uint64_t wordCount = 0;
+        vector<size_t> compressedFiles;
+        bool skipFile = false;
+
+        vector<uint64_t> fileSizes(progress ? filePaths.size() : 0);
+        FileScheduler::Progress done{0, filePaths.size(), 0, 0};
+        for (size_t i = 0; i < fileSizes.size(); i++) {
+            error_code error;
+            uint64_t size = filesystem::file_size(filePaths[i], error);
+            fileSizes[i] = error ? 0 : size;
+            done.byteCount += fileSizes[i];
+        }
+        auto fileDone = [&](size_t file) {
+            if (!progress) return;
+            done.filesDone++;
+            done.bytesDone += fileSizes[file];
+            progress(done);
+        };
+        auto handler = [&](string_view token) {
+            addToken(batch, token);
+            wordCount++;
+        };
+        auto tokenize = [&](const char* text, size_t length) { tokenizer.feed(text, length, handler); };
+
+        bool ok = reader.read(filePaths, [&](const AsyncFileReader::Block& block) {
+            if (block.offset == 0) {
+                beginDocument();
+                decoder = TextDecoder();
+                bool compressed = block.size > 0 && Decompressor::detect(block.data, block.size) != Decompressor::Plain;
+                if (compressed) compressedFiles.push_back(block.file);
+                skipFile = compressed || block.failed;
+            }
+            if (!skipFile) decoder.feed(block.data, block.size, tokenize);
+            if (block.lastOfFile && !skipFile) {
+                tokenizer.finish(handler);
+                endDocument(batch, QFileInfo(QString::fromStdString(filePaths[block.file]))
+                                       .absoluteFilePath().toStdString());
+            }
+            // Compressed files are reported once they are counted below.
+            if (block.lastOfFile && (compressedFiles.empty() || compressedFiles.back() != block.file)) {
+                fileDone(block.file);
+            }
+        });
+
+        for (size_t file : compressedFiles) {
+            ok = addWordsFromFile(QString::fromStdString(filePaths[file])) && ok;
+            fileDone(file);
+        }
+
+        Logger::log(Logger::Info, "Files processed with " + AsyncFileReader::backendName(reader.backend()) +
+                   " reader: " + to_string(filePaths.size()) + ", words added: " + to_string(wordCount));
+        return ok;
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Exception while reading files: " + string(e.what()));
+        return false;
+    }
+}
+
+bool Dictionary::addWordsFromDirectory(const QString& directory, const QString& namePattern, bool recursive,
+                                       const FileScheduler::ProgressCallback& progress, int threads) {
+    QFileInfo directoryInfo(directory);
+    if (!directoryInfo.isDir()) {
+        Logger::log(Logger::Error, "Not a directory: " + directory.toStdString());
+        return false;
+    }
+
+    try {
+        vector<string> paths = FileScheduler::listFiles(directoryInfo.absoluteFilePath().toStdString(),
+                                                        namePattern.toStdString(), recursive);
+
+        // These features depend on token order within and across files.
+        if (nGrams || cooccurrences || documentIndex || admissionFilter || maxVocabulary) {
+            return addWordsFromFiles(paths, progress);
+        }
+
+        // Cached files are merged from their stored counts; only the rest are read.
+        vector<PartialCache::Fingerprint> fingerprints;
+        unordered_map<string, uint64_t> cachedCounts;
+        uint64_t cachedTokens = 0;
+        uint64_t cachedBytes = 0;
+        size_t cachedFiles = 0;
+        if (ingestCache) {
+            vector<string> changed;
+            PartialCache::Partial partial;
+            for (string& path : paths) {
+                PartialCache::Fingerprint fingerprint;
+                if (PartialCache::stat(path, fingerprint) && ingestCache->lookup(path, fingerprint, partial)) {
+                    for (auto& [word, count] : partial.counts) cachedCounts[std::move(word)] += count;
+                    cachedTokens += partial.tokens;
+                    cachedBytes += fingerprint.size;
+                    cachedFiles++;
+                    continue;
+                }
+                changed.push_back(std::move(path));
+                fingerprints.push_back(fingerprint);
+            }
+            paths = std::move(changed);
+        }
+
+        // Compressed files cannot be split into ranges; they are read one
+        // by one through their decompressor once the others are counted.
+        vector<string> compressedPaths;
+        vector<Decompressor::Format> compressedFormats;
+        vector<PartialCache::Fingerprint> compressedFingerprints;
+        vector<TextDecoder::Encoding> encodings;
+        encodings.reserve(paths.size());
+        size_t kept = 0;
+        for (size_t i = 0; i < paths.size(); i++) {
+            Decompressor::Format format;
+            TextDecoder::Encoding encoding;
+            sniffFile(paths[i], format, encoding);
+            if (format != Decompressor::Plain) {
+                compressedPaths.push_back(std::move(paths[i]));
+                compressedFormats.push_back(format);
+                if (ingestCache) compressedFingerprints.push_back(fingerprints[i]);
+                continue;
+            }
+            if (kept != i) {
+                paths[kept] = std::move(paths[i]);
+                if (ingestCache) fingerprints[kept] = fingerprints[i];
+            }
+            kept++;
+            encodings.push_back(encoding);
+        }
+        paths.resize(kept);
+        if (ingestCache) fingerprints.resize(kept);
+
+        // In UTF-16 a whitespace byte can be half of a unit such as U+2019,
+        // so such files are streamed by a single worker; CP1251 splits like
+        // UTF-8. While caching every file is streamed, which keeps its counts
+        // and content hash apart from the other files.
+        vector<bool> streamed(paths.size());
+        for (size_t i = 0; i < paths.size(); i++) {
+            streamed[i] = ingestCache || encodings[i] == TextDecoder::Utf16LE || encodings[i] == TextDecoder::Utf16BE;
+        }
+        FileScheduler scheduler(std::move(paths), FileScheduler::DefaultChunkSize, streamed);
+        size_t workers = threads > 0 ? static_cast<size_t>(threads) : ThreadPool::shared().threadCount();
+        vector<unordered_map<string, uint64_t>> tables(max<size_t>(workers, 1));
+        vector<uint64_t> tokenCounts(tables.size(), 0);
+
+        // The streamed file a worker is in the middle of.
+        struct StreamState {
+            StreamTokenizer tokenizer;
+            TextDecoder decoder;
+            PartialCache::ContentHasher hasher;
+            unordered_map<string, uint64_t> counts;
+            uint64_t tokens = 0;
+            uint64_t bytes = 0;
+            bool started = false;
+        };
+        vector<StreamState> streams(tables.size());
+
+        auto counter = [this](unordered_map<string, uint64_t>& table, uint64_t& tokens) {
+            return [this, &table, &tokens](string_view token) {
+                tokens++;
+                string normalizedWord = normalizeWord(token);
+                if (!normalizedWord.empty()) table[std::move(normalizedWord)]++;
+            };
+        };
+
+        FileScheduler::ProgressCallback reportProgress;
+        if (progress) {
+            reportProgress = [&](const FileScheduler::Progress& current) {
+                progress(FileScheduler::Progress{current.filesDone + cachedFiles,
+                                                 current.fileCount + cachedFiles + compressedPaths.size(),
+                                                 current.bytesDone + cachedBytes, current.byteCount + cachedBytes});
+            };
+        }
+
+        auto countBlock = [&](size_t worker, size_t file, const char* data, size_t size) {
+            if (streamed[file]) {
+                StreamState& stream = streams[worker];
+                if (!stream.started) {
+                    stream.started = true;
+                    stream.decoder = TextDecoder(encodings[file]);
+                }
+                stream.hasher.update(data, size);
+                stream.bytes += size;
+                auto handler = counter(stream.counts, stream.tokens);
+                stream.decoder.feed(data, size, [&](const char* text, size_t length) {
+                    stream.tokenizer.feed(text, length, handler);
+                });
+                return;
+            }
+
+            uint64_t tokens = 0;
+            StreamTokenizer tokenizer;
+            auto handler = counter(tables[worker], tokens);
+            if (encodings[file] == TextDecoder::Utf8) {
+                tokenizer.feed(data, size, handler);
+            } else {
+                TextDecoder decoder(encodings[file]);
+                decoder.feed(data, size, [&](const char* text, size_t length) { tokenizer.feed(text, length, handler); });
+            }
+            tokenizer.finish(handler);
+            tokenCounts[worker] += tokens;
+        };
+
+        // Ends the file in stream, caches its counts and adds them to table.
+        auto finishStream = [&](StreamState& stream, const string& path, const PartialCache::Fingerprint* examined,
+                                bool complete, unordered_map<string, uint64_t>& table) {
+            stream.tokenizer.finish(counter(stream.counts, stream.tokens));
+
+            PartialCache::Partial partial;
+            partial.tokens = stream.tokens;
+            partial.counts.assign(make_move_iterator(stream.counts.begin()), make_move_iterator(stream.counts.end()));
+            sort(partial.counts.begin(), partial.counts.end());
+
+            // A file that changed size since it was examined is counted but not cached.
+            if (ingestCache) {
+                PartialCache::Fingerprint fingerprint = *examined;
+                if (complete && stream.bytes == fingerprint.size) {
+                    fingerprint.contentHash = stream.hasher.value();
+                    ingestCache->store(path, fingerprint, partial);
+                }
+            }
+
+            for (auto& [word, count] : partial.counts) table[std::move(word)] += count;
+            uint64_t tokens = stream.tokens;
+            stream = StreamState();
+            return tokens;
+        };
+
+        auto finishFile = [&](size_t worker, size_t file, bool complete) {
+            if (!streamed[file]) return;
+            tokenCounts[worker] += finishStream(streams[worker], scheduler.path(file),
+                                                ingestCache ? &fingerprints[file] : nullptr, complete, tables[worker]);
+        };
+
+        bool ok = scheduler.run(static_cast<int>(tables.size()), countBlock, reportProgress, finishFile);
+
+        // The compressed bytes are hashed as they are read, so an entry
+        // is keyed on the file as stored, like a plain one.
+        for (size_t i = 0; i < compressedPaths.size(); i++) {
+            const string& path = compressedPaths[i];
+            unique_ptr<Decompressor> decompressor = Decompressor::create(compressedFormats[i]);
+            QFile file(QString::fromStdString(path));
+            if (!decompressor) {
+                string format = Decompressor::formatName(compressedFormats[i]);
+                Logger::log(Logger::Error, path + " is " + format + "-compressed, but this build has no " + format +
+                           " support");
+                ok = false;
+            } else if (!file.open(QIODevice::ReadOnly)) {
+                Logger::log(Logger::Error, "Failed to open file: " + path);
+                ok = false;
+            } else {
+                StreamState& stream = streams[0];
+                auto readInput = [&](char* data, size_t size) {
+                    int64_t bytesRead = readDevice(file, data, size);
+                    if (bytesRead > 0) {
+                        stream.hasher.update(data, static_cast<size_t>(bytesRead));
+                        stream.bytes += static_cast<uint64_t>(bytesRead);
+                    }
+                    return bytesRead;
+                };
+                auto handler = counter(stream.counts, stream.tokens);
+                bool decoded = decompressor->pipeline(readInput, string_view(), [&](const char* data, size_t size) {
+                    stream.decoder.feed(data, size, [&](const char* text, size_t length) {
+                        stream.tokenizer.feed(text, length, handler);
+                    });
+                });
+                if (!decoded) {
+                    Logger::log(Logger::Error, "Decompression failed for " + path + ": " + decompressor->errorString());
+                    ok = false;
+                }
+                // Words read before an error stay counted, as with a plain file.
+                tokenCounts[0] += finishStream(stream, path, ingestCache ? &compressedFingerprints[i] : nullptr,
+                                               decoded, cachedCounts);
+            }
+
+            if (progress) {
+                size_t filesDone = scheduler.fileCount() + cachedFiles + i + 1;
+                progress(FileScheduler::Progress{filesDone, scheduler.fileCount() + cachedFiles + compressedPaths.size(),
+                                                 scheduler.byteCount() + cachedBytes, scheduler.byteCount() + cachedBytes});
+            }
+        }
+
+        tables.push_back(std::move(cachedCounts));
+        unordered_map<string, uint64_t>& merged = tables[0];
+        for (size_t i = 1; i < tables.size(); i++) {
+            for (auto& [word, count] : tables[i]) {
+                merged[word] += count;
+            }
+            tables[i] = unordered_map<string, uint64_t>();
+        }
+
+        // New ids are handed out in word order, independent of which worker saw a word first.
+        vector<pair<const string, uint64_t>*> words;
+        words.reserve(merged.size());
+        for (auto& item : merged) words.push_back(&item);
+        sort(words.begin(), words.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+        for (const auto* item : words) {
+            WordEntry& entry = insertWord(item->first);
+            int count = static_cast<int>(min<uint64_t>(static_cast<uint64_t>(entry.count) + item->second, INT_MAX));
+            countStatistics.move(entry.count, count);
+            entry.count = count;
+        }
+        modificationVersion++;
+
+        uint64_t tokens = cachedTokens;
+        for (uint64_t count : tokenCounts) tokens += count;
+        Logger::log(Logger::Info, "Directory processed: " + directory.toStdString() +
+                   ", files: " + to_string(scheduler.fileCount() + cachedFiles + compressedPaths.size()) +
+                   (ingestCache ? " (" + to_string(cachedFiles) + " from cache)" : string()) +
+                   ", bytes: " + to_string(scheduler.byteCount() + cachedBytes) +
+                   ", words added: " + to_string(tokens));
+        return ok;
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Exception while reading directory: " + string(e.what()));
+        return false;
+    }
+}
+
+bool Dictionary::setIngestCache(const QString& cacheDirectory) {
+    if (cacheDirectory.isEmpty()) {
+        ingestCache.reset();
+        return true;
+    }
+
+    ingestCache = make_unique<PartialCache>(cacheDirectory.toStdString());
+    if (!QFileInfo(cacheDirectory).isDir()) {
+        ingestCache.reset();
+        return false;
+    }
+    return true;
+}
+
+bool Dictionary::followFile(const QString& filePath) {
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.isFile() || !fileInfo.isReadable()) {
+        Logger::log(Logger::Error, "Cannot follow file: " + filePath.toStdString());
+        return false;
+    }
+
+    try {
+        string path = fileInfo.absoluteFilePath().toStdString();
+        if (!follower) follower = make_unique<FileFollower>();
+
+        int index = follower->indexOf(path);
+        if (index < 0) {
+            if (!follower->add(FileFollower::FileState{path, 0, 0})) return false;
+            index = static_cast<int>(follower->size()) - 1;
+        }
+        return ingestFollowed(static_cast<size_t>(index)) >= 0;
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Exception while following file: " + string(e.what()));
         return false;
     }
 }
 
+bool Dictionary::unfollowFile(const QString& filePath) {
+    return follower && follower->remove(QFileInfo(filePath).absoluteFilePath().toStdString());
+}
+
+vector<string> Dictionary::followedFiles() const {
+    vector<string> paths;
+    if (!follower) return paths;
+    for (size_t i = 0; i < follower->size(); i++) {
+        paths.push_back(follower->file(i).path);
+    }
+    return paths;
+}
+
+uint64_t Dictionary::pollFollowedFiles() {
+    if (!follower) return 0;
+
+    uint64_t consumed = 0;
+    try {
+        for (size_t i = 0; i < follower->size(); i++) {
+            int64_t bytes = ingestFollowed(i);
+            if (bytes > 0) consumed += static_cast<uint64_t>(bytes);
+        }
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Exception while polling followed files: " + string(e.what()));
+    }
+    return consumed;
+}
+
+bool Dictionary::waitForFollowedFiles(int timeoutMs) {
+    if (!follower) follower = make_unique<FileFollower>();
+    return follower->waitForChanges(timeoutMs);
+}
+
 bool Dictionary::saveToFile(const QString& filePath) {
     try {
-        QFile file(filePath);
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        // Every file is written aside first and renamed after the
+        // dictionary. The follow state and the index carry a hash of the
+        // dictionary they belong to, so after a crash between the renames
+        // loadFromFile() picks the ones that match the counts, and never
+        // pairs an old index with new counts.
+        QString dictionaryTemporary = filePath + ".tmp";
+        QString followPath = filePath + ".follow";
+        QString followTemporary = followPath + ".tmp";
+        QString indexPath = filePath + ".idx";
+        QString indexTemporary = indexPath + ".tmp";
+
+        QFile file(dictionaryTemporary);
+        if (!file.open(QIODevice::WriteOnly)) {
             Logger::log(Logger::Error, "Failed to save dictionary to file: " +
                        filePath.toStdString());
             return false;
         }
 
-        QTextStream out(&file);
+        // Lines are buffered in blocks and hashed as they are written.
+        PartialCache::ContentHasher hasher;
+        string text;
+        bool written = true;
+        auto flush = [&]() {
+            hasher.update(text.data(), text.size());
+            written = written && file.write(text.data(), static_cast<qint64>(text.size())) ==
+                                     static_cast<qint64>(text.size());
+            text.clear();
+        };
+        for (const auto& [word, entry] : wordMap) {
+            text += word;
+            text += ' ';
+            text += to_string(entry.count);
+            text += '\n';
+            if (text.size() >= (1 << 20)) flush();
+        }
+        flush();
+        file.close();
+
+        error_code error;
+        bool following = follower && follower->size() > 0;
+        bool indexing = documentIndex && documentIndex->documentCount() > 0;
+        if (written && following) written = follower->save(followTemporary, hasher.value());
+        if (written && indexing) {
+            vector<uint32_t> wordOrder;
+            wordOrder.reserve(wordMap.size());
+            for (const auto& [word, entry] : wordMap) {
+                wordOrder.push_back(entry.id);
+            }
+            written = documentIndex->save(indexTemporary, wordOrder, hasher.value());
+        }
 
-        for (const auto& [word, count] : wordMap) {
-            out << QString::fromStdString(word) << " " << count << Qt::endl;
+        if (written) filesystem::rename(dictionaryTemporary.toStdString(), filePath.toStdString(), error);
+        if (!written || error) {
+            Logger::log(Logger::Error, "Failed to write dictionary file: " + filePath.toStdString());
+            filesystem::remove(dictionaryTemporary.toStdString(), error);
+            filesystem::remove(followTemporary.toStdString(), error);
+            filesystem::remove(indexTemporary.toStdString(), error);
+            return false;
+        }
+
+        if (following) {
+            filesystem::rename(followTemporary.toStdString(), followPath.toStdString(), error);
+            if (error) {
+                Logger::log(Logger::Error, "Failed to write follow state: " + followPath.toStdString());
+                return false;
+            }
+        } else if (QFileInfo(followPath).isFile()) {
+            QFile::remove(followPath);
+        }
+
+        if (indexing) {
+            filesystem::rename(indexTemporary.toStdString(), indexPath.toStdString(), error);
+            if (error) {
+                Logger::log(Logger::Error, "Failed to write document index: " + indexPath.toStdString());
+                return false;
+            }
+        } else if (QFileInfo(indexPath).isFile()) {
+            QFile::remove(indexPath);
         }
 
-        file.close();
         Logger::log(Logger::Info, "Dictionary saved to file: " + filePath.toStdString() +
                    ", total words: " + to_string(wordMap.size()));
         return true;
@@ -98,30 +754,68 @@ bool Dictionary::loadFromFile(const QString& filePath) {
 
     try {
         QFile file(filePath);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (!file.open(QIODevice::ReadOnly)) {
             Logger::log(Logger::Error, "Failed to open dictionary file: " + filePath.toStdString());
             return false;
         }
 
         clear();
 
-        QTextStream in(&file);
-        QString line;
         int wordCount = 0;
+        bool complete = WordCountReader::read(file, [&](const string& word, int count) {
+            WordEntry& entry = insertWord(word);
+            countStatistics.move(entry.count, count);
+            entry.count = count;
+            wordCount++;
+        });
+        modificationVersion++;
+
+        file.close();
+        if (!complete) {
+            Logger::log(Logger::Error, "Failed to read dictionary file: " + filePath.toStdString());
+            return false;
+        }
 
-        while (!in.atEnd()) {
-            line = in.readLine();
-            istringstream iss(line.toStdString());
-            string word;
-            int count = 0;
+        // A save interrupted between its renames leaves the matching state
+        // in .tmp files; the hash tells which of the two goes with the
+        // counts just read. An index that matches neither is stale.
+        uint64_t hash = 0;
+        QString indexPath = filePath + ".idx";
+        QString indexTemporary = indexPath + ".tmp";
+        QString followPath = filePath + ".follow";
+        QString followTemporary = followPath + ".tmp";
+        bool hashed = false;
+        auto dictionaryHash = [&]() {
+            if (!hashed && !PartialCache::hashFile(filePath.toStdString(), hash)) hash = 0;
+            hashed = true;
+            return hash;
+        };
 
-            if (iss >> word >> count) {
-                wordMap[word] = count;
-                wordCount++;
+        if (QFileInfo(indexTemporary).isFile() && InvertedIndex::checkpoint(indexTemporary) == dictionaryHash()) {
+            indexPath = indexTemporary;
+        }
+        if (QFileInfo(indexPath).isFile()) {
+            if (InvertedIndex::checkpoint(indexPath) != dictionaryHash()) {
+                Logger::log(Logger::Warning, "Ignoring document index saved with another dictionary: " +
+                           indexPath.toStdString());
+            } else {
+                auto loadedIndex = make_unique<InvertedIndex>();
+                if (loadedIndex->load(indexPath, wordMap.size())) {
+                    documentIndex = std::move(loadedIndex);
+                }
             }
         }
 
-        file.close();
+        if (QFileInfo(followTemporary).isFile() && FileFollower::checkpoint(followTemporary) == dictionaryHash()) {
+            followPath = followTemporary;
+        }
+        if (QFileInfo(followPath).isFile()) {
+            if (!follower) follower = make_unique<FileFollower>();
+            follower->load(followPath);
+        }
+
+        if (maxVocabulary && wordMap.size() > maxVocabulary) pruneVocabulary(nullptr);
+
         Logger::log(Logger::Info, "Dictionary loaded from file: " + filePath.toStdString() +
                    ", total words: " + to_string(wordCount));
         return true;
@@ -132,48 +826,792 @@ bool Dictionary::loadFromFile(const QString& filePath) {
 }
 
 vector<pair<string, int>> Dictionary::getWordsAlphabetically() const {
-    vector<pair<string, int>> words(wordMap.begin(), wordMap.end());
-    sort(words.begin(), words.end(),
-         [](const auto& a, const auto& b) { return a.first < b.first; });
+    vector<pair<string, int>> words;
+    words.reserve(wordMap.size());
+    for (const auto& [word, entry] : wordMap) {
+        words.emplace_back(word, entry.count);
+    }
 
     Logger::log(Logger::Debug, "Retrieved alphabetically sorted word list");
     return words;
 }
 
 vector<pair<string, int>> Dictionary::getWordsByFrequency() const {
-    vector<pair<string, int>> words(wordMap.begin(), wordMap.end());
-    sort(words.begin(), words.end(),
-         [](const auto& a, const auto& b) {
-             return a.second > b.second || (a.second == b.second && a.first < b.first);
-         });
+    vector<pair<string, int>> words;
+    words.reserve(wordMap.size());
+    for (const auto& [word, count] : this->words(ByFrequency)) {
+        words.emplace_back(word, count);
+    }
 
     Logger::log(Logger::Debug, "Retrieved frequency sorted word list");
     return words;
 }
 
+Dictionary::WordView Dictionary::words(SortOrder order) const {
+    const vector<uint32_t>& ids = sortedIds(order);
+    return WordView(this, &ids, 0, ids.size());
+}
+
+uint64_t Dictionary::version() const {
+    return modificationVersion;
+}
+
+Dictionary::WordView Dictionary::range(SortOrder order, size_t offset, size_t limit) const {
+    return words(order).subview(offset, limit);
+}
+
+Dictionary::Cursor Dictionary::cursor(SortOrder order, size_t offset) const {
+    return Cursor(this, order, offset);
+}
+
+size_t Dictionary::rank(const string& word) const {
+    const WordEntry* entry = findWord(word);
+    if (!entry || entry->count <= 0) return 0;
+    return countStatistics.wordCount() - countStatistics.countAtMost(entry->count) + 1;
+}
+
+int Dictionary::frequencyQuantile(double q) const {
+    return countStatistics.quantile(q);
+}
+
+size_t Dictionary::countWordsInRange(int minCount, int maxCount) const {
+    return countStatistics.countInRange(max(minCount, 1), maxCount);
+}
+
+Dictionary::WordView Dictionary::wordsInCountRange(int minCount, int maxCount) const {
+    const vector<uint32_t>& ids = sortedIds(ByFrequency);
+    size_t first = maxCount == INT_MAX ? 0 : countStatistics.wordCount() - countStatistics.countAtMost(maxCount);
+    return WordView(this, &ids, min(first, ids.size()), countWordsInRange(minCount, maxCount));
+}
+
+pair<string_view, int> Dictionary::WordView::operator[](size_t i) const {
+    const auto& it = dictionary->wordsById[(*order)[first + i]];
+    return {it->first, it->second.count};
+}
+
+Dictionary::WordView Dictionary::WordView::subview(size_t offset, size_t limit) const {
+    offset = min(offset, length);
+    return WordView(dictionary, order, first + offset, min(limit, length - offset));
+}
+
+Dictionary::Cursor::Cursor(const Dictionary* dictionary, SortOrder order, size_t offset)
+    : dictionary(dictionary), order(order), index(min(offset, dictionary->wordMap.size())), started(false) {
+    if (order == Alphabetical) {
+        current = dictionary->wordMap.begin();
+        advance(current, static_cast<ptrdiff_t>(index));
+    }
+}
+
+bool Dictionary::Cursor::next() {
+    const size_t total = dictionary->wordMap.size();
+    if (started && index < total) {
+        index++;
+        if (order == Alphabetical) ++current;
+    }
+    started = true;
+    if (index >= total) return false;
+
+    if (order == ByFrequency) {
+        current = dictionary->wordsById[dictionary->sortedIds(ByFrequency)[index]];
+    }
+    return true;
+}
+
+string_view Dictionary::Cursor::word() const {
+    return current->first;
+}
+
+int Dictionary::Cursor::count() const {
+    return current->second.count;
+}
+
+size_t Dictionary::Cursor::position() const {
+    return index;
+}
+
+vector<pair<string, int>> Dictionary::search(const string& pattern, SearchMode mode) const {
+    vector<pair<string, int>> result;
+    if (pattern.empty()) return result;
+
+    string literal;
+    regex expression;
+    vector<string> literals;
+
+    if (mode == Regex) {
+        try {
+            expression = regex(pattern, regex::ECMAScript | regex::optimize);
+        } catch (const regex_error& e) {
+            Logger::log(Logger::Error, "Invalid search pattern: " + pattern + " (" + e.what() + ")");
+            return result;
+        }
+        literals = TrigramIndex::requiredLiterals(pattern);
+    } else {
+        literal = lowerCase(pattern);
+        literals.push_back(literal);
+    }
+
+    auto matches = [&](const string& word) {
+        return mode == Regex ? regex_search(word, expression) : word.find(literal) != string::npos;
+    };
+
+    vector<uint32_t> candidateIds;
+    bool narrowed = trigramIndex.candidates(literals, candidateIds);
+    if (narrowed) {
+        for (uint32_t id : candidateIds) {
+            const auto& [word, entry] = *wordsById[id];
+            if (matches(word)) {
+                result.emplace_back(word, entry.count);
+            }
+        }
+        sort(result.begin(), result.end(),
+             [](const auto& a, const auto& b) { return a.first < b.first; });
+    } else {
+        for (const auto& [word, entry] : wordMap) {
+            if (matches(word)) {
+                result.emplace_back(word, entry.count);
+            }
+        }
+    }
+
+    Logger::log(Logger::Debug, "Search for '" + pattern + "' checked " +
+               to_string(narrowed ? candidateIds.size() : wordMap.size()) +
+               " words, found " + to_string(result.size()));
+    return result;
+}
+
+void Dictionary::enableFuzzyIndex(int maxEditDistance, int prefixLength) {
+    spellIndex = make_unique<SpellIndex>(maxEditDistance, prefixLength);
+    for (const auto& it : wordsById) {
+        spellIndex->addWord(it->second.id, it->first);
+    }
+
+    Logger::log(Logger::Info, "Fuzzy index built: max distance " +
+               to_string(spellIndex->maxEditDistance()) + ", prefix length " +
+               to_string(spellIndex->prefixLength()) + ", deletes " +
+               to_string(spellIndex->deleteCount()) + ", memory " +
+               to_string(spellIndex->memoryUsage()) + " bytes");
+}
+
+void Dictionary::disableFuzzyIndex() {
+    spellIndex.reset();
+    Logger::log(Logger::Info, "Fuzzy index disabled");
+}
+
+bool Dictionary::isFuzzyIndexEnabled() const {
+    return spellIndex != nullptr;
+}
+
+size_t Dictionary::fuzzyIndexMemoryUsage() const {
+    return spellIndex ? spellIndex->memoryUsage() : 0;
+}
+
+vector<Dictionary::FuzzyMatch> Dictionary::fuzzyLookup(const string& word, int maxDistance) const {
+    vector<FuzzyMatch> result;
+    string query = normalizeWord(word);
+    if (query.empty()) return result;
+
+    if (spellIndex) {
+        auto wordAt = [this](uint32_t id) -> const string& { return wordsById[id]->first; };
+        for (const auto& [id, distance] : spellIndex->lookup(query, maxDistance, wordAt)) {
+            result.push_back({wordsById[id]->first, wordsById[id]->second.count, distance});
+        }
+    } else {
+        u32string target = SpellIndex::decodeUtf8(query);
+        for (const auto& [candidate, entry] : wordMap) {
+            int distance = SpellIndex::editDistance(target, SpellIndex::decodeUtf8(candidate), maxDistance);
+            if (distance <= maxDistance) {
+                result.push_back({candidate, entry.count, distance});
+            }
+        }
+    }
+
+    sort(result.begin(), result.end(), [](const FuzzyMatch& a, const FuzzyMatch& b) {
+        if (a.distance != b.distance) return a.distance < b.distance;
+        if (a.count != b.count) return a.count > b.count;
+        return a.word < b.word;
+    });
+
+    Logger::log(Logger::Debug, "Fuzzy lookup for '" + query + "' found " +
+               to_string(result.size()) + " words");
+    return result;
+}
+
+void Dictionary::setNGramOrder(int order) {
+    if (order <= 1) {
+        nGrams.reset();
+    } else if (!nGrams || nGrams->maxOrder() != min(order, 3)) {
+        nGrams = make_unique<NGramCounter>(order);
+    }
+    Logger::log(Logger::Info, "N-gram order set to " + to_string(nGramOrder()));
+}
+
+int Dictionary::nGramOrder() const {
+    return nGrams ? nGrams->maxOrder() : 1;
+}
+
+size_t Dictionary::nGramCount(int order) const {
+    if (order == 1) return wordMap.size();
+    return nGrams ? nGrams->size(order) : 0;
+}
+
+vector<pair<string, int>> Dictionary::getNGramsAlphabetically(int order) const {
+    if (order == 1) return getWordsAlphabetically();
+
+    vector<pair<string, int>> nGramList = nGramStrings(order);
+    ParallelSort::alphabetically(nGramList);
+
+    Logger::log(Logger::Debug, "Retrieved alphabetically sorted " + to_string(order) + "-gram list");
+    return nGramList;
+}
+
+vector<pair<string, int>> Dictionary::getNGramsByFrequency(int order) const {
+    if (order == 1) return getWordsByFrequency();
+
+    vector<pair<string, int>> nGramList = nGramStrings(order);
+    ParallelSort::byFrequency(nGramList);
+
+    Logger::log(Logger::Debug, "Retrieved frequency sorted " + to_string(order) + "-gram list");
+    return nGramList;
+}
+
+bool Dictionary::saveNGramsToFile(const QString& filePath, int order) {
+    if (order == 1) return saveToFile(filePath);
+
+    try {
+        QFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            Logger::log(Logger::Error, "Failed to save n-grams to file: " +
+                       filePath.toStdString());
+            return false;
+        }
+
+        QTextStream out(&file);
+
+        vector<pair<string, int>> nGramList = getNGramsAlphabetically(order);
+        for (const auto& [nGram, count] : nGramList) {
+            out << QString::fromStdString(nGram) << " " << count << Qt::endl;
+        }
+
+        file.close();
+        Logger::log(Logger::Info, "N-grams saved to file: " + filePath.toStdString() +
+                   ", order: " + to_string(order) + ", total: " + to_string(nGramList.size()));
+        return true;
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Exception while saving n-grams: " + string(e.what()));
+        return false;
+    }
+}
+
+bool Dictionary::enableCooccurrence(int window, int threads, size_t maxPairsInMemory,
+                                    const QString& spillDirectory) {
+    if (maxVocabulary) {
+        Logger::log(Logger::Warning, "Co-occurrence counting is not available with a vocabulary limit");
+        return false;
+    }
+
+    cooccurrences = make_unique<CooccurrenceCounter>(window, threads, maxPairsInMemory,
+                                                     spillDirectory.toStdString());
+    Logger::log(Logger::Info, "Co-occurrence counting enabled, window: +-" +
+               to_string(cooccurrences->window()));
+    return true;
+}
+
+void Dictionary::disableCooccurrence() {
+    cooccurrences.reset();
+    Logger::log(Logger::Info, "Co-occurrence counting disabled");
+}
+
+bool Dictionary::isCooccurrenceEnabled() const {
+    return cooccurrences != nullptr;
+}
+
+bool Dictionary::exportCooccurrences(const QString& filePath) {
+    if (!cooccurrences) {
+        Logger::log(Logger::Error, "Co-occurrence counting is not enabled");
+        return false;
+    }
+
+    try {
+        if (!cooccurrences->exportTriplets(filePath.toStdString())) {
+            return false;
+        }
+
+        QFile file(filePath + ".vocab");
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            Logger::log(Logger::Error, "Failed to save co-occurrence vocabulary: " +
+                       filePath.toStdString() + ".vocab");
+            return false;
+        }
+
+        QTextStream out(&file);
+        for (const auto& it : wordsById) {
+            out << QString::fromStdString(it->first) << " " << it->second.count << Qt::endl;
+        }
+
+        file.close();
+        return true;
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Exception while exporting co-occurrences: " + string(e.what()));
+        return false;
+    }
+}
+
+void Dictionary::enableDocumentIndex() {
+    if (!documentIndex) documentIndex = make_unique<InvertedIndex>();
+    Logger::log(Logger::Info, "Document index enabled");
+}
+
+void Dictionary::disableDocumentIndex() {
+    documentIndex.reset();
+    Logger::log(Logger::Info, "Document index disabled");
+}
+
+bool Dictionary::isDocumentIndexEnabled() const {
+    return documentIndex != nullptr;
+}
+
+size_t Dictionary::documentCount() const {
+    return documentIndex ? documentIndex->documentCount() : 0;
+}
+
+string Dictionary::documentName(uint32_t documentId) const {
+    if (!documentIndex || documentId >= documentIndex->documentCount()) return string();
+    return documentIndex->documentName(documentId);
+}
+
+uint32_t Dictionary::documentFrequency(const string& word) const {
+    const WordEntry* entry = findWord(word);
+    return entry && documentIndex ? documentIndex->documentFrequency(entry->id) : 0;
+}
+
+InvertedIndex::PostingIterator Dictionary::postings(const string& word) const {
+    const WordEntry* entry = findWord(word);
+    return entry && documentIndex ? documentIndex->postings(entry->id) : InvertedIndex::PostingIterator();
+}
+
+vector<pair<string, double>> Dictionary::rankDocuments(const string& query, size_t limit) const {
+    vector<pair<string, double>> result;
+    if (!documentIndex) return result;
+
+    vector<uint32_t> wordIds;
+    istringstream iss(query);
+    string word;
+    while (iss >> word) {
+        if (const WordEntry* entry = findWord(word)) {
+            wordIds.push_back(entry->id);
+        }
+    }
+
+    for (const auto& [document, score] : documentIndex->rankTfIdf(wordIds, limit)) {
+        result.emplace_back(documentIndex->documentName(document), score);
+    }
+
+    Logger::log(Logger::Debug, "Ranked documents for query '" + query + "', matches: " +
+               to_string(result.size()));
+    return result;
+}
+
 void Dictionary::clear() {
     size_t oldSize = wordMap.size();
     wordMap.clear();
+    wordsById.clear();
+    hashIndex.clear();
+    trigramIndex.clear();
+    if (spellIndex) spellIndex->clear();
+    if (nGrams) nGrams->clear();
+    if (cooccurrences) cooccurrences->clear();
+    if (documentIndex) documentIndex->clear();
+    countStatistics.clear();
+    if (admissionFilter) admissionFilter->clear();
+    if (follower) follower->clear();
+    pruning = PruningStatistics();
+    modificationVersion++;
     Logger::log(Logger::Info, "Dictionary cleared, previous size: " + to_string(oldSize));
 }
 
+void Dictionary::enableAdmissionFilter(size_t expectedVocabulary, double falsePositiveRate) {
+    admissionFilter = make_unique<AdmissionFilter>(expectedVocabulary, falsePositiveRate);
+    Logger::log(Logger::Info, "Admission filter enabled: " + to_string(admissionFilter->counterCount()) +
+               " counters, " + to_string(admissionFilter->hashCount()) + " hashes, " +
+               to_string(admissionFilter->memoryUsage()) + " bytes");
+}
+
+void Dictionary::disableAdmissionFilter() {
+    admissionFilter.reset();
+    Logger::log(Logger::Info, "Admission filter disabled");
+}
+
+bool Dictionary::isAdmissionFilterEnabled() const {
+    return admissionFilter != nullptr;
+}
+
+Dictionary::AdmissionStatistics Dictionary::admissionStatistics() const {
+    // Map node, key string, entry, id table slot and hash slots per word.
+    constexpr size_t EstimatedWordBytes = 4 * sizeof(void*) + sizeof(string) + sizeof(WordEntry) +
+                                          sizeof(WordMap::iterator) + 16;
+
+    AdmissionStatistics statistics;
+    if (!admissionFilter) return statistics;
+
+    statistics.pendingWords = admissionFilter->pending();
+    statistics.admittedWords = admissionFilter->admitted();
+    statistics.filterBytes = admissionFilter->memoryUsage();
+    statistics.estimatedBytesSaved = static_cast<int64_t>(statistics.pendingWords * EstimatedWordBytes) -
+                                     static_cast<int64_t>(statistics.filterBytes);
+    statistics.falsePositiveRate = admissionFilter->falsePositiveRate();
+    statistics.expectedFalseAdmissions = admissionFilter->expectedFalseAdmissions();
+    return statistics;
+}
+
+bool Dictionary::setVocabularyLimit(size_t maxWords, double retainFraction) {
+    if (maxWords && cooccurrences) {
+        Logger::log(Logger::Warning, "Vocabulary limit is not available with co-occurrence counting");
+        return false;
+    }
+
+    maxVocabulary = maxWords;
+    pruneRetainFraction = clamp(retainFraction, 0.0, 1.0);
+    Logger::log(Logger::Info, "Vocabulary limit set to " + to_string(maxWords));
+
+    if (maxVocabulary && wordMap.size() > maxVocabulary) pruneVocabulary(nullptr);
+    return true;
+}
+
+size_t Dictionary::vocabularyLimit() const {
+    return maxVocabulary;
+}
+
+uint64_t Dictionary::otherCount() const {
+    return pruning.evictedOccurrences;
+}
+
+Dictionary::PruningStatistics Dictionary::pruningStatistics() const {
+    return pruning;
+}
+
 size_t Dictionary::size() const {
     return wordMap.size();
 }
 
-string Dictionary::normalizeWord(const string& word) {
+int Dictionary::count(string_view word) const {
+    uint32_t id = hashIndex.find(hashWord(word), [&](uint32_t candidate) {
+        return wordsById[candidate]->first == word;
+    });
+    return id == WordHashIndex::Npos ? 0 : wordsById[id]->second.count;
+}
+
+void Dictionary::countMany(span<const string_view> words, span<uint64_t> counts) const {
+    uint64_t hashes[LookupBatchSize];
+
+    for (size_t base = 0; base < words.size(); base += LookupBatchSize) {
+        const size_t batch = min(LookupBatchSize, words.size() - base);
+
+        for (size_t i = 0; i < batch; i++) {
+            hashes[i] = hashWord(words[base + i]);
+            hashIndex.prefetch(hashes[i]);
+        }
+
+        for (size_t i = 0; i < batch; i++) {
+            uint32_t id = hashIndex.candidate(hashes[i]);
+            if (id != WordHashIndex::Npos) prefetchAddress(&wordsById[id]->second);
+        }
+
+        for (size_t i = 0; i < batch; i++) {
+            string_view word = words[base + i];
+            uint32_t id = hashIndex.find(hashes[i], [&](uint32_t candidate) {
+                return wordsById[candidate]->first == word;
+            });
+            counts[base + i] = id == WordHashIndex::Npos ? 0 : static_cast<uint64_t>(wordsById[id]->second.count);
+        }
+    }
+}
+
+FrozenDictionary Dictionary::freeze() const {
+    vector<pair<string, int>> words;
+    words.reserve(wordMap.size());
+    for (const auto& [word, entry] : wordMap) {
+        words.emplace_back(word, entry.count);
+    }
+
+    FrozenDictionary frozen;
+    frozen.build(words);
+    return frozen;
+}
+
+FstDictionary Dictionary::toFst() const {
+    FstDictionary fst;
+    fst.build(getWordsAlphabetically());
+    return fst;
+}
+
+Dictionary::WordEntry& Dictionary::insertWord(const string& word) {
+    return insertWord(word, hashWord(word));
+}
+
+Dictionary::WordEntry& Dictionary::insertWord(const string& word, uint64_t hash) {
+    uint32_t id = hashIndex.find(hash, [&](uint32_t candidate) {
+        return wordsById[candidate]->first == word;
+    });
+    if (id != WordHashIndex::Npos) return wordsById[id]->second;
+
+    id = static_cast<uint32_t>(wordsById.size());
+    auto it = wordMap.try_emplace(word, WordEntry{0, id}).first;
+    wordsById.push_back(it);
+    hashIndex.insert(hash, id);
+    trigramIndex.addWord(id, word);
+    if (spellIndex) spellIndex->addWord(id, word);
+    modificationVersion++;
+    return it->second;
+}
+
+Dictionary::WordEntry* Dictionary::admitWord(const string& word, uint64_t hash) {
+    if (!admissionFilter) return &insertWord(word, hash);
+
+    uint32_t id = hashIndex.find(hash, [&](uint32_t candidate) {
+        return wordsById[candidate]->first == word;
+    });
+    if (id != WordHashIndex::Npos) return &wordsById[id]->second;
+    if (!admissionFilter->admit(hash)) return nullptr;
+
+    // Credit back the first sighting the filter absorbed.
+    WordEntry& entry = insertWord(word, hash);
+    entry.count = 1;
+    countStatistics.move(0, 1);
+    return &entry;
+}
+
+void Dictionary::beginDocument() {
+    if (nGrams) nGrams->reset();
+    if (cooccurrences) cooccurrences->reset();
+}
+
+void Dictionary::addToken(IngestBatch& batch, string_view word) {
+    string normalizedWord = normalizeWord(word);
+    if (normalizedWord.empty()) return;
+
+    batch.words.push_back(std::move(normalizedWord));
+    if (batch.words.size() >= IngestBatchSize) flushTokens(batch);
+}
+
+void Dictionary::flushTokens(IngestBatch& batch) {
+    const size_t n = batch.words.size();
+    batch.hashes.resize(n);
+    for (size_t i = 0; i < n; i++) batch.hashes[i] = hashWord(batch.words[i]);
+
+    countTokens(batch, batch.words.data(), batch.hashes.data(), n);
+    batch.words.clear();
+}
+
+void Dictionary::countTokens(IngestBatch& batch, const string* words, const uint64_t* hashes, size_t n) {
+    for (size_t i = 0; i < n; i++) hashIndex.prefetch(hashes[i]);
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t id = hashIndex.candidate(hashes[i]);
+        if (id != WordHashIndex::Npos) prefetchAddress(&wordsById[id]->second);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        WordEntry* entry = admitWord(words[i], hashes[i]);
+        if (!entry) {
+            if (nGrams) nGrams->reset();
+            if (cooccurrences) cooccurrences->reset();
+            continue;
+        }
+        entry->count++;
+        countStatistics.move(entry->count - 1, entry->count);
+
+        if (nGrams) nGrams->push(entry->id);
+        if (cooccurrences) cooccurrences->push(entry->id);
+        if (documentIndex) batch.termFrequencies[entry->id]++;
+    }
+
+    if (n > 0) modificationVersion++;
+    batch.tokenCount += n;
+
+    if (maxVocabulary && wordMap.size() > maxVocabulary) pruneVocabulary(&batch);
+}
+
+void Dictionary::endDocument(IngestBatch& batch, const string& documentName) {
+    flushTokens(batch);
+
+    if (documentIndex) {
+        documentIndex->addDocument(documentName, batch.termFrequencies, batch.tokenCount);
+    }
+    batch.termFrequencies.clear();
+    batch.tokenCount = 0;
+}
+
+int64_t Dictionary::ingestFollowed(size_t index) {
+    StreamTokenizer tokenizer;
+    IngestBatch batch;
+    auto handler = [&](string_view token) { addToken(batch, token); };
+
+    beginDocument();
+    int64_t consumed = follower->readNew(index, [&](const char* data, size_t size) {
+        tokenizer.feed(data, size, handler);
+    });
+    tokenizer.finish(handler);
+
+    if (consumed > 0) {
+        endDocument(batch, follower->file(index).path);
+        Logger::log(Logger::Info, "Followed file updated: " + follower->file(index).path +
+                   ", bytes: " + to_string(consumed));
+    }
+    return consumed;
+}
+
+Dictionary::WordEntry* Dictionary::countWord(const string& word) {
+    if (word.empty()) return nullptr;
+
+    string normalizedWord = normalizeWord(word);
+    if (normalizedWord.empty()) return nullptr;
+
+    WordEntry* entry = admitWord(normalizedWord, hashWord(normalizedWord));
+    if (!entry) {
+        Logger::log(Logger::Debug, "Word held back until its second sighting: " + normalizedWord);
+        return nullptr;
+    }
+    entry->count++;
+    countStatistics.move(entry->count - 1, entry->count);
+    modificationVersion++;
+    Logger::log(Logger::Debug, "Added word: " + normalizedWord);
+    return entry;
+}
+
+void Dictionary::pruneVocabulary(IngestBatch* batch) {
+    const size_t total = wordMap.size();
+    const size_t target = static_cast<size_t>(static_cast<double>(maxVocabulary) * pruneRetainFraction);
+
+    // Smallest threshold that brings the vocabulary down to the target.
+    int threshold = max(pruning.minCount, 1);
+    if (total > target && countStatistics.wordCount() > 0) {
+        double fraction = static_cast<double>(total - target) / static_cast<double>(countStatistics.wordCount());
+        threshold = max(threshold, countStatistics.quantile(min(fraction, 1.0)));
+    }
+
+    vector<uint32_t> newIds(wordsById.size(), WordHashIndex::Npos);
+    vector<WordMap::iterator> kept;
+    kept.reserve(wordsById.size());
+    size_t evicted = 0;
+    for (uint32_t id = 0; id < wordsById.size(); id++) {
+        auto it = wordsById[id];
+        int count = it->second.count;
+        if (count <= threshold) {
+            pruning.evictedOccurrences += static_cast<uint64_t>(max(count, 0));
+            countStatistics.move(count, 0);
+            wordMap.erase(it);
+            evicted++;
+        } else {
+            newIds[id] = static_cast<uint32_t>(kept.size());
+            it->second.id = newIds[id];
+            kept.push_back(it);
+        }
+    }
+    wordsById.swap(kept);
+
+    hashIndex.remap(newIds);
+    trigramIndex.clear();
+    if (spellIndex) spellIndex->clear();
+    for (const auto& it : wordsById) {
+        trigramIndex.addWord(it->second.id, it->first);
+        if (spellIndex) spellIndex->addWord(it->second.id, it->first);
+    }
+    if (nGrams) nGrams->remap(newIds);
+    if (documentIndex) documentIndex->remap(newIds);
+
+    if (batch) {
+        unordered_map<uint32_t, uint32_t> termFrequencies;
+        for (const auto& [id, frequency] : batch->termFrequencies) {
+            if (newIds[id] != WordHashIndex::Npos) termFrequencies[newIds[id]] = frequency;
+        }
+        batch->termFrequencies.swap(termFrequencies);
+    }
+
+    pruning.passes++;
+    pruning.evictedWords += evicted;
+    pruning.minCount = threshold;
+    modificationVersion++;
+
+    Logger::log(Logger::Info, "Vocabulary pruned: evicted " + to_string(evicted) + " words with count <= " +
+               to_string(threshold) + ", remaining " + to_string(wordMap.size()));
+}
+
+const Dictionary::WordEntry* Dictionary::findWord(const string& word) const {
+    auto it = wordMap.find(normalizeWord(word));
+    return it == wordMap.end() ? nullptr : &it->second;
+}
+
+vector<pair<string, int>> Dictionary::nGramStrings(int order) const {
+    vector<pair<string, int>> nGramList;
+    if (!nGrams) return nGramList;
+
+    auto entries = nGrams->entries(order);
+    nGramList.reserve(entries.size());
+    for (const auto& [ids, count] : entries) {
+        string text = wordsById[ids[0]]->first;
+        for (int i = 1; i < order; i++) {
+            text += ' ';
+            text += wordsById[ids[i]]->first;
+        }
+        nGramList.emplace_back(std::move(text), count);
+    }
+    return nGramList;
+}
+
+const vector<uint32_t>& Dictionary::sortedIds(SortOrder order) const {
+    SortedIds& view = sortedViews[order];
+    if (view.version == modificationVersion) return view.ids;
+
+    if (order == Alphabetical) {
+        view.ids.clear();
+        view.ids.reserve(wordMap.size());
+        for (const auto& [word, entry] : wordMap) {
+            view.ids.push_back(entry.id);
+        }
+    } else {
+        // Ties keep the alphabetical order, so only counts are compared.
+        view.ids = sortedIds(Alphabetical);
+        ParallelSort::byCountDescending(view.ids, [this](uint32_t id) {
+            return static_cast<uint32_t>(max(wordsById[id]->second.count, 0));
+        });
+    }
+    view.version = modificationVersion;
+    return view.ids;
+}
+
+string Dictionary::normalizeWord(string_view word) const {
     string result;
+    normalizeWord(word, result);
+    return result;
+}
+
+void Dictionary::normalizeWord(string_view word, string& result) const {
+    const locale current;
+    result.clear();
     result.reserve(word.size());
 
-    for (char c : word) {
-        if (isalpha(c, locale()) || isdigit(c) || c == '_') {
-            if (isalpha(c, locale())) {
-                result.push_back(tolower(c, locale()));
+    for (size_t i = 0; i < word.size(); i++) {
+        char c = word[i];
+        if (static_cast<unsigned char>(c) >= 0x80) {
+            // Two-byte UTF-8 sequences of the Cyrillic block; other non-ASCII is dropped.
+            if (i + 1 < word.size() && (static_cast<unsigned char>(word[i + 1]) & 0xC0) == 0x80) {
+                uint32_t codePoint = (static_cast<uint32_t>(c) & 0x1F) << 6 | (static_cast<unsigned char>(word[i + 1]) & 0x3F);
+                if ((static_cast<unsigned char>(c) & 0xE0) == 0xC0 && isCyrillicLetter(codePoint)) {
+                    codePoint = lowerCyrillic(codePoint);
+                    result.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+                    result.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+                    i++;
+                }
+            }
+            continue;
+        }
+
+        if (isalpha(c, current) || isdigit(c) || c == '_') {
+            if (isalpha(c, current)) {
+                result.push_back(tolower(c, current));
             } else {
                 result.push_back(c);
             }
         }
     }
-
-    return result;
 }
@@ -2,27 +2,185 @@
 #define DICTIONARY_H
 
 #include <string>
+#include <string_view>
+#include <span>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <cstdint>
+#include <memory>
+#include <array>
+#include <climits>
 #include <QString>
 #include <QFile>
 #include <QTextStream>
+#include "trigramindex.h"
+#include "spellindex.h"
+#include "ngramcounter.h"
+#include "cooccurrencecounter.h"
+#include "invertedindex.h"
+#include "frozendictionary.h"
+#include "fstdictionary.h"
+#include "wordhashindex.h"
+#include "countstatistics.h"
+#include "admissionfilter.h"
+#include "filefollower.h"
+#include "filescheduler.h"
+#include "ingestpipeline.h"
+#include "partialcache.h"
 
 using namespace std;
 
 class Dictionary {
 public:
+    enum SearchMode {
+        Substring,
+        Regex
+    };
+
+    struct FuzzyMatch {
+        string word;
+        int count;
+        int distance;
+    };
+
+    struct PruningStatistics {
+        size_t passes = 0;
+        size_t evictedWords = 0;
+        // Occurrences of evicted words: the "other" counter.
+        uint64_t evictedOccurrences = 0;
+        // Words with at most this count were evicted by the last pass.
+        int minCount = 0;
+    };
+
+    struct AdmissionStatistics {
+        // First sightings held in the filter instead of the word table.
+        size_t pendingWords = 0;
+        uint64_t admittedWords = 0;
+        size_t filterBytes = 0;
+        // Word table memory the pending words would take, minus the filter.
+        int64_t estimatedBytesSaved = 0;
+        double falsePositiveRate = 0.0;
+        // Words counted one too high because they were admitted on a false positive.
+        double expectedFalseAdmissions = 0.0;
+    };
+
+    enum SortOrder {
+        Alphabetical,
+        ByFrequency
+    };
+
+    // Non-owning view over a cached ordering of the words. It stays valid
+    // until the dictionary is modified.
+    class WordView {
+    public:
+        class Iterator {
+        public:
+            pair<string_view, int> operator*() const { return (*view)[index]; }
+            Iterator& operator++() { index++; return *this; }
+            bool operator==(const Iterator& other) const { return index == other.index; }
+            bool operator!=(const Iterator& other) const { return index != other.index; }
+
+        private:
+            friend class WordView;
+            Iterator(const WordView* view, size_t index) : view(view), index(index) {}
+
+            const WordView* view;
+            size_t index;
+        };
+
+        size_t size() const { return length; }
+        bool empty() const { return length == 0; }
+        pair<string_view, int> operator[](size_t i) const;
+        Iterator begin() const { return Iterator(this, 0); }
+        Iterator end() const { return Iterator(this, size()); }
+
+        // At most limit entries starting at offset, clamped to this view.
+        WordView subview(size_t offset, size_t limit) const;
+
+    private:
+        friend class Dictionary;
+        WordView(const Dictionary* dictionary, const vector<uint32_t>* order, size_t first, size_t length)
+            : dictionary(dictionary), order(order), first(first), length(length) {}
+
+        const Dictionary* dictionary;
+        const vector<uint32_t>* order;
+        size_t first;
+        size_t length;
+    };
+
+    class Cursor;
+
     Dictionary();
     ~Dictionary();
 
     void addWord(const string& word);
 
+    // Accepts regular files as well as FIFOs and character devices, plain or compressed.
     bool addWordsFromFile(const QString& filePath);
 
+    // Streams an already open device (pipe, socket, process output, ...) to
+    // its end through an IngestPipeline: reading, tokenizing and counting
+    // overlap, and tokens split between reads are joined. Counted as one
+    // document named documentName. gzip, zstd and xz input is recognised by
+    // its magic bytes and decompressed on a separate thread, which then does
+    // the reading as well. CP1251 and UTF-16 text is converted to UTF-8 on
+    // the way (see TextDecoder). Input that fits one buffer is counted directly.
+    bool addWordsFromDevice(QIODevice& device, const string& documentName = "<stream>");
+
+    // Stage timings of the last input that went through the pipeline.
+    const IngestPipeline::Statistics& lastIngestStatistics() const;
+
+    bool addWordsFromFileDescriptor(int fd, const string& documentName);
+
+    bool addWordsFromStdin();
+
+    // Reads the files through AsyncFileReader (io_uring where the kernel
+    // allows it), overlapping I/O with counting; each file is one document.
+    // Compressed files are passed on to addWordsFromFile(). progress runs on
+    // the calling thread after each file.
+    bool addWordsFromFiles(const vector<string>& filePaths,
+                           const FileScheduler::ProgressCallback& progress = nullptr);
+
+    // Counts every file under directory whose name matches namePattern
+    // ("*.txt;*.log"). Files are read in parallel into per-worker tables
+    // that are merged in word order at the end, so the result does not
+    // depend on threads (0: one per pool thread). With n-grams,
+    // co-occurrences, the document index, the admission filter or a
+    // vocabulary limit active the files are counted in path order through
+    // addWordsFromFiles() instead. progress runs on the calling thread.
+    bool addWordsFromDirectory(const QString& directory, const QString& namePattern = "*", bool recursive = true,
+                               const FileScheduler::ProgressCallback& progress = nullptr, int threads = 0);
+
+    // Keeps the counts of every file addWordsFromDirectory() reads in a
+    // PartialCache under cacheDirectory, so that repeated runs over a corpus
+    // only read the files that changed and merge the stored counts of the
+    // rest. Not used on the ordered path. An empty path turns it off.
+    bool setIngestCache(const QString& cacheDirectory);
+
+    // Follow mode for growing files such as logs: counts the complete lines
+    // present now, and pollFollowedFiles() later counts only what was
+    // appended. Offsets are saved as "<dict>.follow", so a reloaded
+    // dictionary resumes without counting anything twice. clear() forgets
+    // the followed files.
+    bool followFile(const QString& filePath);
+
+    bool unfollowFile(const QString& filePath);
+
+    vector<string> followedFiles() const;
+
+    // Counts lines appended since the last poll, coping with truncation and
+    // rotation. Each file's new lines form one document. Returns the number
+    // of bytes consumed.
+    uint64_t pollFollowedFiles();
+
+    // Sleeps until a followed file changes or timeoutMs passes; false on timeout.
+    bool waitForFollowedFiles(int timeoutMs);
+
     bool saveToFile(const QString& filePath);
 
     bool loadFromFile(const QString& filePath);
@@ -31,14 +189,225 @@ public:
 
     vector<pair<string, int>> getWordsByFrequency() const;
 
+    // Sorted once per modification; repeated calls reuse the cached order.
+    WordView words(SortOrder order) const;
+
+    // One page of a sorted view, served from the cached order without copying.
+    WordView range(SortOrder order, size_t offset, size_t limit) const;
+
+    Cursor cursor(SortOrder order, size_t offset = 0) const;
+
+    // Incremented whenever words or counts change.
+    uint64_t version() const;
+
+    // Position in frequency order, starting at 1; words with equal counts
+    // share a rank. 0 if the word is absent.
+    size_t rank(const string& word) const;
+
+    // Smallest count c such that at least fraction q of the words occur at most c times.
+    int frequencyQuantile(double q) const;
+
+    size_t countWordsInRange(int minCount, int maxCount = INT_MAX) const;
+
+    // Words with minCount <= count <= maxCount, in frequency order.
+    WordView wordsInCountRange(int minCount, int maxCount = INT_MAX) const;
+
+    vector<pair<string, int>> search(const string& pattern, SearchMode mode = Substring) const;
+
+    void enableFuzzyIndex(int maxEditDistance = 2, int prefixLength = 7);
+
+    void disableFuzzyIndex();
+
+    bool isFuzzyIndexEnabled() const;
+
+    size_t fuzzyIndexMemoryUsage() const;
+
+    vector<FuzzyMatch> fuzzyLookup(const string& word, int maxDistance = 2) const;
+
+    void setNGramOrder(int order);
+
+    int nGramOrder() const;
+
+    size_t nGramCount(int order) const;
+
+    vector<pair<string, int>> getNGramsAlphabetically(int order) const;
+
+    vector<pair<string, int>> getNGramsByFrequency(int order) const;
+
+    bool saveNGramsToFile(const QString& filePath, int order);
+
+    // Not available together with a vocabulary limit, since spilled pairs
+    // cannot follow the id renumbering of a pruning pass.
+    bool enableCooccurrence(int window, int threads = 0, size_t maxPairsInMemory = 1 << 24,
+                            const QString& spillDirectory = QString());
+
+    void disableCooccurrence();
+
+    bool isCooccurrenceEnabled() const;
+
+    // Writes the binary triplet file plus "<filePath>.vocab" mapping word ids
+    // (line numbers, starting at 0) to words and counts.
+    bool exportCooccurrences(const QString& filePath);
+
+    // Tracks which ingested file each word came from; saved as "<dict>.idx".
+    void enableDocumentIndex();
+
+    void disableDocumentIndex();
+
+    bool isDocumentIndexEnabled() const;
+
+    size_t documentCount() const;
+
+    string documentName(uint32_t documentId) const;
+
+    uint32_t documentFrequency(const string& word) const;
+
+    InvertedIndex::PostingIterator postings(const string& word) const;
+
+    vector<pair<string, double>> rankDocuments(const string& query, size_t limit = 10) const;
+
     void clear();
 
+    // Stores a word only from its second sighting on, crediting the first one
+    // back on insertion; until then count() reports 0 and it takes no part in
+    // n-grams, co-occurrences or document postings.
+    void enableAdmissionFilter(size_t expectedVocabulary, double falsePositiveRate = 0.01);
+
+    void disableAdmissionFilter();
+
+    bool isAdmissionFilterEnabled() const;
+
+    AdmissionStatistics admissionStatistics() const;
+
+    // Caps the vocabulary ReduceVocab-style: once it holds more than maxWords
+    // words, every word at or below an adaptive count threshold is evicted so
+    // that about retainFraction * maxWords remain. The threshold never goes
+    // down between passes. 0 removes the cap.
+    bool setVocabularyLimit(size_t maxWords, double retainFraction = 0.75);
+
+    size_t vocabularyLimit() const;
+
+    uint64_t otherCount() const;
+
+    PruningStatistics pruningStatistics() const;
+
     size_t size() const;
 
+    // Count of an already normalized word, 0 if absent.
+    int count(string_view word) const;
+
+    // Batched count(): hashes the whole batch and prefetches the hash slots
+    // and entries before resolving them. counts must be as long as words.
+    void countMany(span<const string_view> words, span<uint64_t> counts) const;
+
+    FrozenDictionary freeze() const;
+
+    // Compact read-only form built from the alphabetical word list.
+    FstDictionary toFst() const;
+
+private:
+    struct WordEntry {
+        int count;
+        uint32_t id;
+    };
+
+    using WordMap = map<string, WordEntry, less<>>;
+
+    struct IngestBatch {
+        vector<string> words;
+        vector<uint64_t> hashes;
+        unordered_map<uint32_t, uint32_t> termFrequencies;
+        uint64_t tokenCount = 0;
+    };
+
+    struct SortedIds {
+        vector<uint32_t> ids;
+        uint64_t version = UINT64_MAX;
+    };
+
+    static constexpr size_t LookupBatchSize = 16;
+    static constexpr size_t IngestBatchSize = 64;
+    static constexpr size_t StreamBufferSize = 1 << 20;
+
+    WordMap wordMap;
+    vector<WordMap::iterator> wordsById;
+    WordHashIndex hashIndex;
+    TrigramIndex trigramIndex;
+    unique_ptr<SpellIndex> spellIndex;
+    unique_ptr<NGramCounter> nGrams;
+    unique_ptr<CooccurrenceCounter> cooccurrences;
+    unique_ptr<InvertedIndex> documentIndex;
+    unique_ptr<AdmissionFilter> admissionFilter;
+    unique_ptr<FileFollower> follower;
+    unique_ptr<PartialCache> ingestCache;
+    CountStatistics countStatistics;
+    uint64_t modificationVersion = 0;
+    mutable array<SortedIds, 2> sortedViews;
+    size_t maxVocabulary = 0;
+    double pruneRetainFraction = 0.75;
+    PruningStatistics pruning;
+    IngestPipeline::Statistics ingestStatistics;
+
+    WordEntry& insertWord(const string& word);
+
+    WordEntry& insertWord(const string& word, uint64_t hash);
+
+    // insertWord() behind the admission filter; nullptr while the word is held back.
+    WordEntry* admitWord(const string& word, uint64_t hash);
+
+    void beginDocument();
+
+    void addToken(IngestBatch& batch, string_view word);
+
+    void flushTokens(IngestBatch& batch);
+
+    // Counts n normalized words whose hashes are already known.
+    void countTokens(IngestBatch& batch, const string* words, const uint64_t* hashes, size_t n);
+
+    void endDocument(IngestBatch& batch, const string& documentName);
+
+    int64_t ingestFollowed(size_t index);
+
+    WordEntry* countWord(const string& word);
+
+    void pruneVocabulary(IngestBatch* batch);
+
+    const WordEntry* findWord(const string& word) const;
+
+    vector<pair<string, int>> nGramStrings(int order) const;
+
+    const vector<uint32_t>& sortedIds(SortOrder order) const;
+
+    string normalizeWord(string_view word) const;
+
+    // Into result, reusing its buffer. Keeps ASCII letters, digits, '_' and
+    // UTF-8 Cyrillic letters, all lowercased.
+    void normalizeWord(string_view word, string& result) const;
+};
+
+// Streams the words of one order with constant extra memory: alphabetical
+// cursors walk the map itself, frequency cursors the cached permutation.
+// Like views, cursors are invalidated by any modification.
+class Dictionary::Cursor {
+public:
+    // Moves to the next entry; the first call yields the entry at the start offset.
+    bool next();
+
+    string_view word() const;
+
+    int count() const;
+
+    size_t position() const;
+
 private:
-    map<string, int> wordMap;
+    friend class Dictionary;
+    Cursor(const Dictionary* dictionary, SortOrder order, size_t offset);
 
-    string normalizeWord(const string& word);
+    const Dictionary* dictionary;
+    SortOrder order;
+    WordMap::const_iterator current;
+    size_t index;
+    bool started;
 };
 
 #endif // DICTIONARY_H 
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "eytzingerindex.h"
+#include "wordhashindex.h"
+#include <bit>
+#include <stdexcept>
+
+using namespace std;
+
+void EytzingerIndex::build(const vector<pair<string, int>>& sortedWords) {
+    const size_t n = sortedWords.size();
+
+    size_t blobSize = 0;
+    for (const auto& [word, count] : sortedWords) {
+        blobSize += word.size();
+    }
+    if (blobSize > UINT32_MAX || n >= UINT32_MAX) {
+        throw length_error("Eytzinger index exceeds 32-bit offsets");
+    }
+
+    keys.clear();
+    keys.reserve(blobSize);
+    keyOffsets.assign(1, 0);
+    keyOffsets.reserve(n + 1);
+    counts.clear();
+    counts.reserve(n);
+    for (const auto& [word, count] : sortedWords) {
+        keys += word;
+        keyOffsets.push_back(static_cast<uint32_t>(keys.size()));
+        counts.push_back(count);
+    }
+
+    prefixes.assign(n + 1, 0);
+    ranks.assign(n + 1, 0);
+
+    // An in-order walk of the implicit tree rooted at 1 visits BFS
+    // positions in sorted order, so each visit takes the next key.
+    place(0, 1);
+}
+
+size_t EytzingerIndex::place(size_t next, size_t k) {
+    if (k >= prefixes.size()) return next;
+
+    next = place(next, 2 * k);
+    ranks[k] = static_cast<uint32_t>(next);
+    prefixes[k] = prefixOf(keyAt(next));
+    return place(next + 1, 2 * k + 1);
+}
+
+size_t EytzingerIndex::lowerBound(string_view key) const {
+    const size_t n = size();
+    const uint64_t prefix = prefixOf(key);
+
+    size_t k = 1;
+    while (k <= n) {
+        prefetchAddress(prefixes.data() + min(8 * k, n));
+        const uint64_t nodePrefix = prefixes[k];
+        bool less = nodePrefix < prefix || (nodePrefix == prefix && keyAt(ranks[k]) < key);
+        k = 2 * k + (less ? 1 : 0);
+    }
+    k >>= countr_one(k) + 1;
+
+    return k == 0 ? n : ranks[k];
+}
+
+size_t EytzingerIndex::find(string_view key) const {
+    size_t rank = lowerBound(key);
+    return rank < size() && keyAt(rank) == key ? rank : npos;
+}
+
+string_view EytzingerIndex::keyAt(size_t rank) const {
+    return string_view(keys.data() + keyOffsets[rank], keyOffsets[rank + 1] - keyOffsets[rank]);
+}
+
+int EytzingerIndex::countAt(size_t rank) const {
+    return counts[rank];
+}
+
+size_t EytzingerIndex::size() const {
+    return counts.size();
+}
+
+size_t EytzingerIndex::memoryUsage() const {
+    return prefixes.capacity() * sizeof(uint64_t) + ranks.capacity() * sizeof(uint32_t) +
+           keys.capacity() + keyOffsets.capacity() * sizeof(uint32_t) + counts.capacity() * sizeof(int);
+}
+
+uint64_t EytzingerIndex::prefixOf(string_view key) {
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; i++) {
+        prefix = (prefix << 8) | (i < key.size() ? static_cast<unsigned char>(key[i]) : 0);
+    }
+    return prefix;
+}
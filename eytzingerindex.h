@@ -0,0 +1,48 @@
+#ifndef EYTZINGERINDEX_H
+#define EYTZINGERINDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// Read-only sorted word index laid out in Eytzinger (BFS) order. Searches
+// compare fixed-width 8-byte key prefixes and only touch the full key when
+// prefixes tie, so a lower-bound walk reads one small array whose next levels
+// can be prefetched, instead of jumping across a vector of strings.
+class EytzingerIndex {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // Builds in linear time from words already sorted by key.
+    void build(const vector<pair<string, int>>& sortedWords);
+
+    // Rank of the first word that is not less than key (size() if none).
+    size_t lowerBound(string_view key) const;
+
+    // Rank of key, or npos if it is absent.
+    size_t find(string_view key) const;
+
+    string_view keyAt(size_t rank) const;
+
+    int countAt(size_t rank) const;
+
+    size_t size() const;
+
+    size_t memoryUsage() const;
+
+private:
+    vector<uint64_t> prefixes;
+    vector<uint32_t> ranks;
+    string keys;
+    vector<uint32_t> keyOffsets;
+    vector<int> counts;
+
+    size_t place(size_t next, size_t k);
+
+    static uint64_t prefixOf(string_view key);
+};
+
+#endif // EYTZINGERINDEX_H
@@ -0,0 +1,277 @@
+#include "filefollower.h"
+#include "logger.h"
+#include <QFileInfo>
+#include <QDir>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+bool statPath(const string& path, uint64_t& inode) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) return false;
+    inode = static_cast<uint64_t>(info.st_ino);
+    return true;
+}
+
+}
+
+FileFollower::FileFollower() {
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        Logger::log(Logger::Warning, "inotify unavailable, followed files will be polled");
+    }
+#endif
+}
+
+FileFollower::~FileFollower() {
+#ifdef __linux__
+    if (inotifyFd >= 0) ::close(inotifyFd);
+#endif
+}
+
+bool FileFollower::add(const FileState& state) {
+    if (indexOf(state.path) >= 0) return false;
+
+    Followed followed{state, nullptr};
+    if (!open(followed)) return false;
+
+    watchDirectoryOf(state.path);
+    files.push_back(std::move(followed));
+    Logger::log(Logger::Info, "Following file: " + state.path + " from offset " +
+               to_string(files.back().state.offset));
+    return true;
+}
+
+bool FileFollower::remove(const string& path) {
+    int index = indexOf(path);
+    if (index < 0) return false;
+    files.erase(files.begin() + index);
+    return true;
+}
+
+int FileFollower::indexOf(const string& path) const {
+    for (size_t i = 0; i < files.size(); i++) {
+        if (files[i].state.path == path) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+size_t FileFollower::size() const {
+    return files.size();
+}
+
+const FileFollower::FileState& FileFollower::file(size_t index) const {
+    return files[index].state;
+}
+
+int64_t FileFollower::readNew(size_t index, const BlockHandler& handler) {
+    Followed& followed = files[index];
+    if (!followed.file && !open(followed)) return -1;
+
+    int64_t consumed = 0;
+    uint64_t pathInode = 0;
+    if (statPath(followed.state.path, pathInode) && pathInode != followed.state.inode) {
+        // Rotated: whatever was written to the old file before the switch,
+        // unterminated last line included, still belongs to the count.
+        int64_t drained = readComplete(followed, true, handler);
+        if (drained > 0) {
+            consumed += drained;
+            // Keeps the last word of the old file apart from the first of the new one.
+            handler("\n", 1);
+        }
+        Logger::log(Logger::Info, "Followed file rotated: " + followed.state.path);
+
+        followed.file.reset();
+        followed.state.inode = 0;
+        followed.state.offset = 0;
+        if (!open(followed)) return consumed;
+    }
+
+    if (static_cast<uint64_t>(followed.file->size()) < followed.state.offset) {
+        Logger::log(Logger::Info, "Followed file truncated: " + followed.state.path);
+        followed.state.offset = 0;
+    }
+
+    int64_t read = readComplete(followed, false, handler);
+    if (read < 0) return consumed > 0 ? consumed : -1;
+    return consumed + read;
+}
+
+bool FileFollower::waitForChanges(int timeoutMs) {
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        pollfd descriptor{inotifyFd, POLLIN, 0};
+        if (::poll(&descriptor, 1, timeoutMs) <= 0) return false;
+
+        // Only the wake-up matters; readNew() finds out what changed.
+        alignas(inotify_event) char events[4096];
+        while (::read(inotifyFd, events, sizeof(events)) > 0) {
+        }
+        return true;
+    }
+#endif
+    this_thread::sleep_for(chrono::milliseconds(timeoutMs));
+    return true;
+}
+
+void FileFollower::clear() {
+    files.clear();
+}
+
+bool FileFollower::save(const QString& filePath, uint64_t checkpoint) const {
+    string text;
+    if (checkpoint != 0) text += "checkpoint " + to_string(checkpoint) + "\n";
+    for (const auto& followed : files) {
+        text += to_string(followed.state.offset) + " " + to_string(followed.state.inode) + " " +
+                followed.state.path + "\n";
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        Logger::log(Logger::Error, "Failed to save follow state to file: " + filePath.toStdString());
+        return false;
+    }
+    bool written = file.write(text.data(), static_cast<qint64>(text.size())) == static_cast<qint64>(text.size());
+    file.close();
+
+    if (!written) {
+        Logger::log(Logger::Error, "Failed to write follow state: " + filePath.toStdString());
+    }
+    return written;
+}
+
+bool FileFollower::load(const QString& filePath) {
+    clear();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        Logger::log(Logger::Error, "Failed to open follow state: " + filePath.toStdString());
+        return false;
+    }
+    QByteArray content = file.readAll();
+    file.close();
+
+    istringstream in(string(content.constData(), static_cast<size_t>(content.size())));
+    string line;
+    while (getline(in, line)) {
+        istringstream fields(line);
+        FileState state;
+        if (!(fields >> state.offset >> state.inode)) continue;
+        getline(fields >> ws, state.path);
+        if (state.path.empty() || indexOf(state.path) >= 0) continue;
+
+        // A file that is missing right now is opened again by readNew().
+        Followed followed{state, nullptr};
+        open(followed);
+        watchDirectoryOf(state.path);
+        files.push_back(std::move(followed));
+    }
+
+    Logger::log(Logger::Info, "Follow state loaded from file: " + filePath.toStdString() +
+               ", files: " + to_string(files.size()));
+    return true;
+}
+
+uint64_t FileFollower::checkpoint(const QString& filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+    char line[64] = {};
+    qint64 bytesRead = file.read(line, static_cast<qint64>(sizeof(line) - 1));
+    file.close();
+    if (bytesRead <= 0) return 0;
+
+    istringstream in(string(line, static_cast<size_t>(bytesRead)));
+    string keyword;
+    uint64_t value = 0;
+    return in >> keyword >> value && keyword == "checkpoint" ? value : 0;
+}
+
+bool FileFollower::open(Followed& followed) {
+    auto file = make_unique<QFile>(QString::fromStdString(followed.state.path));
+    if (!file->open(QIODevice::ReadOnly)) {
+        Logger::log(Logger::Warning, "Cannot open followed file: " + followed.state.path);
+        return false;
+    }
+
+    struct stat info;
+    uint64_t inode = ::fstat(file->handle(), &info) == 0 ? static_cast<uint64_t>(info.st_ino) : 0;
+    if (followed.state.inode != 0 && followed.state.inode != inode) {
+        Logger::log(Logger::Warning, "Followed file was replaced while not followed, reading from the start: " +
+                   followed.state.path);
+        followed.state.offset = 0;
+    }
+    if (static_cast<uint64_t>(file->size()) < followed.state.offset) {
+        followed.state.offset = 0;
+    }
+
+    followed.state.inode = inode;
+    followed.file = std::move(file);
+    return true;
+}
+
+int64_t FileFollower::readComplete(Followed& followed, bool finalRead, const BlockHandler& handler) {
+    if (buffer.empty()) buffer.resize(ReadBufferSize);
+
+    int64_t consumed = 0;
+    while (true) {
+        if (!followed.file->seek(static_cast<qint64>(followed.state.offset))) return -1;
+        qint64 bytesRead = followed.file->read(buffer.data(), static_cast<qint64>(buffer.size()));
+        if (bytesRead < 0) {
+            Logger::log(Logger::Error, "Read error on followed file: " + followed.state.path);
+            return -1;
+        }
+        if (bytesRead == 0) break;
+
+        size_t length = static_cast<size_t>(bytesRead);
+        auto lastNewline = find(make_reverse_iterator(buffer.begin() + length), buffer.rend(), '\n');
+        size_t complete = static_cast<size_t>(buffer.rend() - lastNewline);
+
+        // A line longer than the whole buffer is passed on in pieces rather
+        // than stalling the file.
+        if (finalRead) {
+            complete = length;
+        } else if (complete == 0) {
+            if (length < buffer.size()) break;
+            complete = length;
+        }
+
+        handler(buffer.data(), complete);
+        followed.state.offset += complete;
+        consumed += static_cast<int64_t>(complete);
+
+        if (length < buffer.size() && complete < length) break;
+    }
+    return consumed;
+}
+
+void FileFollower::watchDirectoryOf(const string& path) {
+#ifdef __linux__
+    if (inotifyFd < 0) return;
+
+    string directory = QFileInfo(QString::fromStdString(path)).dir().absolutePath().toStdString();
+    if (find(watchedDirectories.begin(), watchedDirectories.end(), directory) != watchedDirectories.end()) return;
+
+    // Watching the directory rather than the file also catches the new file
+    // that appears at the path after a rotation.
+    if (inotify_add_watch(inotifyFd, directory.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) >= 0) {
+        watchedDirectories.push_back(directory);
+    } else {
+        Logger::log(Logger::Warning, "Cannot watch directory: " + directory);
+    }
+#else
+    (void)path;
+#endif
+}
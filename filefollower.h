@@ -0,0 +1,91 @@
+#ifndef FILEFOLLOWER_H
+#define FILEFOLLOWER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <QString>
+#include <QFile>
+
+using namespace std;
+
+// Tails growing files (logs) by byte offset. Each read hands over only
+// the complete lines appended since the previous one. A file that shrank
+// below its offset is taken as truncated and read again from the start;
+// a different inode at the path as rotated, in which case the rest of the
+// old file is read through the still open handle before switching over.
+// On Linux an inotify watch on the parent directories lets
+// waitForChanges() sleep until something is written.
+class FileFollower {
+public:
+    struct FileState {
+        string path;
+        uint64_t inode = 0;
+        uint64_t offset = 0;
+    };
+
+    using BlockHandler = function<void(const char* data, size_t size)>;
+
+    static constexpr size_t ReadBufferSize = 1 << 20;
+
+    FileFollower();
+    ~FileFollower();
+
+    FileFollower(const FileFollower&) = delete;
+    FileFollower& operator=(const FileFollower&) = delete;
+
+    // Starts at offset 0, or resumes from a saved state. False if the file
+    // cannot be opened or is already followed.
+    bool add(const FileState& state);
+
+    bool remove(const string& path);
+
+    // -1 if not followed.
+    int indexOf(const string& path) const;
+
+    size_t size() const;
+
+    const FileState& file(size_t index) const;
+
+    // Passes the complete lines appended to file index since the last call
+    // to handler, in blocks that end with a newline. Returns the number of
+    // bytes consumed, -1 if the file could not be read.
+    int64_t readNew(size_t index, const BlockHandler& handler);
+
+    // Blocks until a followed file may have changed or timeoutMs elapses.
+    // Without inotify it simply sleeps. False on timeout.
+    bool waitForChanges(int timeoutMs);
+
+    void clear();
+
+    // One "offset inode path" line per file. A nonzero checkpoint is written
+    // first, so that the state can be matched to the dictionary it was
+    // saved with.
+    bool save(const QString& filePath, uint64_t checkpoint = 0) const;
+
+    bool load(const QString& filePath);
+
+    // The checkpoint save() was given; 0 if none or the file is unreadable.
+    static uint64_t checkpoint(const QString& filePath);
+
+private:
+    struct Followed {
+        FileState state;
+        unique_ptr<QFile> file;
+    };
+
+    vector<Followed> files;
+    vector<char> buffer;
+    int inotifyFd = -1;
+    vector<string> watchedDirectories;
+
+    bool open(Followed& followed);
+
+    int64_t readComplete(Followed& followed, bool finalRead, const BlockHandler& handler);
+
+    void watchDirectoryOf(const string& path);
+};
+
+#endif // FILEFOLLOWER_H
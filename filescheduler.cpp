@@ -0,0 +1,314 @@
+#include "filescheduler.h"
+#include "threadpool.h"
+#include "streamtokenizer.h"
+#include "logger.h"
+#include <QFile>
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+
+using namespace std;
+
+namespace {
+
+constexpr auto ProgressInterval = chrono::milliseconds(100);
+constexpr size_t ExtensionPieceSize = 4096;
+
+bool matchesWildcard(string_view name, string_view pattern) {
+    size_t n = 0;
+    size_t p = 0;
+    size_t starPattern = string_view::npos;
+    size_t starName = 0;
+
+    while (n < name.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+            n++;
+            p++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            starPattern = p++;
+            starName = n;
+        } else if (starPattern != string_view::npos) {
+            p = starPattern + 1;
+            n = ++starName;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') p++;
+    return p == pattern.size();
+}
+
+// Reads until size bytes or the end of the file.
+int64_t readFully(QFile& file, char* data, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        qint64 bytesRead = file.read(data + total, static_cast<qint64>(size - total));
+        if (bytesRead < 0) return -1;
+        if (bytesRead == 0) break;
+        total += static_cast<size_t>(bytesRead);
+    }
+    return static_cast<int64_t>(total);
+}
+
+}
+
+vector<string> FileScheduler::listFiles(const string& directory, const string& namePattern, bool recursive) {
+    vector<string> files;
+    error_code error;
+    auto options = filesystem::directory_options::skip_permission_denied;
+
+    auto consider = [&](const filesystem::directory_entry& entry) {
+        if (entry.is_regular_file(error) && matchesPattern(entry.path().filename().string(), namePattern)) {
+            files.push_back(entry.path().string());
+        }
+    };
+
+    if (recursive) {
+        for (filesystem::recursive_directory_iterator it(directory, options, error), end; it != end; it.increment(error)) {
+            consider(*it);
+        }
+    } else {
+        for (filesystem::directory_iterator it(directory, options, error), end; it != end; it.increment(error)) {
+            consider(*it);
+        }
+    }
+
+    sort(files.begin(), files.end());
+    return files;
+}
+
+bool FileScheduler::matchesPattern(string_view name, string_view pattern) {
+    while (true) {
+        size_t separator = pattern.find(';');
+        if (matchesWildcard(name, pattern.substr(0, separator))) return true;
+        if (separator == string_view::npos) return false;
+        pattern.remove_prefix(separator + 1);
+    }
+}
+
+FileScheduler::FileScheduler(vector<string> paths, uint64_t chunkSize, vector<bool> streamed)
+    : paths(std::move(paths)) {
+    if (chunkSize == 0) chunkSize = DefaultChunkSize;
+
+    rangesPerFile.reserve(this->paths.size());
+
+    vector<Range> batch;
+    uint64_t batchBytes = 0;
+    auto flushBatch = [&]() {
+        if (batch.empty()) return;
+        units.push_back(std::move(batch));
+        batch.clear();
+        batchBytes = 0;
+    };
+
+    for (size_t file = 0; file < this->paths.size(); file++) {
+        error_code error;
+        uint64_t size = filesystem::file_size(this->paths[file], error);
+        if (error) size = 0;
+        totalBytes += size;
+        bool stream = file < streamed.size() && streamed[file];
+
+        if (stream && size > BatchBytes) {
+            units.push_back({Range{file, 0, size, true}});
+            rangesPerFile.push_back(1);
+            continue;
+        }
+        if (!stream && size > chunkSize) {
+            uint32_t ranges = 0;
+            for (uint64_t begin = 0; begin < size; begin += chunkSize) {
+                units.push_back({Range{file, begin, min(size, begin + chunkSize), false}});
+                ranges++;
+            }
+            rangesPerFile.push_back(ranges);
+            continue;
+        }
+
+        batch.push_back(Range{file, 0, size, stream});
+        batchBytes += size;
+        rangesPerFile.push_back(1);
+        if (batchBytes >= BatchBytes || batch.size() >= MaxBatchFiles) flushBatch();
+    }
+    flushBatch();
+}
+
+size_t FileScheduler::fileCount() const {
+    return paths.size();
+}
+
+const string& FileScheduler::path(size_t file) const {
+    return paths[file];
+}
+
+uint64_t FileScheduler::byteCount() const {
+    return totalBytes;
+}
+
+size_t FileScheduler::unitCount() const {
+    return units.size();
+}
+
+bool FileScheduler::run(int threads, const BlockHandler& handler, const ProgressCallback& progress,
+                        const FileDoneHandler& fileDone) {
+    ThreadPool& pool = ThreadPool::shared();
+    size_t workers = threads > 0 ? static_cast<size_t>(threads) : pool.threadCount();
+    workers = max<size_t>(1, min(workers, units.size()));
+
+    unique_ptr<atomic<uint32_t>[]> rangesLeft(new atomic<uint32_t>[paths.size()]);
+    unique_ptr<atomic<bool>[]> fileFailed(new atomic<bool>[paths.size()]);
+    for (size_t i = 0; i < paths.size(); i++) {
+        rangesLeft[i] = rangesPerFile[i];
+        fileFailed[i] = false;
+    }
+
+    atomic<size_t> nextUnit{0};
+    atomic<size_t> filesDone{0};
+    atomic<uint64_t> bytesDone{0};
+    atomic<bool> failed{false};
+    exception_ptr handlerError;
+    mutex stateMutex;
+    condition_variable finished;
+    size_t finishedWorkers = 0;
+
+    ThreadPool::TaskGroup group(pool);
+    for (size_t worker = 0; worker < workers; worker++) {
+        group.run([&, worker]() {
+            vector<char> buffer;
+            try {
+                for (size_t unit = nextUnit++; unit < units.size(); unit = nextUnit++) {
+                    for (const Range& range : units[unit]) {
+                        bool read;
+                        uint64_t rangeBytes = range.end - range.begin;
+                        uint64_t counted = 0;
+                        if (range.streamed) {
+                            read = streamFile(range, buffer, [&](const char* data, size_t size) {
+                                uint64_t step = min<uint64_t>(size, rangeBytes - counted);
+                                counted += step;
+                                bytesDone += step;
+                                handler(worker, range.file, data, size);
+                            });
+                        } else {
+                            size_t first = 0;
+                            read = readRange(range, buffer, first);
+                            if (read && buffer.size() > first) {
+                                handler(worker, range.file, buffer.data() + first, buffer.size() - first);
+                            }
+                        }
+                        if (!read) {
+                            failed = true;
+                            fileFailed[range.file] = true;
+                        }
+                        bytesDone += rangeBytes - counted;
+                        if (--rangesLeft[range.file] == 0) {
+                            if (fileDone) fileDone(worker, range.file, !fileFailed[range.file]);
+                            filesDone++;
+                        }
+                    }
+                }
+            } catch (...) {
+                lock_guard<mutex> lock(stateMutex);
+                if (!handlerError) handlerError = current_exception();
+                nextUnit = units.size();
+            }
+
+            lock_guard<mutex> lock(stateMutex);
+            finishedWorkers++;
+            finished.notify_all();
+        });
+    }
+
+    auto snapshot = [&]() {
+        return Progress{filesDone.load(), paths.size(), bytesDone.load(), totalBytes};
+    };
+
+    if (progress) {
+        unique_lock<mutex> lock(stateMutex);
+        while (!finished.wait_for(lock, ProgressInterval, [&]() { return finishedWorkers == workers; })) {
+            lock.unlock();
+            progress(snapshot());
+            lock.lock();
+        }
+    }
+    group.wait();
+
+    if (handlerError) rethrow_exception(handlerError);
+    if (progress) progress(snapshot());
+    return !failed;
+}
+
+bool FileScheduler::readRange(const Range& range, vector<char>& buffer, size_t& first) const {
+    const string& path = paths[range.file];
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly)) {
+        Logger::log(Logger::Error, "Failed to open file: " + path);
+        return false;
+    }
+
+    // One byte before the range tells whether its first token started earlier.
+    uint64_t start = range.begin > 0 ? range.begin - 1 : 0;
+    buffer.resize(range.end - start);
+    if (!file.seek(static_cast<qint64>(start))) {
+        Logger::log(Logger::Error, "Failed to seek in file: " + path);
+        return false;
+    }
+    int64_t bytesRead = readFully(file, buffer.data(), buffer.size());
+    if (bytesRead < 0) {
+        Logger::log(Logger::Error, "Read error on file: " + path);
+        return false;
+    }
+    bool reachedEnd = static_cast<size_t>(bytesRead) == buffer.size();
+    buffer.resize(static_cast<size_t>(bytesRead));
+
+    first = 0;
+    if (range.begin > 0) {
+        first = 1;
+        if (!buffer.empty() && !StreamTokenizer::isSeparator(buffer[0])) {
+            while (first < buffer.size() && !StreamTokenizer::isSeparator(buffer[first])) first++;
+        }
+    }
+
+    // Finish the last token from the bytes after the range. The tokenizer
+    // keeps only MaxTokenLength bytes of it anyway.
+    if (reachedEnd && buffer.size() > first && !StreamTokenizer::isSeparator(buffer.back())) {
+        size_t extended = 0;
+        char piece[ExtensionPieceSize];
+        while (extended < StreamTokenizer::MaxTokenLength) {
+            int64_t pieceSize = readFully(file, piece, sizeof(piece));
+            if (pieceSize <= 0) break;
+
+            const char* begin = piece;
+            const char* end = piece + pieceSize;
+            const char* separator = find_if(begin, end, StreamTokenizer::isSeparator);
+            buffer.insert(buffer.end(), begin, separator);
+            if (separator != end) break;
+            extended += static_cast<size_t>(pieceSize);
+        }
+    }
+    return true;
+}
+
+bool FileScheduler::streamFile(const Range& range, vector<char>& buffer,
+                               const function<void(const char*, size_t)>& piece) const {
+    const string& path = paths[range.file];
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly)) {
+        Logger::log(Logger::Error, "Failed to open file: " + path);
+        return false;
+    }
+
+    // Read to the end, even if the file grew since it was listed.
+    buffer.resize(StreamBlockSize);
+    int64_t bytesRead;
+    while ((bytesRead = readFully(file, buffer.data(), buffer.size())) > 0) {
+        piece(buffer.data(), static_cast<size_t>(bytesRead));
+    }
+    if (bytesRead < 0) {
+        Logger::log(Logger::Error, "Read error on file: " + path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,90 @@
+#ifndef FILESCHEDULER_H
+#define FILESCHEDULER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Spreads the reading of many files over ThreadPool::shared(). Files
+// larger than the chunk size are split into ranges, small files are
+// grouped into batches of about BatchBytes, and workers pull the next
+// unit from a shared counter as soon as they are free. Every block handed
+// to the handler holds whole tokens only: a token that crosses a range
+// boundary goes to the range it starts in. Files flagged as streamed are
+// never split; one worker reads each of them from start to end. The units
+// depend only on the file list, not on the number of threads.
+class FileScheduler {
+public:
+    struct Progress {
+        size_t filesDone = 0;
+        size_t fileCount = 0;
+        uint64_t bytesDone = 0;
+        uint64_t byteCount = 0;
+    };
+
+    using ProgressCallback = function<void(const Progress&)>;
+    using BlockHandler = function<void(size_t worker, size_t file, const char* data, size_t size)>;
+    // Runs once per file after its last block, on the worker that finished
+    // it; complete is false if some part of the file could not be read.
+    using FileDoneHandler = function<void(size_t worker, size_t file, bool complete)>;
+
+    static constexpr uint64_t DefaultChunkSize = 8 << 20;
+    static constexpr uint64_t BatchBytes = 1 << 20;
+    static constexpr size_t MaxBatchFiles = 256;
+    static constexpr size_t StreamBlockSize = 1 << 20;
+
+    // Regular files under directory whose names match namePattern, sorted by path.
+    static vector<string> listFiles(const string& directory, const string& namePattern = "*",
+                                    bool recursive = true);
+
+    // Shell-style "*" and "?"; alternatives separated by ';', e.g. "*.txt;*.log".
+    static bool matchesPattern(string_view name, string_view pattern);
+
+    // With chunkSize UINT64_MAX no file is split, so every file reaches the
+    // handler whole in a single call. A file flagged in streamed reaches it
+    // in StreamBlockSize pieces, all from the same worker and in file order,
+    // followed by the FileDoneHandler call; the pieces are raw bytes and may
+    // cut a token. This is for input that has to be read in sequence.
+    explicit FileScheduler(vector<string> paths, uint64_t chunkSize = DefaultChunkSize,
+                           vector<bool> streamed = {});
+
+    size_t fileCount() const;
+
+    const string& path(size_t file) const;
+
+    uint64_t byteCount() const;
+
+    size_t unitCount() const;
+
+    // Calls handler from threads workers (0 for one per pool thread); worker
+    // is in [0, threads) and file indexes the path list. progress runs on
+    // the calling thread about ten times a second and once at the end.
+    // False if a file could not be read; an exception from handler stops
+    // the run and is rethrown here.
+    bool run(int threads, const BlockHandler& handler, const ProgressCallback& progress = nullptr,
+             const FileDoneHandler& fileDone = nullptr);
+
+private:
+    struct Range {
+        size_t file;
+        uint64_t begin;
+        uint64_t end;
+        bool streamed;
+    };
+
+    vector<string> paths;
+    vector<uint32_t> rangesPerFile;
+    vector<vector<Range>> units;
+    uint64_t totalBytes = 0;
+
+    bool readRange(const Range& range, vector<char>& buffer, size_t& first) const;
+
+    bool streamFile(const Range& range, vector<char>& buffer, const function<void(const char*, size_t)>& piece) const;
+};
+
+#endif // FILESCHEDULER_H
@@ -0,0 +1,242 @@
+#include "frontcodedvocabulary.h"
+#include "frozendictionary.h"
+#include "logger.h"
+#include "wordcountreader.h"
+#include <algorithm>
+#include <QFile>
+#include <QFileInfo>
+
+using namespace std;
+
+namespace {
+
+void appendVarint(vector<uint8_t>& data, uint64_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t readVarint(const uint8_t*& position) {
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte = *position++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+}
+
+uint64_t zigzag(int value) {
+    return (static_cast<uint64_t>(static_cast<int64_t>(value)) << 1) ^
+           static_cast<uint64_t>(static_cast<int64_t>(value) >> 63);
+}
+
+int unzigzag(uint64_t value) {
+    return static_cast<int>(static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1));
+}
+
+size_t stringFootprint(size_t length) {
+    const size_t inlineCapacity = string().capacity();
+    return sizeof(string) + (length > inlineCapacity ? length + 1 : 0);
+}
+
+}
+
+FrontCodedVocabulary::FrontCodedVocabulary(size_t blockSize)
+    : wordsPerBlock(clamp<size_t>(blockSize, 16, 64)), wordCount(0), plainBytes(0) {
+}
+
+void FrontCodedVocabulary::build(const vector<pair<string, int>>& sortedWords) {
+    vector<pair<string_view, int>> views;
+    views.reserve(sortedWords.size());
+    for (const auto& [word, count] : sortedWords) {
+        views.emplace_back(word, count);
+    }
+    build(views);
+}
+
+void FrontCodedVocabulary::build(const vector<pair<string_view, int>>& sortedWords) {
+    data.clear();
+    blockOffsets.clear();
+    wordCount = sortedWords.size();
+    plainBytes = 0;
+
+    string_view previous;
+    for (size_t i = 0; i < sortedWords.size(); i++) {
+        const auto& [word, count] = sortedWords[i];
+        plainBytes += stringFootprint(word.size()) + sizeof(int);
+
+        if (i % wordsPerBlock == 0) {
+            blockOffsets.push_back(data.size());
+            appendVarint(data, word.size());
+            data.insert(data.end(), word.begin(), word.end());
+        } else {
+            size_t shared = 0;
+            size_t limit = min(previous.size(), word.size());
+            while (shared < limit && previous[shared] == word[shared]) shared++;
+
+            appendVarint(data, shared);
+            appendVarint(data, word.size() - shared);
+            data.insert(data.end(), word.begin() + static_cast<ptrdiff_t>(shared), word.end());
+        }
+        appendVarint(data, zigzag(count));
+        previous = word;
+    }
+    data.shrink_to_fit();
+    blockOffsets.shrink_to_fit();
+
+    Logger::log(Logger::Info, "Front-coded vocabulary built: " + to_string(wordCount) + " words, " +
+               to_string(memoryUsage()) + " bytes vs " + to_string(plainBytes) +
+               " uncompressed, ratio " + to_string(compressionRatio()));
+}
+
+bool FrontCodedVocabulary::loadFromFile(const QString& filePath) {
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists() || !fileInfo.isFile() || !fileInfo.isReadable()) {
+        Logger::log(Logger::Error, "Cannot open vocabulary file: " + filePath.toStdString());
+        return false;
+    }
+
+    try {
+        FrozenDictionary frozen;
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            Logger::log(Logger::Error, "Failed to open vocabulary file: " + filePath.toStdString());
+            return false;
+        }
+        char magic[4] = {};
+        bool binary = file.read(magic, sizeof(magic)) == sizeof(magic) && string_view(magic, 4) == "FDIC";
+        file.close();
+
+        if (binary) {
+            if (!frozen.loadFromFile(filePath)) return false;
+
+            vector<pair<string_view, int>> words;
+            words.reserve(frozen.size());
+            for (size_t slot = 0; slot < frozen.size(); slot++) {
+                words.emplace_back(frozen.keyAt(slot), static_cast<int>(frozen.countAt(slot)));
+            }
+            sort(words.begin(), words.end());
+            build(words);
+            return true;
+        }
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            Logger::log(Logger::Error, "Failed to open vocabulary file: " + filePath.toStdString());
+            return false;
+        }
+        vector<pair<string, int>> words;
+        bool complete = WordCountReader::read(file, [&](const string& word, int count) {
+            words.emplace_back(word, count);
+        });
+        file.close();
+        if (!complete) {
+            Logger::log(Logger::Error, "Failed to read vocabulary file: " + filePath.toStdString());
+            return false;
+        }
+
+        stable_sort(words.begin(), words.end(),
+                    [](const auto& a, const auto& b) { return a.first < b.first; });
+        auto last = unique(words.rbegin(), words.rend(),
+                           [](const auto& a, const auto& b) { return a.first == b.first; });
+        words.erase(words.begin(), last.base());
+        build(words);
+        return true;
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Exception while loading vocabulary: " + string(e.what()));
+        return false;
+    }
+}
+
+pair<string, int> FrontCodedVocabulary::at(size_t rank) const {
+    pair<string, int> entry;
+    if (rank < wordCount) {
+        decodeInBlock(rank / wordsPerBlock, rank % wordsPerBlock, entry.first, entry.second);
+    }
+    return entry;
+}
+
+size_t FrontCodedVocabulary::find(string_view word) const {
+    if (blockOffsets.empty()) return npos;
+
+    size_t low = 0;
+    size_t high = blockOffsets.size();
+    while (high - low > 1) {
+        size_t middle = (low + high) / 2;
+        if (firstWord(middle) <= word) low = middle;
+        else high = middle;
+    }
+
+    const size_t inBlock = min(wordsPerBlock, wordCount - low * wordsPerBlock);
+    string current;
+    const uint8_t* position = data.data() + blockOffsets[low];
+    for (size_t i = 0; i < inBlock; i++) {
+        if (i == 0) {
+            size_t length = static_cast<size_t>(readVarint(position));
+            current.assign(reinterpret_cast<const char*>(position), length);
+            position += length;
+        } else {
+            size_t shared = static_cast<size_t>(readVarint(position));
+            size_t suffix = static_cast<size_t>(readVarint(position));
+            current.resize(shared);
+            current.append(reinterpret_cast<const char*>(position), suffix);
+            position += suffix;
+        }
+        readVarint(position);
+
+        if (current == word) return low * wordsPerBlock + i;
+        if (current > word) break;
+    }
+    return npos;
+}
+
+int FrontCodedVocabulary::count(string_view word) const {
+    size_t rank = find(word);
+    return rank == npos ? 0 : at(rank).second;
+}
+
+size_t FrontCodedVocabulary::size() const {
+    return wordCount;
+}
+
+size_t FrontCodedVocabulary::blockSize() const {
+    return wordsPerBlock;
+}
+
+size_t FrontCodedVocabulary::memoryUsage() const {
+    return data.capacity() + blockOffsets.capacity() * sizeof(uint64_t);
+}
+
+size_t FrontCodedVocabulary::uncompressedBytes() const {
+    return plainBytes;
+}
+
+double FrontCodedVocabulary::compressionRatio() const {
+    size_t used = memoryUsage();
+    return used == 0 ? 0.0 : static_cast<double>(plainBytes) / static_cast<double>(used);
+}
+
+string_view FrontCodedVocabulary::firstWord(size_t block) const {
+    const uint8_t* position = data.data() + blockOffsets[block];
+    size_t length = static_cast<size_t>(readVarint(position));
+    return string_view(reinterpret_cast<const char*>(position), length);
+}
+
+void FrontCodedVocabulary::decodeInBlock(size_t block, size_t index, string& word, int& count) const {
+    const uint8_t* position = data.data() + blockOffsets[block];
+
+    size_t length = static_cast<size_t>(readVarint(position));
+    word.assign(reinterpret_cast<const char*>(position), length);
+    position += length;
+    count = unzigzag(readVarint(position));
+
+    for (size_t i = 1; i <= index; i++) {
+        size_t shared = static_cast<size_t>(readVarint(position));
+        size_t suffix = static_cast<size_t>(readVarint(position));
+        word.resize(shared);
+        word.append(reinterpret_cast<const char*>(position), suffix);
+        position += suffix;
+        count = unzigzag(readVarint(position));
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef FRONTCODEDVOCABULARY_H
+#define FRONTCODEDVOCABULARY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <QString>
+
+using namespace std;
+
+// Read-only sorted vocabulary compressed with front coding. Words are grouped
+// into blocks; the first word of a block is stored whole, every following
+// word as (shared prefix length, suffix), each followed by its count. A block
+// index over the first words gives binary search by key and O(blockSize)
+// access by rank.
+class FrontCodedVocabulary {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    explicit FrontCodedVocabulary(size_t blockSize = 32);
+
+    void build(const vector<pair<string, int>>& sortedWords);
+
+    void build(const vector<pair<string_view, int>>& sortedWords);
+
+    // Builds from a frozen dictionary image or a text dictionary without
+    // creating a Dictionary in between.
+    bool loadFromFile(const QString& filePath);
+
+    pair<string, int> at(size_t rank) const;
+
+    // Rank of word, or npos if it is absent.
+    size_t find(string_view word) const;
+
+    int count(string_view word) const;
+
+    size_t size() const;
+
+    size_t blockSize() const;
+
+    size_t memoryUsage() const;
+
+    // Bytes the same words take as std::string keys with int counts.
+    size_t uncompressedBytes() const;
+
+    double compressionRatio() const;
+
+private:
+    size_t wordsPerBlock;
+    size_t wordCount;
+    size_t plainBytes;
+    vector<uint8_t> data;
+    vector<uint64_t> blockOffsets;
+
+    string_view firstWord(size_t block) const;
+    void decodeInBlock(size_t block, size_t index, string& word, int& count) const;
+};
+
+#endif // FRONTCODEDVOCABULARY_H
@@ -0,0 +1,504 @@
+#include "frozendictionary.h"
+#include "logger.h"
+#include "wordhashindex.h"
+#include "wordcountreader.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <QFileInfo>
+
+using namespace std;
+
+namespace {
+
+const char FrozenMagic[4] = {'F', 'D', 'I', 'C'};
+const uint32_t FrozenVersion = 1;
+const uint64_t MaxLevels = 32;
+const uint64_t WordsPerRankSample = 8;
+
+const size_t BatchSize = 16;
+
+uint64_t levelPosition(uint64_t hash, uint64_t level, uint64_t size) {
+    return mixHash(hash + (level + 1) * 0x9e3779b97f4a7c15ULL) % size;
+}
+
+uint8_t fingerprintOf(uint64_t hash) {
+    return static_cast<uint8_t>(hash >> 56);
+}
+
+size_t words64(size_t bytes) {
+    return (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+}
+
+}
+
+struct FrozenDictionary::Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t keyCount;
+    uint64_t levelCount;
+    uint64_t bitWords;
+    uint64_t rankCount;
+    uint64_t fallbackCount;
+    uint64_t blobSize;
+    uint64_t levelStartsOffset;
+    uint64_t levelSizesOffset;
+    uint64_t bitsOffset;
+    uint64_t ranksOffset;
+    uint64_t fallbackOffset;
+    uint64_t countsOffset;
+    uint64_t keyOffsetsOffset;
+    uint64_t fingerprintsOffset;
+    uint64_t keysOffset;
+    uint64_t imageSize;
+};
+
+FrozenDictionary::FrozenDictionary() {
+    reset();
+}
+
+FrozenDictionary::~FrozenDictionary() {
+    if (mappedFile) mappedFile->close();
+}
+
+FrozenDictionary::FrozenDictionary(FrozenDictionary&& other) noexcept {
+    reset();
+    *this = std::move(other);
+}
+
+FrozenDictionary& FrozenDictionary::operator=(FrozenDictionary&& other) noexcept {
+    if (this != &other) {
+        if (mappedFile) mappedFile->close();
+        ownedImage = std::move(other.ownedImage);
+        mappedFile = std::move(other.mappedFile);
+        const uint8_t* data = other.image;
+        size_t size = other.imageSize;
+        other.reset();
+        reset();
+        if (data) attach(data, size);
+    }
+    return *this;
+}
+
+void FrozenDictionary::build(const vector<pair<string, int>>& words, double gamma) {
+    if (mappedFile) mappedFile->close();
+    mappedFile.reset();
+    gamma = max(gamma, 1.0);
+
+    const size_t n = words.size();
+    vector<uint64_t> hashes(n);
+    size_t blobSize = 0;
+    for (size_t i = 0; i < n; i++) {
+        hashes[i] = hashWord(words[i].first);
+        blobSize += words[i].first.size();
+    }
+    if (blobSize > UINT32_MAX) {
+        throw length_error("Frozen dictionary key blob exceeds 4 GiB");
+    }
+
+    vector<uint64_t> levelStartList, levelSizeList, bitList;
+    vector<uint64_t> bitPosition(n, UINT64_MAX);
+    vector<uint32_t> remaining(n);
+    for (size_t i = 0; i < n; i++) remaining[i] = static_cast<uint32_t>(i);
+
+    for (uint64_t level = 0; level < MaxLevels && !remaining.empty(); level++) {
+        uint64_t size = static_cast<uint64_t>(ceil(gamma * static_cast<double>(remaining.size())));
+        size = max<uint64_t>((size + 63) / 64 * 64, 64);
+
+        vector<uint64_t> seen(size / 64, 0), collided(size / 64, 0);
+        for (uint32_t i : remaining) {
+            uint64_t p = levelPosition(hashes[i], level, size);
+            uint64_t bit = 1ULL << (p % 64);
+            if (seen[p / 64] & bit) collided[p / 64] |= bit;
+            seen[p / 64] |= bit;
+        }
+
+        uint64_t start = bitList.size() * 64;
+        vector<uint32_t> next;
+        for (uint32_t i : remaining) {
+            uint64_t p = levelPosition(hashes[i], level, size);
+            if (collided[p / 64] & (1ULL << (p % 64))) {
+                next.push_back(i);
+            } else {
+                bitPosition[i] = start + p;
+            }
+        }
+
+        for (size_t w = 0; w < seen.size(); w++) {
+            bitList.push_back(seen[w] & ~collided[w]);
+        }
+        levelStartList.push_back(start);
+        levelSizeList.push_back(size);
+        remaining.swap(next);
+    }
+
+    vector<uint64_t> rankList;
+    uint64_t ones = 0;
+    for (size_t w = 0; w < bitList.size(); w++) {
+        if (w % WordsPerRankSample == 0) rankList.push_back(ones);
+        ones += static_cast<uint64_t>(popcount(bitList[w]));
+    }
+
+    Header layout{};
+    memcpy(layout.magic, FrozenMagic, sizeof(FrozenMagic));
+    layout.version = FrozenVersion;
+    layout.keyCount = n;
+    layout.levelCount = levelStartList.size();
+    layout.bitWords = bitList.size();
+    layout.rankCount = rankList.size();
+    layout.fallbackCount = remaining.size();
+    layout.blobSize = blobSize;
+
+    size_t offset = words64(sizeof(Header));
+    auto section = [&offset](size_t bytes) {
+        size_t start = offset;
+        offset += words64(bytes);
+        return start * sizeof(uint64_t);
+    };
+    layout.levelStartsOffset = section(layout.levelCount * sizeof(uint64_t));
+    layout.levelSizesOffset = section(layout.levelCount * sizeof(uint64_t));
+    layout.bitsOffset = section(layout.bitWords * sizeof(uint64_t));
+    layout.ranksOffset = section(layout.rankCount * sizeof(uint64_t));
+    layout.fallbackOffset = section(layout.fallbackCount * 2 * sizeof(uint64_t));
+    layout.countsOffset = section(n * sizeof(uint32_t));
+    layout.keyOffsetsOffset = section((n + 1) * sizeof(uint32_t));
+    layout.fingerprintsOffset = section(n);
+    layout.keysOffset = section(blobSize);
+    layout.imageSize = offset * sizeof(uint64_t);
+
+    ownedImage.assign(offset, 0);
+    uint8_t* data = reinterpret_cast<uint8_t*>(ownedImage.data());
+    memcpy(data, &layout, sizeof(layout));
+    memcpy(data + layout.levelStartsOffset, levelStartList.data(), levelStartList.size() * sizeof(uint64_t));
+    memcpy(data + layout.levelSizesOffset, levelSizeList.data(), levelSizeList.size() * sizeof(uint64_t));
+    memcpy(data + layout.bitsOffset, bitList.data(), bitList.size() * sizeof(uint64_t));
+    memcpy(data + layout.ranksOffset, rankList.data(), rankList.size() * sizeof(uint64_t));
+
+    vector<pair<uint64_t, uint64_t>> fallbackList;
+    for (size_t j = 0; j < remaining.size(); j++) {
+        fallbackList.emplace_back(hashes[remaining[j]], ones + j);
+        bitPosition[remaining[j]] = UINT64_MAX - 1 - j;
+    }
+    sort(fallbackList.begin(), fallbackList.end());
+    for (size_t j = 0; j < fallbackList.size(); j++) {
+        uint64_t entry[2] = {fallbackList[j].first, fallbackList[j].second};
+        memcpy(data + layout.fallbackOffset + j * sizeof(entry), entry, sizeof(entry));
+    }
+
+    attach(data, layout.imageSize);
+
+    vector<uint32_t> slotOwner(n);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t position = bitPosition[i];
+        uint64_t slot;
+        if (position >= UINT64_MAX - remaining.size()) {
+            slot = ones + (UINT64_MAX - 1 - position);
+        } else {
+            uint64_t word = position / 64;
+            slot = ranks[word / WordsPerRankSample];
+            for (uint64_t w = word / WordsPerRankSample * WordsPerRankSample; w < word; w++) {
+                slot += static_cast<uint64_t>(popcount(bits[w]));
+            }
+            slot += static_cast<uint64_t>(popcount(bits[word] & ((1ULL << (position % 64)) - 1)));
+        }
+        slotOwner[slot] = static_cast<uint32_t>(i);
+    }
+
+    uint32_t* countArray = reinterpret_cast<uint32_t*>(data + layout.countsOffset);
+    uint32_t* offsetArray = reinterpret_cast<uint32_t*>(data + layout.keyOffsetsOffset);
+    uint8_t* fingerprintArray = data + layout.fingerprintsOffset;
+    char* keyBlob = reinterpret_cast<char*>(data + layout.keysOffset);
+
+    uint32_t keyOffset = 0;
+    for (size_t slot = 0; slot < n; slot++) {
+        const auto& [word, wordCount] = words[slotOwner[slot]];
+        countArray[slot] = static_cast<uint32_t>(max(wordCount, 0));
+        fingerprintArray[slot] = fingerprintOf(hashes[slotOwner[slot]]);
+        offsetArray[slot] = keyOffset;
+        memcpy(keyBlob + keyOffset, word.data(), word.size());
+        keyOffset += static_cast<uint32_t>(word.size());
+    }
+    offsetArray[n] = keyOffset;
+
+    Logger::log(Logger::Info, "Dictionary frozen: " + to_string(n) + " words, " +
+               to_string(layout.levelCount) + " hash levels, " + to_string(remaining.size()) +
+               " fallback keys, " + to_string(layout.imageSize) + " bytes");
+}
+
+uint64_t FrozenDictionary::count(string_view word) const {
+    int64_t slot = slotOf(word, hashWord(word));
+    return slot < 0 ? 0 : counts[slot];
+}
+
+void FrozenDictionary::countMany(span<const string_view> words, span<uint64_t> out) const {
+    uint64_t hashes[BatchSize];
+    uint64_t slots[BatchSize];
+
+    for (size_t base = 0; base < words.size(); base += BatchSize) {
+        const size_t batch = min(BatchSize, words.size() - base);
+
+        for (size_t i = 0; i < batch; i++) {
+            hashes[i] = hashWord(words[base + i]);
+            if (header && header->levelCount > 0) {
+                prefetchAddress(&bits[(levelStarts[0] + levelPosition(hashes[i], 0, levelSizes[0])) / 64]);
+            }
+        }
+
+        for (size_t i = 0; i < batch; i++) {
+            slots[i] = candidateSlot(hashes[i]);
+            if (slots[i] < size()) {
+                prefetchAddress(&fingerprints[slots[i]]);
+                prefetchAddress(&keyOffsets[slots[i]]);
+                prefetchAddress(&counts[slots[i]]);
+            }
+        }
+
+        for (size_t i = 0; i < batch; i++) {
+            int64_t slot;
+            if (slots[i] < size()) {
+                slot = slotMatches(slots[i], words[base + i], hashes[i]) ? static_cast<int64_t>(slots[i]) : -1;
+            } else {
+                slot = slotOf(words[base + i], hashes[i]);
+            }
+            out[base + i] = slot < 0 ? 0 : counts[slot];
+        }
+    }
+}
+
+bool FrozenDictionary::contains(string_view word) const {
+    return slotOf(word, hashWord(word)) >= 0;
+}
+
+size_t FrozenDictionary::size() const {
+    return header ? header->keyCount : 0;
+}
+
+string_view FrozenDictionary::keyAt(size_t slot) const {
+    return string_view(keys + keyOffsets[slot], keyOffsets[slot + 1] - keyOffsets[slot]);
+}
+
+uint64_t FrozenDictionary::countAt(size_t slot) const {
+    return counts[slot];
+}
+
+bool FrozenDictionary::saveToFile(const QString& filePath) const {
+    if (!image) {
+        Logger::log(Logger::Error, "Cannot save an empty frozen dictionary: " + filePath.toStdString());
+        return false;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        Logger::log(Logger::Error, "Failed to save frozen dictionary to file: " + filePath.toStdString());
+        return false;
+    }
+
+    bool written = file.write(reinterpret_cast<const char*>(image), static_cast<qint64>(imageSize)) ==
+                   static_cast<qint64>(imageSize);
+    file.close();
+
+    if (!written) {
+        Logger::log(Logger::Error, "Failed to write frozen dictionary: " + filePath.toStdString());
+        return false;
+    }
+    Logger::log(Logger::Info, "Frozen dictionary saved to file: " + filePath.toStdString() +
+               ", total words: " + to_string(size()));
+    return true;
+}
+
+bool FrozenDictionary::loadFromFile(const QString& filePath) {
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists() || !fileInfo.isFile() || !fileInfo.isReadable()) {
+        Logger::log(Logger::Error, "Cannot open frozen dictionary file: " + filePath.toStdString());
+        return false;
+    }
+
+    try {
+        auto file = make_unique<QFile>(filePath);
+        if (!file->open(QIODevice::ReadOnly)) {
+            Logger::log(Logger::Error, "Failed to open frozen dictionary file: " + filePath.toStdString());
+            return false;
+        }
+
+        char magic[sizeof(FrozenMagic)] = {};
+        bool binary = file->read(magic, sizeof(magic)) == sizeof(magic) &&
+                      memcmp(magic, FrozenMagic, sizeof(magic)) == 0;
+
+        if (binary) {
+            qint64 fileSize = file->size();
+            const uint8_t* data = file->map(0, fileSize);
+            if (mappedFile) mappedFile->close();
+            ownedImage.clear();
+            mappedFile = std::move(file);
+            if (!data || !attach(data, static_cast<size_t>(fileSize))) {
+                mappedFile.reset();
+                reset();
+                Logger::log(Logger::Error, "Invalid frozen dictionary image: " + filePath.toStdString());
+                return false;
+            }
+            Logger::log(Logger::Info, "Frozen dictionary mapped from file: " + filePath.toStdString() +
+                       ", total words: " + to_string(size()));
+            return true;
+        }
+
+        file->seek(0);
+        vector<pair<string, int>> words;
+        bool complete = WordCountReader::read(*file, [&](const string& word, int count) {
+            words.emplace_back(word, count);
+        });
+        file->close();
+        if (!complete) {
+            Logger::log(Logger::Error, "Failed to read frozen dictionary file: " + filePath.toStdString());
+            return false;
+        }
+
+        stable_sort(words.begin(), words.end(),
+                    [](const auto& a, const auto& b) { return a.first < b.first; });
+        auto last = unique(words.rbegin(), words.rend(),
+                           [](const auto& a, const auto& b) { return a.first == b.first; });
+        words.erase(words.begin(), last.base());
+
+        build(words);
+        return true;
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Exception while loading frozen dictionary: " + string(e.what()));
+        return false;
+    }
+}
+
+size_t FrozenDictionary::memoryUsage() const {
+    return imageSize;
+}
+
+double FrozenDictionary::hashBitsPerKey() const {
+    if (!header || header->keyCount == 0) return 0.0;
+    uint64_t bitsUsed = (header->bitWords + header->rankCount + header->fallbackCount * 2 +
+                         header->levelCount * 2) * 64;
+    return static_cast<double>(bitsUsed) / static_cast<double>(header->keyCount);
+}
+
+bool FrozenDictionary::attach(const uint8_t* data, size_t size) {
+    reset();
+    if (size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % alignof(uint64_t) != 0) return false;
+
+    const Header* candidate = reinterpret_cast<const Header*>(data);
+    if (memcmp(candidate->magic, FrozenMagic, sizeof(FrozenMagic)) != 0 ||
+        candidate->version != FrozenVersion || candidate->imageSize != size ||
+        candidate->levelCount > MaxLevels) {
+        return false;
+    }
+
+    // No count can exceed the image size, which keeps the section sizes below from overflowing.
+    const uint64_t n = candidate->keyCount;
+    for (uint64_t count : {n, candidate->bitWords, candidate->rankCount, candidate->fallbackCount,
+                           candidate->blobSize}) {
+        if (count > size) return false;
+    }
+    const pair<uint64_t, uint64_t> sections[] = {
+        {candidate->levelStartsOffset, candidate->levelCount * sizeof(uint64_t)},
+        {candidate->levelSizesOffset, candidate->levelCount * sizeof(uint64_t)},
+        {candidate->bitsOffset, candidate->bitWords * sizeof(uint64_t)},
+        {candidate->ranksOffset, candidate->rankCount * sizeof(uint64_t)},
+        {candidate->fallbackOffset, candidate->fallbackCount * 2 * sizeof(uint64_t)},
+        {candidate->countsOffset, n * sizeof(uint32_t)},
+        {candidate->keyOffsetsOffset, (n + 1) * sizeof(uint32_t)},
+        {candidate->fingerprintsOffset, n},
+        {candidate->keysOffset, candidate->blobSize},
+    };
+    for (const auto& [offset, bytes] : sections) {
+        if (offset % sizeof(uint64_t) != 0 || offset > size || bytes > size - offset) return false;
+    }
+
+    // Lookups index the sections with values read from the image, so the
+    // sections have to agree with each other as well.
+    const auto* starts = reinterpret_cast<const uint64_t*>(data + candidate->levelStartsOffset);
+    const auto* sizes = reinterpret_cast<const uint64_t*>(data + candidate->levelSizesOffset);
+    const uint64_t bitCount = candidate->bitWords * 64;
+    for (uint64_t level = 0; level < candidate->levelCount; level++) {
+        if (sizes[level] == 0 || starts[level] > bitCount || sizes[level] > bitCount - starts[level]) return false;
+    }
+    if (candidate->rankCount < (candidate->bitWords + WordsPerRankSample - 1) / WordsPerRankSample) return false;
+
+    const auto* offsets = reinterpret_cast<const uint32_t*>(data + candidate->keyOffsetsOffset);
+    for (uint64_t slot = 0; slot < n; slot++) {
+        if (offsets[slot] > offsets[slot + 1]) return false;
+    }
+    if (offsets[n] > candidate->blobSize) return false;
+
+    const auto* fallbackEntries = reinterpret_cast<const uint64_t*>(data + candidate->fallbackOffset);
+    for (uint64_t entry = 0; entry < candidate->fallbackCount; entry++) {
+        if (fallbackEntries[entry * 2 + 1] >= n) return false;
+    }
+
+    image = data;
+    imageSize = size;
+    header = candidate;
+    levelStarts = reinterpret_cast<const uint64_t*>(data + header->levelStartsOffset);
+    levelSizes = reinterpret_cast<const uint64_t*>(data + header->levelSizesOffset);
+    bits = reinterpret_cast<const uint64_t*>(data + header->bitsOffset);
+    ranks = reinterpret_cast<const uint64_t*>(data + header->ranksOffset);
+    fallback = reinterpret_cast<const uint64_t*>(data + header->fallbackOffset);
+    counts = reinterpret_cast<const uint32_t*>(data + header->countsOffset);
+    keyOffsets = reinterpret_cast<const uint32_t*>(data + header->keyOffsetsOffset);
+    fingerprints = data + header->fingerprintsOffset;
+    keys = reinterpret_cast<const char*>(data + header->keysOffset);
+    return true;
+}
+
+int64_t FrozenDictionary::slotOf(string_view word, uint64_t hash) const {
+    if (!header || header->keyCount == 0) return -1;
+
+    uint64_t slot = candidateSlot(hash);
+    if (slot != UINT64_MAX) {
+        return slotMatches(slot, word, hash) ? static_cast<int64_t>(slot) : -1;
+    }
+
+    size_t low = 0;
+    size_t high = header->fallbackCount;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (fallback[middle * 2] < hash) low = middle + 1;
+        else high = middle;
+    }
+    for (; low < header->fallbackCount && fallback[low * 2] == hash; low++) {
+        if (slotMatches(fallback[low * 2 + 1], word, hash)) return static_cast<int64_t>(fallback[low * 2 + 1]);
+    }
+    return -1;
+}
+
+uint64_t FrozenDictionary::candidateSlot(uint64_t hash) const {
+    if (!header) return UINT64_MAX;
+
+    for (uint64_t level = 0; level < header->levelCount; level++) {
+        uint64_t position = levelStarts[level] + levelPosition(hash, level, levelSizes[level]);
+        uint64_t word64 = position / 64;
+        if (!(bits[word64] & (1ULL << (position % 64)))) continue;
+
+        uint64_t slot = ranks[word64 / WordsPerRankSample];
+        for (uint64_t w = word64 / WordsPerRankSample * WordsPerRankSample; w < word64; w++) {
+            slot += static_cast<uint64_t>(popcount(bits[w]));
+        }
+        return slot + static_cast<uint64_t>(popcount(bits[word64] & ((1ULL << (position % 64)) - 1)));
+    }
+    return UINT64_MAX;
+}
+
+bool FrozenDictionary::slotMatches(uint64_t slot, string_view word, uint64_t hash) const {
+    return slot < header->keyCount && fingerprints[slot] == fingerprintOf(hash) && keyAt(slot) == word;
+}
+
+void FrozenDictionary::reset() {
+    image = nullptr;
+    imageSize = 0;
+    header = nullptr;
+    levelStarts = nullptr;
+    levelSizes = nullptr;
+    bits = nullptr;
+    ranks = nullptr;
+    fallback = nullptr;
+    counts = nullptr;
+    keyOffsets = nullptr;
+    fingerprints = nullptr;
+    keys = nullptr;
+}
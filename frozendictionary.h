@@ -0,0 +1,82 @@
+#ifndef FROZENDICTIONARY_H
+#define FROZENDICTIONARY_H
+
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <QString>
+#include <QFile>
+
+using namespace std;
+
+// Immutable word -> count table. Keys live in one contiguous blob addressed
+// through a BBHash-style minimal perfect hash (about 3 bits per key); an 8-bit
+// fingerprint per slot rejects most absent keys before the blob is touched.
+// The whole table is a single flat image, so it can be written to disk and
+// memory-mapped back without any per-entry allocation.
+class FrozenDictionary {
+public:
+    FrozenDictionary();
+    ~FrozenDictionary();
+
+    FrozenDictionary(FrozenDictionary&& other) noexcept;
+    FrozenDictionary& operator=(FrozenDictionary&& other) noexcept;
+
+    // Builds from unique words; gamma trades build time and lookup depth
+    // against hash overhead (1.0 is the most compact).
+    void build(const vector<pair<string, int>>& words, double gamma = 1.0);
+
+    uint64_t count(string_view word) const;
+
+    // Looks up a whole batch, prefetching each stage of every lookup before
+    // resolving it; out must be at least as long as words.
+    void countMany(span<const string_view> words, span<uint64_t> out) const;
+
+    bool contains(string_view word) const;
+
+    size_t size() const;
+
+    string_view keyAt(size_t slot) const;
+
+    uint64_t countAt(size_t slot) const;
+
+    // Saves the binary image; loadFromFile maps such an image, or builds the
+    // table from a text dictionary ("word count" lines) without a std::map.
+    bool saveToFile(const QString& filePath) const;
+
+    bool loadFromFile(const QString& filePath);
+
+    size_t memoryUsage() const;
+
+    double hashBitsPerKey() const;
+
+private:
+    struct Header;
+
+    vector<uint64_t> ownedImage;
+    unique_ptr<QFile> mappedFile;
+    const uint8_t* image;
+    size_t imageSize;
+
+    const Header* header;
+    const uint64_t* levelStarts;
+    const uint64_t* levelSizes;
+    const uint64_t* bits;
+    const uint64_t* ranks;
+    const uint64_t* fallback;
+    const uint32_t* counts;
+    const uint32_t* keyOffsets;
+    const uint8_t* fingerprints;
+    const char* keys;
+
+    bool attach(const uint8_t* data, size_t size);
+    int64_t slotOf(string_view word, uint64_t hash) const;
+    uint64_t candidateSlot(uint64_t hash) const;
+    bool slotMatches(uint64_t slot, string_view word, uint64_t hash) const;
+    void reset();
+};
+
+#endif // FROZENDICTIONARY_H
@@ -0,0 +1,445 @@
+#include "fstdictionary.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+#include <QFileInfo>
+
+using namespace std;
+
+namespace {
+
+constexpr char FstMagic[4] = {'F', 'S', 'T', 'D'};
+constexpr uint32_t FstVersion = 1;
+
+constexpr uint8_t FinalFlag = 0x80;
+
+void appendVarint(vector<uint8_t>& data, uint64_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t*& position, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && position < end; shift += 7) {
+        uint8_t byte = *position++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+unsigned bytesNeeded(uint64_t value) {
+    unsigned bytes = 0;
+    while (value) {
+        bytes++;
+        value >>= 8;
+    }
+    return bytes;
+}
+
+void appendFixed(vector<uint8_t>& data, uint64_t value, unsigned width) {
+    for (unsigned i = 0; i < width; i++) {
+        data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint64_t readFixed(const uint8_t* position, unsigned width) {
+    uint64_t value = 0;
+    for (unsigned i = 0; i < width; i++) {
+        value |= static_cast<uint64_t>(position[i]) << (8 * i);
+    }
+    return value;
+}
+
+template <typename T>
+void appendRaw(string& key, T value) {
+    key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+}
+
+struct FstDictionary::Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t wordCount;
+    uint64_t rootAddress;
+    uint64_t nodesSize;
+    uint64_t imageSize;
+};
+
+// A node is one flags byte (final bit, output width 0-8, target delta width
+// 1-8), a varint transition count, a varint final output when final, then the
+// sorted labels, the fixed-width outputs and the fixed-width distances back
+// to each target. Children are always written before their parents, so a
+// distance of zero or past the start of the nodes marks a corrupt image.
+struct FstDictionary::NodeView {
+    uint64_t address;
+    bool final;
+    uint64_t finalOutput;
+    size_t transitionCount;
+    unsigned outputWidth;
+    unsigned deltaWidth;
+    const uint8_t* labels;
+    const uint8_t* outputs;
+    const uint8_t* deltas;
+
+    uint64_t outputAt(size_t i) const {
+        return readFixed(outputs + i * outputWidth, outputWidth);
+    }
+
+    uint64_t targetAt(size_t i) const {
+        uint64_t delta = readFixed(deltas + i * deltaWidth, deltaWidth);
+        return delta == 0 || delta > address ? UINT64_MAX : address - delta;
+    }
+};
+
+FstBuilder::FstBuilder() : wordCount(0) {
+    unfinished.emplace_back();
+}
+
+bool FstBuilder::add(string_view word, uint64_t output) {
+    if (wordCount > 0 && word <= previous) {
+        Logger::log(Logger::Error, "FST input is not strictly sorted at word: " + string(word));
+        return false;
+    }
+
+    size_t prefixLength = 0;
+    size_t limit = min(previous.size(), word.size());
+    while (prefixLength < limit && previous[prefixLength] == word[prefixLength]) prefixLength++;
+
+    freezeTail(prefixLength);
+
+    for (size_t i = 0; i < prefixLength; i++) {
+        Transition& transition = unfinished[i].transitions.back();
+        uint64_t common = min(transition.output, output);
+        uint64_t rest = transition.output - common;
+        transition.output = common;
+        output -= common;
+
+        if (rest) {
+            Node& next = unfinished[i + 1];
+            for (Transition& pushed : next.transitions) pushed.output += rest;
+            if (next.final) next.finalOutput += rest;
+        }
+    }
+
+    for (size_t i = prefixLength; i < word.size(); i++) {
+        unfinished[i].transitions.push_back({static_cast<uint8_t>(word[i]), 0, 0});
+        unfinished.emplace_back();
+    }
+
+    if (word.size() > prefixLength) {
+        unfinished[prefixLength].transitions.back().output = output;
+    }
+    Node& last = unfinished.back();
+    last.final = true;
+    last.finalOutput = word.size() > prefixLength ? 0 : output;
+
+    previous.assign(word);
+    wordCount++;
+    return true;
+}
+
+vector<uint64_t> FstBuilder::finish() {
+    freezeTail(0);
+    uint64_t rootAddress = compile(unfinished[0]);
+
+    FstDictionary::Header header = {};
+    memcpy(header.magic, FstMagic, sizeof(FstMagic));
+    header.version = FstVersion;
+    header.wordCount = wordCount;
+    header.rootAddress = rootAddress;
+    header.nodesSize = nodes.size();
+
+    size_t bytes = sizeof(header) + nodes.size();
+    vector<uint64_t> image((bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+    header.imageSize = image.size() * sizeof(uint64_t);
+
+    uint8_t* data = reinterpret_cast<uint8_t*>(image.data());
+    memcpy(data, &header, sizeof(header));
+    if (!nodes.empty()) memcpy(data + sizeof(header), nodes.data(), nodes.size());
+
+    Logger::log(Logger::Info, "FST built: " + to_string(wordCount) + " words, " +
+               to_string(registry.size()) + " nodes, " + to_string(header.imageSize) + " bytes");
+
+    unfinished.assign(1, Node());
+    previous.clear();
+    nodes.clear();
+    registry.clear();
+    wordCount = 0;
+    return image;
+}
+
+void FstBuilder::freezeTail(size_t depth) {
+    while (unfinished.size() > depth + 1) {
+        uint64_t address = compile(unfinished.back());
+        unfinished.pop_back();
+        unfinished.back().transitions.back().target = address;
+    }
+}
+
+uint64_t FstBuilder::compile(const Node& node) {
+    string key;
+    key.reserve(16 + node.transitions.size() * 17);
+    appendRaw(key, node.final);
+    appendRaw(key, node.finalOutput);
+    for (const Transition& transition : node.transitions) {
+        appendRaw(key, transition.label);
+        appendRaw(key, transition.output);
+        appendRaw(key, transition.target);
+    }
+
+    auto found = registry.find(key);
+    if (found != registry.end()) return found->second;
+
+    uint64_t address = nodes.size();
+    unsigned outputWidth = 0;
+    unsigned deltaWidth = 1;
+    for (const Transition& transition : node.transitions) {
+        outputWidth = max(outputWidth, bytesNeeded(transition.output));
+        deltaWidth = max(deltaWidth, bytesNeeded(address - transition.target));
+    }
+
+    nodes.push_back(static_cast<uint8_t>((node.final ? FinalFlag : 0) | (outputWidth << 3) | (deltaWidth - 1)));
+    appendVarint(nodes, node.transitions.size());
+    if (node.final) appendVarint(nodes, node.finalOutput);
+    for (const Transition& transition : node.transitions) nodes.push_back(transition.label);
+    for (const Transition& transition : node.transitions) appendFixed(nodes, transition.output, outputWidth);
+    for (const Transition& transition : node.transitions) {
+        appendFixed(nodes, address - transition.target, deltaWidth);
+    }
+
+    registry.emplace(std::move(key), address);
+    return address;
+}
+
+FstDictionary::FstDictionary() {
+    reset();
+}
+
+FstDictionary::~FstDictionary() {
+    if (mappedFile) mappedFile->close();
+}
+
+FstDictionary::FstDictionary(FstDictionary&& other) noexcept {
+    reset();
+    *this = std::move(other);
+}
+
+FstDictionary& FstDictionary::operator=(FstDictionary&& other) noexcept {
+    if (this != &other) {
+        if (mappedFile) mappedFile->close();
+        ownedImage = std::move(other.ownedImage);
+        mappedFile = std::move(other.mappedFile);
+        const uint8_t* data = other.image;
+        size_t size = other.imageSize;
+        other.reset();
+        reset();
+        if (data) attach(data, size);
+    }
+    return *this;
+}
+
+bool FstDictionary::build(const vector<pair<string, int>>& sortedWords) {
+    FstBuilder builder;
+    for (const auto& [word, count] : sortedWords) {
+        if (!builder.add(word, static_cast<uint64_t>(max(count, 0)))) return false;
+    }
+    return assign(builder.finish());
+}
+
+bool FstDictionary::assign(vector<uint64_t>&& image) {
+    if (mappedFile) mappedFile->close();
+    mappedFile.reset();
+    ownedImage = std::move(image);
+    if (!attach(reinterpret_cast<const uint8_t*>(ownedImage.data()), ownedImage.size() * sizeof(uint64_t))) {
+        ownedImage.clear();
+        Logger::log(Logger::Error, "Invalid FST image");
+        return false;
+    }
+    return true;
+}
+
+uint64_t FstDictionary::count(string_view word) const {
+    uint64_t address = 0;
+    uint64_t output = 0;
+    if (!walk(word, address, output)) return 0;
+
+    NodeView node = nodeAt(address);
+    return node.final ? output + node.finalOutput : 0;
+}
+
+bool FstDictionary::contains(string_view word) const {
+    uint64_t address = 0;
+    uint64_t output = 0;
+    return walk(word, address, output) && nodeAt(address).final;
+}
+
+void FstDictionary::forEachWithPrefix(string_view prefix,
+                                      const function<void(string_view, uint64_t)>& visit) const {
+    uint64_t address = 0;
+    uint64_t output = 0;
+    if (!walk(prefix, address, output)) return;
+
+    string word(prefix);
+    visitFrom(address, output, word, visit);
+}
+
+void FstDictionary::forEach(const function<void(string_view, uint64_t)>& visit) const {
+    forEachWithPrefix(string_view(), visit);
+}
+
+size_t FstDictionary::size() const {
+    return header ? static_cast<size_t>(header->wordCount) : 0;
+}
+
+bool FstDictionary::saveToFile(const QString& filePath) const {
+    if (!image) {
+        Logger::log(Logger::Error, "Cannot save an empty FST dictionary: " + filePath.toStdString());
+        return false;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        Logger::log(Logger::Error, "Failed to save FST dictionary to file: " + filePath.toStdString());
+        return false;
+    }
+
+    bool written = file.write(reinterpret_cast<const char*>(image), static_cast<qint64>(imageSize)) ==
+                   static_cast<qint64>(imageSize);
+    file.close();
+
+    if (!written) {
+        Logger::log(Logger::Error, "Failed to write FST dictionary: " + filePath.toStdString());
+        return false;
+    }
+    Logger::log(Logger::Info, "FST dictionary saved to file: " + filePath.toStdString() +
+               ", total words: " + to_string(size()));
+    return true;
+}
+
+bool FstDictionary::loadFromFile(const QString& filePath) {
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists() || !fileInfo.isFile() || !fileInfo.isReadable()) {
+        Logger::log(Logger::Error, "Cannot open FST dictionary file: " + filePath.toStdString());
+        return false;
+    }
+
+    try {
+        auto file = make_unique<QFile>(filePath);
+        if (!file->open(QIODevice::ReadOnly)) {
+            Logger::log(Logger::Error, "Failed to open FST dictionary file: " + filePath.toStdString());
+            return false;
+        }
+
+        qint64 fileSize = file->size();
+        const uint8_t* data = file->map(0, fileSize);
+        if (mappedFile) mappedFile->close();
+        ownedImage.clear();
+        mappedFile = std::move(file);
+        if (!data || !attach(data, static_cast<size_t>(fileSize))) {
+            mappedFile.reset();
+            reset();
+            Logger::log(Logger::Error, "Invalid FST dictionary image: " + filePath.toStdString());
+            return false;
+        }
+        Logger::log(Logger::Info, "FST dictionary mapped from file: " + filePath.toStdString() +
+                   ", total words: " + to_string(size()));
+        return true;
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Exception while loading FST dictionary: " + string(e.what()));
+        return false;
+    }
+}
+
+size_t FstDictionary::memoryUsage() const {
+    return imageSize;
+}
+
+bool FstDictionary::attach(const uint8_t* data, size_t size) {
+    reset();
+    if (size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % alignof(uint64_t) != 0) return false;
+
+    const Header* candidate = reinterpret_cast<const Header*>(data);
+    if (memcmp(candidate->magic, FstMagic, sizeof(FstMagic)) != 0 || candidate->version != FstVersion ||
+        candidate->imageSize != size || candidate->nodesSize > size - sizeof(Header) ||
+        candidate->rootAddress >= candidate->nodesSize) {
+        return false;
+    }
+
+    image = data;
+    imageSize = size;
+    header = candidate;
+    nodes = data + sizeof(Header);
+    return true;
+}
+
+// A node that does not fit in the mapped nodes reads as a dead end.
+FstDictionary::NodeView FstDictionary::nodeAt(uint64_t address) const {
+    NodeView empty = {address, false, 0, 0, 0, 1, nodes, nodes, nodes};
+    if (address >= header->nodesSize) return empty;
+
+    const uint8_t* end = nodes + header->nodesSize;
+    const uint8_t* position = nodes + address;
+    uint8_t flags = *position++;
+
+    NodeView node = empty;
+    node.final = flags & FinalFlag;
+    node.outputWidth = (flags >> 3) & 0x0f;
+    node.deltaWidth = (flags & 0x07) + 1;
+    uint64_t transitionCount = 0;
+    if (node.outputWidth > sizeof(uint64_t) || !readVarint(position, end, transitionCount) ||
+        (node.final && !readVarint(position, end, node.finalOutput))) {
+        return empty;
+    }
+
+    uint64_t available = static_cast<uint64_t>(end - position);
+    if (transitionCount > available ||
+        transitionCount * (1 + node.outputWidth + node.deltaWidth) > available) {
+        return empty;
+    }
+    node.transitionCount = static_cast<size_t>(transitionCount);
+    node.labels = position;
+    node.outputs = node.labels + node.transitionCount;
+    node.deltas = node.outputs + node.transitionCount * node.outputWidth;
+    return node;
+}
+
+bool FstDictionary::walk(string_view prefix, uint64_t& address, uint64_t& output) const {
+    if (!header) return false;
+
+    address = header->rootAddress;
+    output = 0;
+    for (char c : prefix) {
+        NodeView node = nodeAt(address);
+        const void* label = memchr(node.labels, static_cast<uint8_t>(c), node.transitionCount);
+        if (!label) return false;
+
+        size_t i = static_cast<const uint8_t*>(label) - node.labels;
+        output += node.outputAt(i);
+        address = node.targetAt(i);
+    }
+    return true;
+}
+
+void FstDictionary::visitFrom(uint64_t address, uint64_t output, string& word,
+                              const function<void(string_view, uint64_t)>& visit) const {
+    NodeView node = nodeAt(address);
+    if (node.final) visit(word, output + node.finalOutput);
+
+    for (size_t i = 0; i < node.transitionCount; i++) {
+        word.push_back(static_cast<char>(node.labels[i]));
+        visitFrom(node.targetAt(i), output + node.outputAt(i), word, visit);
+        word.pop_back();
+    }
+}
+
+void FstDictionary::reset() {
+    image = nullptr;
+    imageSize = 0;
+    header = nullptr;
+    nodes = nullptr;
+}
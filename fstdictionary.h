@@ -0,0 +1,107 @@
+#ifndef FSTDICTIONARY_H
+#define FSTDICTIONARY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <QString>
+#include <QFile>
+
+using namespace std;
+
+// Builds a minimal acyclic finite-state transducer from words added in
+// strictly increasing byte order. Outputs are pushed towards the root, so
+// equal suffixes collapse into shared nodes.
+class FstBuilder {
+public:
+    FstBuilder();
+
+    // Returns false if word does not sort after the previous one.
+    bool add(string_view word, uint64_t output);
+
+    // Freezes the remaining nodes and returns the finished image; the builder
+    // is empty afterwards.
+    vector<uint64_t> finish();
+
+private:
+    struct Transition {
+        uint8_t label;
+        uint64_t output;
+        uint64_t target;
+    };
+
+    struct Node {
+        bool final = false;
+        uint64_t finalOutput = 0;
+        vector<Transition> transitions;
+    };
+
+    vector<Node> unfinished;
+    string previous;
+    vector<uint8_t> nodes;
+    unordered_map<string, uint64_t> registry;
+    uint64_t wordCount;
+
+    void freezeTail(size_t depth);
+    uint64_t compile(const Node& node);
+};
+
+// Read-only word -> count view over an FST image. Nodes are read in place,
+// so a memory-mapped file answers lookups, prefix iteration and ordered
+// streaming without a decompression step.
+class FstDictionary {
+public:
+    FstDictionary();
+    ~FstDictionary();
+
+    FstDictionary(FstDictionary&& other) noexcept;
+    FstDictionary& operator=(FstDictionary&& other) noexcept;
+
+    // Builds from words sorted alphabetically, as getWordsAlphabetically() returns them.
+    bool build(const vector<pair<string, int>>& sortedWords);
+
+    bool assign(vector<uint64_t>&& image);
+
+    uint64_t count(string_view word) const;
+
+    bool contains(string_view word) const;
+
+    // Visits every word starting with prefix in alphabetical order.
+    void forEachWithPrefix(string_view prefix, const function<void(string_view, uint64_t)>& visit) const;
+
+    void forEach(const function<void(string_view, uint64_t)>& visit) const;
+
+    size_t size() const;
+
+    bool saveToFile(const QString& filePath) const;
+
+    bool loadFromFile(const QString& filePath);
+
+    size_t memoryUsage() const;
+
+private:
+    friend class FstBuilder;
+
+    struct Header;
+    struct NodeView;
+
+    vector<uint64_t> ownedImage;
+    unique_ptr<QFile> mappedFile;
+    const uint8_t* image;
+    size_t imageSize;
+    const Header* header;
+    const uint8_t* nodes;
+
+    bool attach(const uint8_t* data, size_t size);
+    NodeView nodeAt(uint64_t address) const;
+    bool walk(string_view prefix, uint64_t& address, uint64_t& output) const;
+    void visitFrom(uint64_t address, uint64_t output, string& word,
+                   const function<void(string_view, uint64_t)>& visit) const;
+    void reset();
+};
+
+#endif // FSTDICTIONARY_H
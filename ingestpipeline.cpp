@@ -0,0 +1,244 @@
+#include "ingestpipeline.h"
+#include "boundedqueue.h"
+#include "streamtokenizer.h"
+#include "wordhashindex.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+// Thrown through the producer when a later stage has stopped the run.
+struct Stopped {};
+
+double secondsSince(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+}
+
+IngestPipeline::IngestPipeline(size_t tokenizerThreads, size_t chunkSize, size_t queueDepth)
+    : tokenizerThreads(tokenizerThreads),
+      chunkSize(max(chunkSize, 2 * StreamTokenizer::MaxTokenLength)),
+      queueDepth(max<size_t>(queueDepth, 1)) {
+    if (this->tokenizerThreads == 0) {
+        size_t hardware = thread::hardware_concurrency();
+        // One core each for the reader and the counter.
+        this->tokenizerThreads = hardware > 2 ? min(MaxTokenizerThreads, hardware - 2) : 1;
+    }
+}
+
+bool IngestPipeline::run(const Producer& produce, const Normalizer& normalize, const BatchConsumer& consume) {
+    struct Slot {
+        vector<char> data;
+        size_t size = 0;
+        // The chunk starts inside a token too long to fit the previous one.
+        bool skipLeading = false;
+        uint64_t sequence = 0;
+        TokenBatch batch;
+    };
+
+    // Every chunk in flight holds a slot from the start of reading until it
+    // has been counted, so the slots bound the memory of the whole run and
+    // at most slots.size() sequence numbers are outstanding.
+    const size_t slotCount = queueDepth + tokenizerThreads;
+    vector<Slot> slots(slotCount);
+    BoundedQueue<size_t> freeSlots(slotCount);
+    BoundedQueue<size_t> toTokenize(slotCount);
+    BoundedQueue<size_t> toCount(slotCount);
+    for (size_t i = 0; i < slotCount; i++) {
+        slots[i].data.resize(chunkSize);
+        freeSlots.push(i);
+    }
+
+    stats = Statistics();
+    stats.tokenizerThreads = tokenizerThreads;
+
+    mutex errorMutex;
+    exception_ptr error;
+    auto stop = [&](exception_ptr failure) {
+        {
+            lock_guard<mutex> lock(errorMutex);
+            if (failure && !error) error = failure;
+        }
+        freeSlots.close();
+        toTokenize.close();
+        toCount.close();
+    };
+
+    bool readOk = true;
+    thread reader([&]() {
+        Clock::time_point start = Clock::now();
+        double waited = 0;
+        uint64_t sequence = 0;
+        size_t current = 0;
+        bool haveSlot = false;
+
+        auto acquire = [&]() {
+            Clock::time_point waitStart = Clock::now();
+            bool ok = freeSlots.pop(current);
+            waited += secondsSince(waitStart);
+            if (!ok) throw Stopped();
+            haveSlot = true;
+        };
+
+        auto dispatch = [&](bool last) {
+            size_t index = current;
+            Slot& slot = slots[index];
+            if (!last) {
+                // Cut after the last separator and start the next chunk with
+                // the token it interrupts.
+                size_t keep = slot.size;
+                while (keep > 0 && !StreamTokenizer::isSeparator(slot.data[keep - 1])) keep--;
+
+                acquire();
+                Slot& following = slots[current];
+                if (keep == 0) {
+                    following.skipLeading = true;
+                } else {
+                    following.size = slot.size - keep;
+                    memcpy(following.data.data(), slot.data.data() + keep, following.size);
+                    slot.size = keep;
+                }
+            }
+
+            slot.sequence = sequence++;
+            stats.reader.items++;
+            Clock::time_point waitStart = Clock::now();
+            bool ok = toTokenize.push(index);
+            waited += secondsSince(waitStart);
+            if (!ok) throw Stopped();
+            if (last) haveSlot = false;
+        };
+
+        try {
+            readOk = produce([&](const char* data, size_t size) {
+                stats.bytes += size;
+                while (size > 0) {
+                    if (!haveSlot) acquire();
+                    Slot& slot = slots[current];
+                    size_t length = min(size, chunkSize - slot.size);
+                    memcpy(slot.data.data() + slot.size, data, length);
+                    slot.size += length;
+                    data += length;
+                    size -= length;
+                    if (slot.size == chunkSize) dispatch(false);
+                }
+            });
+            if (haveSlot) dispatch(true);
+            toTokenize.close();
+        } catch (const Stopped&) {
+        } catch (...) {
+            stop(current_exception());
+        }
+
+        stats.reader.waitSeconds = waited;
+        stats.reader.busySeconds = secondsSince(start) - waited;
+    });
+
+    vector<StageTiming> tokenizerTimings(tokenizerThreads);
+    atomic<size_t> tokenizersLeft{tokenizerThreads};
+    vector<thread> tokenizers;
+    for (size_t worker = 0; worker < tokenizerThreads; worker++) {
+        tokenizers.emplace_back([&, worker]() {
+            StageTiming& timing = tokenizerTimings[worker];
+            StreamTokenizer tokenizer;
+            try {
+                while (true) {
+                    Clock::time_point waitStart = Clock::now();
+                    size_t index;
+                    bool ok = toTokenize.pop(index);
+                    timing.waitSeconds += secondsSince(waitStart);
+                    if (!ok) break;
+
+                    Clock::time_point workStart = Clock::now();
+                    Slot& slot = slots[index];
+                    TokenBatch& batch = slot.batch;
+                    auto handler = [&](string_view token) {
+                        batch.tokens++;
+                        if (batch.words.size() == batch.size) {
+                            batch.words.emplace_back();
+                            batch.hashes.push_back(0);
+                        }
+                        string& word = batch.words[batch.size];
+                        normalize(token, word);
+                        if (word.empty()) return;
+                        batch.hashes[batch.size++] = hashWord(word);
+                    };
+
+                    const char* begin = slot.data.data();
+                    const char* end = begin + slot.size;
+                    if (slot.skipLeading) begin = find_if(begin, end, StreamTokenizer::isSeparator);
+                    tokenizer.feed(begin, static_cast<size_t>(end - begin), handler);
+                    tokenizer.finish(handler);
+                    timing.busySeconds += secondsSince(workStart);
+                    timing.items++;
+
+                    if (!toCount.push(index)) break;
+                }
+            } catch (...) {
+                stop(current_exception());
+            }
+            if (--tokenizersLeft == 0) toCount.close();
+        });
+    }
+
+    // Batches arrive in any order; each waits in its sequence position until
+    // all earlier ones have been counted.
+    vector<size_t> waiting(slotCount, SIZE_MAX);
+    uint64_t nextSequence = 0;
+    try {
+        while (true) {
+            Clock::time_point waitStart = Clock::now();
+            size_t index;
+            bool ok = toCount.pop(index);
+            stats.counter.waitSeconds += secondsSince(waitStart);
+            if (!ok) break;
+
+            waiting[slots[index].sequence % slotCount] = index;
+            while (waiting[nextSequence % slotCount] != SIZE_MAX) {
+                size_t ready = waiting[nextSequence % slotCount];
+                waiting[nextSequence % slotCount] = SIZE_MAX;
+                nextSequence++;
+
+                Slot& slot = slots[ready];
+                Clock::time_point workStart = Clock::now();
+                consume(slot.batch);
+                stats.counter.busySeconds += secondsSince(workStart);
+                stats.counter.items++;
+                stats.tokens += slot.batch.tokens;
+
+                slot.size = 0;
+                slot.skipLeading = false;
+                slot.batch.size = 0;
+                slot.batch.tokens = 0;
+                if (!freeSlots.push(ready)) break;
+            }
+        }
+    } catch (...) {
+        stop(current_exception());
+    }
+    reader.join();
+    for (thread& tokenizer : tokenizers) tokenizer.join();
+
+    for (const StageTiming& timing : tokenizerTimings) {
+        stats.tokenizer.busySeconds += timing.busySeconds;
+        stats.tokenizer.waitSeconds += timing.waitSeconds;
+        stats.tokenizer.items += timing.items;
+    }
+
+    if (error) rethrow_exception(error);
+    return readOk;
+}
+
+const IngestPipeline::Statistics& IngestPipeline::statistics() const {
+    return stats;
+}
@@ -0,0 +1,82 @@
+#ifndef INGESTPIPELINE_H
+#define INGESTPIPELINE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Splits ingestion into three stages that run at the same time: a reader
+// thread cuts the input into chunks at token boundaries, tokenizer threads
+// turn chunks into batches of normalized, hashed tokens, and the calling
+// thread counts the batches in input order. The stages hand each other
+// slots from a fixed set through bounded queues, so a slow stage stalls
+// the ones before it instead of letting memory grow.
+class IngestPipeline {
+public:
+    struct TokenBatch {
+        // Only the first size entries belong to the batch; the strings are
+        // kept between chunks so their buffers are reused.
+        vector<string> words;
+        vector<uint64_t> hashes;
+        size_t size = 0;
+        // Tokens before normalization, including those it dropped.
+        uint64_t tokens = 0;
+    };
+
+    // busySeconds is time spent working, waitSeconds time blocked on the
+    // neighbouring stages; both are summed over the threads of a stage. The
+    // bottleneck is the stage that rarely waits.
+    struct StageTiming {
+        double busySeconds = 0;
+        double waitSeconds = 0;
+        uint64_t items = 0;
+    };
+
+    struct Statistics {
+        StageTiming reader;
+        StageTiming tokenizer;
+        StageTiming counter;
+        size_t tokenizerThreads = 0;
+        uint64_t bytes = 0;
+        uint64_t tokens = 0;
+    };
+
+    using ChunkSink = function<void(const char* data, size_t size)>;
+    // Runs on the reader thread and passes the whole input to sink in
+    // pieces of any size. False on a read error.
+    using Producer = function<bool(const ChunkSink& sink)>;
+    // Writes the normalized form of token to out, empty to drop it. Called
+    // from several threads at once.
+    using Normalizer = function<void(string_view token, string& out)>;
+    using BatchConsumer = function<void(const TokenBatch& batch)>;
+
+    static constexpr size_t DefaultChunkSize = 1 << 18;
+    static constexpr size_t DefaultQueueDepth = 8;
+    static constexpr size_t MaxTokenizerThreads = 4;
+
+    // tokenizerThreads 0 picks from the hardware. The chunk size is raised
+    // to at least twice StreamTokenizer::MaxTokenLength.
+    explicit IngestPipeline(size_t tokenizerThreads = 0, size_t chunkSize = DefaultChunkSize,
+                            size_t queueDepth = DefaultQueueDepth);
+
+    // consume runs on the calling thread for every batch, in input order.
+    // False if produce failed; the batches before the failure are consumed
+    // anyway. An exception from any stage stops the others and is rethrown.
+    bool run(const Producer& produce, const Normalizer& normalize, const BatchConsumer& consume);
+
+    // Of the last run.
+    const Statistics& statistics() const;
+
+private:
+    size_t tokenizerThreads;
+    size_t chunkSize;
+    size_t queueDepth;
+    Statistics stats;
+};
+
+#endif // INGESTPIPELINE_H
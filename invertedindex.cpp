@@ -0,0 +1,385 @@
+#include "invertedindex.h"
+#include "logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+using namespace std;
+
+namespace {
+
+const char IndexMagic[4] = {'D', 'I', 'D', 'X'};
+const uint32_t IndexVersion = 2;
+
+struct IndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t documentCount;
+    uint32_t wordCount;
+    uint64_t documentsOffset;
+    uint64_t frequenciesOffset;
+    uint64_t offsetsOffset;
+    uint64_t postingsOffset;
+    uint64_t fileSize;
+    uint64_t checkpoint;
+};
+
+void appendVarint(vector<uint8_t>& data, uint32_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t*& position, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; position < end && shift < 35; shift += 7) {
+        uint8_t byte = *position++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+template <typename T>
+void appendRaw(vector<uint8_t>& data, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+void alignTo(vector<uint8_t>& data, size_t alignment) {
+    while (data.size() % alignment != 0) data.push_back(0);
+}
+
+}
+
+InvertedIndex::PostingIterator::PostingIterator(const uint8_t* begin, const uint8_t* end, uint32_t documentLimit)
+    : position(begin), end(end), documentLimit(documentLimit), currentDocument(0), currentFrequency(0),
+      started(false) {
+}
+
+bool InvertedIndex::PostingIterator::next() {
+    uint32_t delta = 0;
+    uint32_t frequency = 0;
+    if (position >= end || !readVarint(position, end, delta) || !readVarint(position, end, frequency)) {
+        return false;
+    }
+
+    uint64_t document = started ? static_cast<uint64_t>(currentDocument) + delta : delta;
+    if (document >= documentLimit) {
+        position = end;
+        return false;
+    }
+    currentDocument = static_cast<uint32_t>(document);
+    currentFrequency = frequency;
+    started = true;
+    return true;
+}
+
+uint32_t InvertedIndex::PostingIterator::document() const {
+    return currentDocument;
+}
+
+uint32_t InvertedIndex::PostingIterator::frequency() const {
+    return currentFrequency;
+}
+
+InvertedIndex::InvertedIndex()
+    : mappedPostings(nullptr), mappedOffsets(nullptr), mappedFrequencies(nullptr), mappedWords(0) {
+}
+
+InvertedIndex::~InvertedIndex() {
+    unmap();
+}
+
+uint32_t InvertedIndex::addDocument(const string& name, const unordered_map<uint32_t, uint32_t>& termFrequencies,
+                                    uint64_t tokenCount) {
+    materialize();
+
+    uint32_t document = static_cast<uint32_t>(documents.size());
+    documents.push_back({name, tokenCount});
+
+    vector<pair<uint32_t, uint32_t>> terms(termFrequencies.begin(), termFrequencies.end());
+    sort(terms.begin(), terms.end());
+
+    for (const auto& [wordId, frequency] : terms) {
+        if (wordId >= lists.size()) lists.resize(wordId + 1);
+
+        PostingList& list = lists[wordId];
+        appendVarint(list.data, list.documentFrequency == 0 ? document : document - list.lastDocument);
+        appendVarint(list.data, frequency);
+        list.lastDocument = document;
+        list.documentFrequency++;
+    }
+    return document;
+}
+
+size_t InvertedIndex::documentCount() const {
+    return documents.size();
+}
+
+const string& InvertedIndex::documentName(uint32_t document) const {
+    return documents.at(document).name;
+}
+
+uint64_t InvertedIndex::documentLength(uint32_t document) const {
+    return documents.at(document).tokenCount;
+}
+
+uint32_t InvertedIndex::documentFrequency(uint32_t wordId) const {
+    if (mappedFile) return wordId < mappedWords ? mappedFrequencies[wordId] : 0;
+    return wordId < lists.size() ? lists[wordId].documentFrequency : 0;
+}
+
+InvertedIndex::PostingIterator InvertedIndex::postings(uint32_t wordId) const {
+    if (mappedFile) {
+        if (wordId >= mappedWords) return PostingIterator();
+        return PostingIterator(mappedPostings + mappedOffsets[wordId], mappedPostings + mappedOffsets[wordId + 1],
+                               static_cast<uint32_t>(documents.size()));
+    }
+    if (wordId >= lists.size()) return PostingIterator();
+
+    const auto& data = lists[wordId].data;
+    return PostingIterator(data.data(), data.data() + data.size(), static_cast<uint32_t>(documents.size()));
+}
+
+vector<pair<uint32_t, double>> InvertedIndex::rankTfIdf(const vector<uint32_t>& wordIds, size_t limit) const {
+    vector<double> scores(documents.size(), 0.0);
+    const double total = static_cast<double>(documents.size());
+
+    for (uint32_t wordId : wordIds) {
+        uint32_t frequency = documentFrequency(wordId);
+        if (frequency == 0) continue;
+
+        double idf = log((1.0 + total) / (1.0 + frequency)) + 1.0;
+        PostingIterator it = postings(wordId);
+        while (it.next()) {
+            uint64_t length = max<uint64_t>(documents[it.document()].tokenCount, 1);
+            scores[it.document()] += static_cast<double>(it.frequency()) / static_cast<double>(length) * idf;
+        }
+    }
+
+    vector<pair<uint32_t, double>> ranking;
+    for (uint32_t document = 0; document < scores.size(); document++) {
+        if (scores[document] > 0.0) ranking.emplace_back(document, scores[document]);
+    }
+
+    auto byScore = [](const auto& a, const auto& b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    };
+    if (ranking.size() > limit) {
+        partial_sort(ranking.begin(), ranking.begin() + static_cast<ptrdiff_t>(limit), ranking.end(), byScore);
+        ranking.resize(limit);
+    } else {
+        sort(ranking.begin(), ranking.end(), byScore);
+    }
+    return ranking;
+}
+
+bool InvertedIndex::save(const QString& filePath, const vector<uint32_t>& wordOrder, uint64_t checkpoint) const {
+    vector<uint8_t> image;
+    IndexHeader header{};
+    memcpy(header.magic, IndexMagic, sizeof(IndexMagic));
+    header.version = IndexVersion;
+    header.checkpoint = checkpoint;
+    header.documentCount = static_cast<uint32_t>(documents.size());
+    header.wordCount = static_cast<uint32_t>(wordOrder.size());
+    image.resize(sizeof(IndexHeader));
+
+    header.documentsOffset = image.size();
+    for (const auto& document : documents) {
+        appendRaw(image, document.tokenCount);
+        appendRaw(image, static_cast<uint32_t>(document.name.size()));
+        image.insert(image.end(), document.name.begin(), document.name.end());
+    }
+
+    alignTo(image, sizeof(uint32_t));
+    header.frequenciesOffset = image.size();
+    for (uint32_t wordId : wordOrder) {
+        appendRaw(image, documentFrequency(wordId));
+    }
+
+    vector<uint8_t> postingBlob;
+    vector<uint64_t> offsets{0};
+    for (uint32_t wordId : wordOrder) {
+        PostingIterator it = postings(wordId);
+        uint32_t previous = 0;
+        bool first = true;
+        while (it.next()) {
+            appendVarint(postingBlob, first ? it.document() : it.document() - previous);
+            appendVarint(postingBlob, it.frequency());
+            previous = it.document();
+            first = false;
+        }
+        offsets.push_back(postingBlob.size());
+    }
+
+    alignTo(image, sizeof(uint64_t));
+    header.offsetsOffset = image.size();
+    for (uint64_t offset : offsets) {
+        appendRaw(image, offset);
+    }
+
+    header.postingsOffset = image.size();
+    image.insert(image.end(), postingBlob.begin(), postingBlob.end());
+    header.fileSize = image.size();
+    memcpy(image.data(), &header, sizeof(header));
+
+    // Written aside and renamed: the index being saved may be the one
+    // mapped from filePath, and truncating that file under the mapping
+    // would change or fault its pages.
+    QString temporaryPath = filePath + ".tmp";
+    QFile file(temporaryPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        Logger::log(Logger::Error, "Failed to save document index to file: " + filePath.toStdString());
+        return false;
+    }
+    bool written = file.write(reinterpret_cast<const char*>(image.data()), static_cast<qint64>(image.size())) ==
+                   static_cast<qint64>(image.size());
+    file.close();
+
+    error_code error;
+    if (written) filesystem::rename(temporaryPath.toStdString(), filePath.toStdString(), error);
+    if (!written || error) {
+        Logger::log(Logger::Error, "Failed to write document index: " + filePath.toStdString());
+        filesystem::remove(temporaryPath.toStdString(), error);
+        return false;
+    }
+    Logger::log(Logger::Info, "Document index saved to file: " + filePath.toStdString() +
+               ", documents: " + to_string(documents.size()) + ", bytes: " + to_string(image.size()));
+    return true;
+}
+
+bool InvertedIndex::load(const QString& filePath, size_t expectedWordCount) {
+    clear();
+
+    auto file = make_unique<QFile>(filePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        Logger::log(Logger::Error, "Failed to open document index: " + filePath.toStdString());
+        return false;
+    }
+
+    qint64 size = file->size();
+    const uint8_t* image = size >= static_cast<qint64>(sizeof(IndexHeader)) ? file->map(0, size) : nullptr;
+    IndexHeader header{};
+    if (image) memcpy(&header, image, sizeof(header));
+
+    if (!image || memcmp(header.magic, IndexMagic, sizeof(IndexMagic)) != 0 ||
+        header.version != IndexVersion || header.fileSize != static_cast<uint64_t>(size) ||
+        header.wordCount != expectedWordCount || header.documentsOffset > header.frequenciesOffset ||
+        header.frequenciesOffset + static_cast<uint64_t>(header.wordCount) * sizeof(uint32_t) > header.offsetsOffset ||
+        header.frequenciesOffset % sizeof(uint32_t) != 0 || header.offsetsOffset % sizeof(uint64_t) != 0 ||
+        header.postingsOffset > header.fileSize ||
+        header.offsetsOffset + (static_cast<uint64_t>(header.wordCount) + 1) * sizeof(uint64_t) >
+            header.postingsOffset) {
+        Logger::log(Logger::Error, "Invalid or mismatching document index: " + filePath.toStdString());
+        return false;
+    }
+
+    // Posting lists are sliced straight out of the mapping, so every row
+    // has to lie inside the postings area.
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(image + header.offsetsOffset);
+    uint64_t postingsSize = header.fileSize - header.postingsOffset;
+    bool offsetsValid = offsets[header.wordCount] <= postingsSize;
+    for (uint32_t wordId = 0; offsetsValid && wordId < header.wordCount; wordId++) {
+        offsetsValid = offsets[wordId] <= offsets[wordId + 1];
+    }
+    if (!offsetsValid) {
+        Logger::log(Logger::Error, "Corrupt posting offsets in index: " + filePath.toStdString());
+        return false;
+    }
+
+    const uint8_t* position = image + header.documentsOffset;
+    const uint8_t* end = image + header.frequenciesOffset;
+    for (uint32_t i = 0; i < header.documentCount; i++) {
+        Document document{};
+        uint32_t nameLength = 0;
+        if (position + sizeof(uint64_t) + sizeof(uint32_t) > end) break;
+        memcpy(&document.tokenCount, position, sizeof(uint64_t));
+        memcpy(&nameLength, position + sizeof(uint64_t), sizeof(uint32_t));
+        position += sizeof(uint64_t) + sizeof(uint32_t);
+        if (position + nameLength > end) break;
+        document.name.assign(reinterpret_cast<const char*>(position), nameLength);
+        position += nameLength;
+        documents.push_back(std::move(document));
+    }
+
+    if (documents.size() != header.documentCount) {
+        Logger::log(Logger::Error, "Truncated document table in index: " + filePath.toStdString());
+        documents.clear();
+        return false;
+    }
+
+    mappedFrequencies = reinterpret_cast<const uint32_t*>(image + header.frequenciesOffset);
+    mappedOffsets = offsets;
+    mappedPostings = image + header.postingsOffset;
+    mappedWords = header.wordCount;
+    mappedFile = std::move(file);
+
+    Logger::log(Logger::Info, "Document index mapped from file: " + filePath.toStdString() +
+               ", documents: " + to_string(documents.size()));
+    return true;
+}
+
+uint64_t InvertedIndex::checkpoint(const QString& filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+    IndexHeader header{};
+    qint64 bytesRead = file.read(reinterpret_cast<char*>(&header), static_cast<qint64>(sizeof(header)));
+    file.close();
+
+    if (bytesRead != static_cast<qint64>(sizeof(header)) || memcmp(header.magic, IndexMagic, sizeof(IndexMagic)) != 0 ||
+        header.version != IndexVersion) {
+        return 0;
+    }
+    return header.checkpoint;
+}
+
+void InvertedIndex::clear() {
+    unmap();
+    documents.clear();
+    lists.clear();
+}
+
+void InvertedIndex::remap(const vector<uint32_t>& newIds) {
+    materialize();
+
+    vector<PostingList> remapped;
+    for (uint32_t wordId = 0; wordId < lists.size() && wordId < newIds.size(); wordId++) {
+        uint32_t newId = newIds[wordId];
+        if (newId == UINT32_MAX) continue;
+        if (newId >= remapped.size()) remapped.resize(static_cast<size_t>(newId) + 1);
+        remapped[newId] = std::move(lists[wordId]);
+    }
+    lists.swap(remapped);
+}
+
+void InvertedIndex::materialize() {
+    if (!mappedFile) return;
+
+    lists.assign(mappedWords, PostingList());
+    for (uint32_t wordId = 0; wordId < mappedWords; wordId++) {
+        PostingList& list = lists[wordId];
+        list.data.assign(mappedPostings + mappedOffsets[wordId], mappedPostings + mappedOffsets[wordId + 1]);
+        list.documentFrequency = mappedFrequencies[wordId];
+
+        PostingIterator it = postings(wordId);
+        while (it.next()) {
+            list.lastDocument = it.document();
+        }
+    }
+    unmap();
+}
+
+void InvertedIndex::unmap() {
+    if (mappedFile) {
+        mappedFile->close();
+        mappedFile.reset();
+    }
+    mappedPostings = nullptr;
+    mappedOffsets = nullptr;
+    mappedFrequencies = nullptr;
+    mappedWords = 0;
+}
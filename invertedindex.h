@@ -0,0 +1,101 @@
+#ifndef INVERTEDINDEX_H
+#define INVERTEDINDEX_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <QString>
+#include <QFile>
+
+using namespace std;
+
+// Word id -> documents inverted index. Each posting list is a sequence of
+// (document delta, term frequency) varint pairs in increasing document order.
+// The saved form can be memory-mapped and queried without decoding it first.
+class InvertedIndex {
+public:
+    // Stops at the first document id at or past documentLimit, so a corrupt
+    // mapped list never yields an id that indexes past the document table.
+    class PostingIterator {
+    public:
+        PostingIterator(const uint8_t* begin = nullptr, const uint8_t* end = nullptr,
+                        uint32_t documentLimit = 0);
+
+        bool next();
+
+        uint32_t document() const;
+
+        uint32_t frequency() const;
+
+    private:
+        const uint8_t* position;
+        const uint8_t* end;
+        uint32_t documentLimit;
+        uint32_t currentDocument;
+        uint32_t currentFrequency;
+        bool started;
+    };
+
+    InvertedIndex();
+    ~InvertedIndex();
+
+    uint32_t addDocument(const string& name, const unordered_map<uint32_t, uint32_t>& termFrequencies,
+                         uint64_t tokenCount);
+
+    size_t documentCount() const;
+
+    const string& documentName(uint32_t document) const;
+
+    uint64_t documentLength(uint32_t document) const;
+
+    uint32_t documentFrequency(uint32_t wordId) const;
+
+    PostingIterator postings(uint32_t wordId) const;
+
+    // Documents ranked by sum of (tf / document length) * smoothed idf.
+    vector<pair<uint32_t, double>> rankTfIdf(const vector<uint32_t>& wordIds, size_t limit) const;
+
+    // Writes posting lists in the given word id order, so row i of the file
+    // belongs to wordOrder[i]. The checkpoint is stored in the header so the
+    // index can be matched to the dictionary it was saved with.
+    bool save(const QString& filePath, const vector<uint32_t>& wordOrder, uint64_t checkpoint = 0) const;
+
+    // Maps the file; rows become word ids 0..wordCount-1.
+    bool load(const QString& filePath, size_t expectedWordCount);
+
+    // The checkpoint save() was given; 0 if none or the file is not an index.
+    static uint64_t checkpoint(const QString& filePath);
+
+    void clear();
+
+    // Renumbers word ids; postings of words mapped to UINT32_MAX are dropped.
+    void remap(const vector<uint32_t>& newIds);
+
+private:
+    struct PostingList {
+        vector<uint8_t> data;
+        uint32_t lastDocument = 0;
+        uint32_t documentFrequency = 0;
+    };
+
+    struct Document {
+        string name;
+        uint64_t tokenCount;
+    };
+
+    vector<Document> documents;
+    vector<PostingList> lists;
+
+    unique_ptr<QFile> mappedFile;
+    const uint8_t* mappedPostings;
+    const uint64_t* mappedOffsets;
+    const uint32_t* mappedFrequencies;
+    size_t mappedWords;
+
+    void materialize();
+    void unmap();
+};
+
+#endif // INVERTEDINDEX_H
@@ -1,12 +1,113 @@
 #include <QtWidgets/QApplication>
 #include "mainwindow.h"
 #include "logger.h"
+#include "dictionary.h"
 #include <QDir>
 #include <QDebug>
+#include <QFileInfo>
+#include <csignal>
+#include <chrono>
 
 using namespace std;
 
+// Headless mode: untitled5 --ingest <output.dict> [--cache <dir>] [input ...]
+// Inputs may be files, FIFOs or directories; "-" or no inputs at all reads
+// stdin. With --cache, directories are counted incrementally: only files that
+// changed since the last run are read again.
+static int runIngest(int argc, char *argv[]) {
+    if (argc < 3) {
+        qDebug() << "Usage:" << argv[0] << "--ingest <output.dict> [--cache <dir>] [input ...]";
+        return 2;
+    }
+
+    Logger::init((QDir::currentPath() + "/dictionary_app.log").toStdString());
+
+    Dictionary dictionary;
+    bool ok = true;
+    int firstInput = 3;
+    if (argc > 4 && QString(argv[3]) == "--cache") {
+        ok = dictionary.setIngestCache(QString::fromLocal8Bit(argv[4]));
+        firstInput = 5;
+    }
+
+    if (argc == firstInput) {
+        ok = dictionary.addWordsFromStdin() && ok;
+    }
+    for (int i = firstInput; i < argc; i++) {
+        QString input = QString::fromLocal8Bit(argv[i]);
+        if (input == "-") {
+            ok = dictionary.addWordsFromStdin() && ok;
+        } else if (QFileInfo(input).isDir()) {
+            ok = dictionary.addWordsFromDirectory(input) && ok;
+        } else {
+            ok = dictionary.addWordsFromFile(input) && ok;
+        }
+    }
+
+    ok = dictionary.saveToFile(QString::fromLocal8Bit(argv[2])) && ok;
+    Logger::close();
+    return ok ? 0 : 1;
+}
+
+static volatile sig_atomic_t stopFollowing = 0;
+
+static void requestStop(int) {
+    stopFollowing = 1;
+}
+
+// Headless mode: untitled5 --follow <output.dict> <file ...>
+// Resumes from output.dict if it exists, then keeps counting appended lines
+// until SIGINT/SIGTERM, saving at most every SaveIntervalSeconds.
+static int runFollow(int argc, char *argv[]) {
+    constexpr int SaveIntervalSeconds = 10;
+
+    if (argc < 4) {
+        qDebug() << "Usage:" << argv[0] << "--follow <output.dict> <file ...>";
+        return 2;
+    }
+
+    Logger::init((QDir::currentPath() + "/dictionary_app.log").toStdString());
+
+    QString dictionaryPath = QString::fromLocal8Bit(argv[2]);
+    Dictionary dictionary;
+    if (QFileInfo(dictionaryPath).isFile() && !dictionary.loadFromFile(dictionaryPath)) {
+        Logger::close();
+        return 1;
+    }
+    dictionary.pollFollowedFiles();
+    for (int i = 3; i < argc; i++) {
+        dictionary.followFile(QString::fromLocal8Bit(argv[i]));
+    }
+
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    auto lastSave = chrono::steady_clock::now();
+    bool unsaved = true;
+    while (!stopFollowing) {
+        dictionary.waitForFollowedFiles(1000);
+        if (dictionary.pollFollowedFiles() > 0) unsaved = true;
+
+        auto now = chrono::steady_clock::now();
+        if (unsaved && now - lastSave >= chrono::seconds(SaveIntervalSeconds)) {
+            unsaved = !dictionary.saveToFile(dictionaryPath);
+            lastSave = now;
+        }
+    }
+
+    bool ok = dictionary.saveToFile(dictionaryPath);
+    Logger::close();
+    return ok ? 0 : 1;
+}
+
 int main(int argc, char *argv[]) {
+    if (argc > 1 && QString(argv[1]) == "--ingest") {
+        return runIngest(argc, argv);
+    }
+    if (argc > 1 && QString(argv[1]) == "--follow") {
+        return runFollow(argc, argv);
+    }
+
     try {
         QApplication app(argc, argv);
 
@@ -8,6 +8,7 @@
 #include <QDir>
 #include <QStandardPaths>
 #include <QMessageBox>
+#include <QProgressDialog>
 
 using namespace std;
 
@@ -80,11 +81,13 @@ void MainWindow::setupUi()
     QHBoxLayout *controlLayout = new QHBoxLayout();
 
     QPushButton *loadTextButton = new QPushButton("Загрузить текстовый файл", this);
+    QPushButton *loadDirectoryButton = new QPushButton("Загрузить папку", this);
     QPushButton *saveDictButton = new QPushButton("Сохранить словарь", this);
     QPushButton *loadDictButton = new QPushButton("Загрузить словарь", this);
     QPushButton *clearDictButton = new QPushButton("Очистить словарь", this);
     
     controlLayout->addWidget(loadTextButton);
+    controlLayout->addWidget(loadDirectoryButton);
     controlLayout->addWidget(saveDictButton);
     controlLayout->addWidget(loadDictButton);
     controlLayout->addWidget(clearDictButton);
@@ -102,6 +105,33 @@ void MainWindow::setupUi()
     
     mainLayout->addWidget(sortGroup);
 
+    QGroupBox *filterGroup = new QGroupBox("Фильтр по частоте", this);
+    QHBoxLayout *filterLayout = new QHBoxLayout(filterGroup);
+
+    minCountSpinBox = new QSpinBox(this);
+    minCountSpinBox->setRange(1, INT_MAX);
+    maxCountSpinBox = new QSpinBox(this);
+    maxCountSpinBox->setRange(0, INT_MAX);
+    maxCountSpinBox->setSpecialValueText("без ограничения");
+    QPushButton *applyFilterButton = new QPushButton("Применить", this);
+    QPushButton *resetFilterButton = new QPushButton("Сбросить", this);
+
+    rankLineEdit = new QLineEdit(this);
+    rankLineEdit->setPlaceholderText("Слово");
+    QPushButton *rankButton = new QPushButton("Ранг слова", this);
+
+    filterLayout->addWidget(new QLabel("от", this));
+    filterLayout->addWidget(minCountSpinBox);
+    filterLayout->addWidget(new QLabel("до", this));
+    filterLayout->addWidget(maxCountSpinBox);
+    filterLayout->addWidget(applyFilterButton);
+    filterLayout->addWidget(resetFilterButton);
+    filterLayout->addStretch();
+    filterLayout->addWidget(rankLineEdit);
+    filterLayout->addWidget(rankButton);
+
+    mainLayout->addWidget(filterGroup);
+
     tableWidget = new QTableWidget(0, 2, this);
     QStringList headers;
     headers << "Слово" << "Частота";
@@ -113,6 +143,22 @@ void MainWindow::setupUi()
     
     mainLayout->addWidget(tableWidget);
 
+    QHBoxLayout *pageLayout = new QHBoxLayout();
+
+    previousPageButton = new QPushButton("Назад", this);
+    nextPageButton = new QPushButton("Вперёд", this);
+    pageLabel = new QLabel(this);
+    previousPageButton->setEnabled(false);
+    nextPageButton->setEnabled(false);
+
+    pageLayout->addWidget(previousPageButton);
+    pageLayout->addStretch();
+    pageLayout->addWidget(pageLabel);
+    pageLayout->addStretch();
+    pageLayout->addWidget(nextPageButton);
+
+    mainLayout->addLayout(pageLayout);
+
     QHBoxLayout *bottomLayout = new QHBoxLayout();
     
     QLabel *logLevelLabel = new QLabel("Уровень логирования:", this);
@@ -132,11 +178,18 @@ void MainWindow::setupUi()
     statusBar()->addWidget(statusLabel);
 
     connect(loadTextButton, &QPushButton::clicked, this, &MainWindow::onLoadTextFile);
+    connect(loadDirectoryButton, &QPushButton::clicked, this, &MainWindow::onLoadDirectory);
     connect(saveDictButton, &QPushButton::clicked, this, &MainWindow::onSaveDictionary);
     connect(loadDictButton, &QPushButton::clicked, this, &MainWindow::onLoadDictionary);
     connect(clearDictButton, &QPushButton::clicked, this, &MainWindow::onClearDictionary);
     connect(sortAlphaButton, &QPushButton::clicked, this, &MainWindow::onSortAlphabetically);
     connect(sortFreqButton, &QPushButton::clicked, this, &MainWindow::onSortByFrequency);
+    connect(applyFilterButton, &QPushButton::clicked, this, &MainWindow::onApplyCountFilter);
+    connect(resetFilterButton, &QPushButton::clicked, this, &MainWindow::onResetCountFilter);
+    connect(rankButton, &QPushButton::clicked, this, &MainWindow::onShowRank);
+    connect(rankLineEdit, &QLineEdit::returnPressed, this, &MainWindow::onShowRank);
+    connect(previousPageButton, &QPushButton::clicked, this, &MainWindow::onPreviousPage);
+    connect(nextPageButton, &QPushButton::clicked, this, &MainWindow::onNextPage);
     connect(logLevelComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), 
             this, &MainWindow::onChangeLogLevel);
 }
@@ -146,12 +199,14 @@ void MainWindow::createMenus()
     QMenu *fileMenu = menuBar()->addMenu("Файл");
     
     QAction *loadTextAction = new QAction("Загрузить текстовый файл", this);
+    QAction *loadDirectoryAction = new QAction("Загрузить папку", this);
     QAction *saveDictAction = new QAction("Сохранить словарь", this);
     QAction *loadDictAction = new QAction("Загрузить словарь", this);
     QAction *clearDictAction = new QAction("Очистить словарь", this);
     QAction *exitAction = new QAction("Выход", this);
     
     fileMenu->addAction(loadTextAction);
+    fileMenu->addAction(loadDirectoryAction);
     fileMenu->addAction(saveDictAction);
     fileMenu->addAction(loadDictAction);
     fileMenu->addAction(clearDictAction);
@@ -173,6 +228,7 @@ void MainWindow::createMenus()
     helpMenu->addAction(aboutAction);
 
     connect(loadTextAction, &QAction::triggered, this, &MainWindow::onLoadTextFile);
+    connect(loadDirectoryAction, &QAction::triggered, this, &MainWindow::onLoadDirectory);
     connect(saveDictAction, &QAction::triggered, this, &MainWindow::onSaveDictionary);
     connect(loadDictAction, &QAction::triggered, this, &MainWindow::onLoadDictionary);
     connect(clearDictAction, &QAction::triggered, this, &MainWindow::onClearDictionary);
@@ -187,7 +243,7 @@ void MainWindow::onLoadTextFile()
     try {
         QString filePath = QFileDialog::getOpenFileName(
             this, "Выберите текстовый файл", QDir::homePath(), 
-            "Текстовые файлы (*.txt);;Все файлы (*.*)");
+            "Текстовые файлы (*.txt);;Сжатые файлы (*.gz *.zst *.xz);;Все файлы (*.*)");
             
         if (filePath.isEmpty()) {
             Logger::log(Logger::Debug, "Пользователь отменил выбор файла");
@@ -197,7 +253,7 @@ void MainWindow::onLoadTextFile()
         Logger::log(Logger::Info, "Выбран файл для загрузки: " + filePath.toStdString());
 
         if (dictionary.addWordsFromFile(filePath)) {
-            updateWordTable(dictionary.getWordsAlphabetically());
+            showWords(Dictionary::Alphabetical);
             updateStatusBar();
             QMessageBox::information(this, "Успех", 
                                      "Слова успешно загружены из файла:\n" + filePath);
@@ -214,6 +270,50 @@ void MainWindow::onLoadTextFile()
     }
 }
 
+void MainWindow::onLoadDirectory()
+{
+    try {
+        QString directory = QFileDialog::getExistingDirectory(
+            this, "Выберите папку с текстами", QDir::homePath());
+
+        if (directory.isEmpty()) {
+            Logger::log(Logger::Debug, "Пользователь отменил выбор папки");
+            return;
+        }
+
+        Logger::log(Logger::Info, "Выбрана папка для загрузки: " + directory.toStdString());
+
+        QProgressDialog progressDialog("Чтение файлов...", QString(), 0, 1000, this);
+        progressDialog.setWindowModality(Qt::WindowModal);
+        progressDialog.setMinimumDuration(500);
+
+        auto onProgress = [&](const FileScheduler::Progress& progress) {
+            int permille = progress.byteCount ? static_cast<int>(progress.bytesDone * 1000 / progress.byteCount) : 0;
+            progressDialog.setLabelText(QString("Файлов: %1 из %2").arg(progress.filesDone).arg(progress.fileCount));
+            progressDialog.setValue(permille);
+            QApplication::processEvents();
+        };
+
+        bool ok = dictionary.addWordsFromDirectory(directory, "*", true, onProgress);
+        progressDialog.setValue(1000);
+
+        showWords(Dictionary::Alphabetical);
+        updateStatusBar();
+        if (ok) {
+            QMessageBox::information(this, "Успех",
+                                     "Слова успешно загружены из папки:\n" + directory);
+        } else {
+            QMessageBox::warning(this, "Ошибка",
+                                 "Не все файлы удалось прочитать в папке:\n" + directory);
+        }
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Исключение при загрузке папки: " + string(e.what()));
+        QMessageBox::critical(this, "Ошибка",
+                             "Произошла ошибка при загрузке папки: " +
+                             QString::fromStdString(e.what()));
+    }
+}
+
 void MainWindow::onSaveDictionary()
 {
     try {
@@ -276,7 +376,7 @@ void MainWindow::onLoadDictionary()
         
         if (reply == QMessageBox::Yes) {
             if (dictionary.loadFromFile(filePath)) {
-                updateWordTable(dictionary.getWordsAlphabetically());
+                showWords(Dictionary::Alphabetical);
                 updateStatusBar();
                 QMessageBox::information(this, "Успех", 
                                          "Словарь успешно загружен из файла:\n" + filePath);
@@ -294,7 +394,7 @@ void MainWindow::onLoadDictionary()
                     }
                 }
                 
-                updateWordTable(dictionary.getWordsAlphabetically());
+                showWords(Dictionary::Alphabetical);
                 updateStatusBar();
                 QMessageBox::information(this, "Успех", 
                                          "Слова успешно добавлены из файла:\n" + filePath);
@@ -331,7 +431,7 @@ void MainWindow::onClearDictionary()
         }
 
         dictionary.clear();
-        updateWordTable(dictionary.getWordsAlphabetically());
+        showWords(Dictionary::Alphabetical);
         updateStatusBar();
         
         QMessageBox::information(this, "Успех", "Словарь успешно очищен.");
@@ -352,7 +452,7 @@ void MainWindow::onSortAlphabetically()
             return;
         }
         
-        updateWordTable(dictionary.getWordsAlphabetically());
+        showWords(Dictionary::Alphabetical);
         Logger::log(Logger::Info, "Словарь отсортирован по алфавиту");
     } catch (const exception& e) {
         Logger::log(Logger::Error, "Исключение при сортировке по алфавиту: " + 
@@ -371,7 +471,7 @@ void MainWindow::onSortByFrequency()
             return;
         }
         
-        updateWordTable(dictionary.getWordsByFrequency());
+        showWords(Dictionary::ByFrequency);
         Logger::log(Logger::Info, "Словарь отсортирован по частоте");
     } catch (const exception& e) {
         Logger::log(Logger::Error, "Исключение при сортировке по частоте: " + 
@@ -382,6 +482,75 @@ void MainWindow::onSortByFrequency()
     }
 }
 
+void MainWindow::onApplyCountFilter()
+{
+    try {
+        int minCount = minCountSpinBox->value();
+        int maxCount = maxCountSpinBox->value() == 0 ? INT_MAX : maxCountSpinBox->value();
+
+        countFilterActive = true;
+        filterMinCount = minCount;
+        filterMaxCount = maxCount;
+        pageOffset = 0;
+        refreshWordTable();
+
+        statusLabel->setText(QString("Слов с частотой в диапазоне: %1 из %2, 90-й перцентиль частоты: %3")
+                             .arg(QString::number(dictionary.countWordsInRange(minCount, maxCount)))
+                             .arg(QString::number(dictionary.size()))
+                             .arg(QString::number(dictionary.frequencyQuantile(0.9))));
+        Logger::log(Logger::Info, "Применен фильтр по частоте: " + to_string(minCount) + " - " +
+                   to_string(maxCount));
+    } catch (const exception& e) {
+        Logger::log(Logger::Error, "Исключение при фильтрации по частоте: " + 
+                   string(e.what()));
+        QMessageBox::critical(this, "Ошибка", 
+                             "Произошла ошибка при фильтрации: " + 
+                             QString::fromStdString(e.what()));
+    }
+}
+
+void MainWindow::onResetCountFilter()
+{
+    minCountSpinBox->setValue(1);
+    maxCountSpinBox->setValue(0);
+    countFilterActive = false;
+    pageOffset = 0;
+    refreshWordTable();
+    updateStatusBar();
+}
+
+void MainWindow::onPreviousPage()
+{
+    pageOffset = pageOffset > PageSize ? pageOffset - PageSize : 0;
+    refreshWordTable();
+}
+
+void MainWindow::onNextPage()
+{
+    pageOffset += PageSize;
+    refreshWordTable();
+}
+
+void MainWindow::onShowRank()
+{
+    QString word = rankLineEdit->text().trimmed();
+    if (word.isEmpty()) {
+        return;
+    }
+
+    size_t rank = dictionary.rank(word.toStdString());
+    if (rank == 0) {
+        QMessageBox::information(this, "Ранг слова", "Слово \"" + word + "\" не найдено в словаре.");
+        return;
+    }
+
+    QMessageBox::information(this, "Ранг слова",
+                             QString("Слово \"%1\" занимает %2 место по частоте из %3.")
+                             .arg(word)
+                             .arg(QString::number(rank))
+                             .arg(QString::number(dictionary.size())));
+}
+
 void MainWindow::onAbout()
 {
     QMessageBox::about(this, "О программе", 
@@ -415,16 +584,57 @@ void MainWindow::onChangeLogLevel(int index)
     }
 }
 
-void MainWindow::updateWordTable(const vector<pair<string, int>>& words)
+void MainWindow::showWords(Dictionary::SortOrder order)
+{
+    if (order == shownOrder && !countFilterActive && pageOffset == 0 &&
+        dictionary.version() == shownVersion) {
+        return;
+    }
+
+    if (countFilterActive) {
+        countFilterActive = false;
+        minCountSpinBox->setValue(1);
+        maxCountSpinBox->setValue(0);
+    }
+    shownOrder = order;
+    pageOffset = 0;
+    refreshWordTable();
+}
+
+void MainWindow::refreshWordTable()
+{
+    Dictionary::WordView words = countFilterActive
+        ? dictionary.wordsInCountRange(filterMinCount, filterMaxCount)
+        : dictionary.words(shownOrder);
+
+    if (pageOffset >= words.size()) {
+        pageOffset = words.empty() ? 0 : (words.size() - 1) / PageSize * PageSize;
+    }
+    Dictionary::WordView page = words.subview(pageOffset, PageSize);
+    updateWordTable(page);
+
+    pageLabel->setText(words.empty()
+        ? QString("Нет строк")
+        : QString("Строки %1–%2 из %3")
+              .arg(QString::number(pageOffset + 1))
+              .arg(QString::number(pageOffset + page.size()))
+              .arg(QString::number(words.size())));
+    previousPageButton->setEnabled(pageOffset > 0);
+    nextPageButton->setEnabled(pageOffset + PageSize < words.size());
+    shownVersion = dictionary.version();
+}
+
+void MainWindow::updateWordTable(const Dictionary::WordView& words)
 {
     tableWidget->setRowCount(0);
 
     tableWidget->setRowCount(static_cast<int>(words.size()));
     
     for (size_t i = 0; i < words.size(); ++i) {
-        const auto& [word, count] = words[i];
+        const auto [word, count] = words[i];
         
-        QTableWidgetItem *wordItem = new QTableWidgetItem(QString::fromStdString(word));
+        QTableWidgetItem *wordItem = new QTableWidgetItem(
+            QString::fromUtf8(word.data(), static_cast<qsizetype>(word.size())));
         QTableWidgetItem *countItem = new QTableWidgetItem(QString::number(count));
 
         countItem->setTextAlignment(Qt::AlignCenter);
@@ -15,6 +15,7 @@
 #include <QMenuBar>
 #include <QStatusBar>
 #include <QComboBox>
+#include <QSpinBox>
 #include <QCloseEvent>
 #include "dictionary.h"
 
@@ -35,11 +36,17 @@ protected:
 
 private slots:
     void onLoadTextFile();
+    void onLoadDirectory();
     void onSaveDictionary();
     void onLoadDictionary();
     void onClearDictionary();
     void onSortAlphabetically();
     void onSortByFrequency();
+    void onApplyCountFilter();
+    void onResetCountFilter();
+    void onShowRank();
+    void onPreviousPage();
+    void onNextPage();
     void onAbout();
     void onChangeLogLevel(int index);
 
@@ -50,11 +57,28 @@ private:
     QTableWidget *tableWidget;
     QLabel *statusLabel;
     QComboBox *logLevelComboBox;
+    QSpinBox *minCountSpinBox;
+    QSpinBox *maxCountSpinBox;
+    QLineEdit *rankLineEdit;
+    QPushButton *previousPageButton;
+    QPushButton *nextPageButton;
+    QLabel *pageLabel;
+
+    static constexpr size_t PageSize = 1000;
+
+    Dictionary::SortOrder shownOrder = Dictionary::Alphabetical;
+    uint64_t shownVersion = UINT64_MAX;
+    size_t pageOffset = 0;
+    bool countFilterActive = false;
+    int filterMinCount = 1;
+    int filterMaxCount = INT_MAX;
 
     void setupUi();
     void createMenus();
 
-    void updateWordTable(const std::vector<std::pair<std::string, int>>& words);
+    void showWords(Dictionary::SortOrder order);
+    void refreshWordTable();
+    void updateWordTable(const Dictionary::WordView& words);
     void updateStatusBar();
 };
 #endif // MAINWINDOW_H 
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "ngramcounter.h"
+#include <algorithm>
+
+using namespace std;
+
+NGramCounter::NGramCounter(int maxOrder)
+    : order(clamp(maxOrder, 2, 3)), previous{0, 0}, filled(0) {
+}
+
+void NGramCounter::push(uint32_t wordId) {
+    if (filled >= 1) {
+        bigrams[(static_cast<uint64_t>(previous[1]) << 32) | wordId]++;
+    }
+    if (order >= 3 && filled >= 2) {
+        trigrams[NGram{previous[0], previous[1], wordId}]++;
+    }
+
+    previous[0] = previous[1];
+    previous[1] = wordId;
+    filled = min(filled + 1, 2);
+}
+
+void NGramCounter::reset() {
+    filled = 0;
+}
+
+void NGramCounter::clear() {
+    bigrams.clear();
+    trigrams.clear();
+    reset();
+}
+
+void NGramCounter::remap(const vector<uint32_t>& newIds) {
+    auto mapped = [&newIds](uint32_t id) { return id < newIds.size() ? newIds[id] : UINT32_MAX; };
+
+    unordered_map<uint64_t, int> remappedBigrams;
+    remappedBigrams.reserve(bigrams.size());
+    for (const auto& [key, count] : bigrams) {
+        uint32_t first = mapped(static_cast<uint32_t>(key >> 32));
+        uint32_t second = mapped(static_cast<uint32_t>(key));
+        if (first == UINT32_MAX || second == UINT32_MAX) continue;
+        remappedBigrams[(static_cast<uint64_t>(first) << 32) | second] += count;
+    }
+    bigrams.swap(remappedBigrams);
+
+    unordered_map<NGram, int, TrigramHash> remappedTrigrams;
+    remappedTrigrams.reserve(trigrams.size());
+    for (const auto& [key, count] : trigrams) {
+        NGram remappedKey = {mapped(key[0]), mapped(key[1]), mapped(key[2])};
+        if (remappedKey[0] == UINT32_MAX || remappedKey[1] == UINT32_MAX || remappedKey[2] == UINT32_MAX) continue;
+        remappedTrigrams[remappedKey] += count;
+    }
+    trigrams.swap(remappedTrigrams);
+
+    for (int i = 2 - filled; i < 2; i++) {
+        previous[i] = mapped(previous[i]);
+        if (previous[i] == UINT32_MAX) filled = min(filled, 1 - i);
+    }
+}
+
+int NGramCounter::maxOrder() const {
+    return order;
+}
+
+size_t NGramCounter::size(int n) const {
+    if (n == 2) return bigrams.size();
+    if (n == 3) return trigrams.size();
+    return 0;
+}
+
+vector<pair<NGramCounter::NGram, int>> NGramCounter::entries(int n) const {
+    vector<pair<NGram, int>> result;
+
+    if (n == 2) {
+        result.reserve(bigrams.size());
+        for (const auto& [key, count] : bigrams) {
+            result.push_back({NGram{static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key), 0}, count});
+        }
+    } else if (n == 3) {
+        result.reserve(trigrams.size());
+        for (const auto& [key, count] : trigrams) {
+            result.push_back({key, count});
+        }
+    }
+    return result;
+}
+
+size_t NGramCounter::TrigramHash::operator()(const NGram& key) const {
+    uint64_t hash = (static_cast<uint64_t>(key[0]) << 32) | key[1];
+    hash ^= static_cast<uint64_t>(key[2]) * 0x9e3779b97f4a7c15ULL;
+    hash ^= hash >> 29;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
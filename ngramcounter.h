@@ -0,0 +1,48 @@
+#ifndef NGRAMCOUNTER_H
+#define NGRAMCOUNTER_H
+
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+// Counts word bigrams and trigrams as tuples of word ids, fed one token at a
+// time in text order.
+class NGramCounter {
+public:
+    using NGram = array<uint32_t, 3>;
+
+    explicit NGramCounter(int maxOrder = 2);
+
+    void push(uint32_t wordId);
+
+    // Starts a new token sequence, so no n-gram spans the boundary.
+    void reset();
+
+    void clear();
+
+    // Renumbers word ids; n-grams containing a word mapped to UINT32_MAX are dropped.
+    void remap(const vector<uint32_t>& newIds);
+
+    int maxOrder() const;
+
+    size_t size(int order) const;
+
+    // Counted n-grams of the given order; unused trailing ids are zero.
+    vector<pair<NGram, int>> entries(int order) const;
+
+private:
+    struct TrigramHash {
+        size_t operator()(const NGram& key) const;
+    };
+
+    int order;
+    uint32_t previous[2];
+    int filled;
+    unordered_map<uint64_t, int> bigrams;
+    unordered_map<NGram, int, TrigramHash> trigrams;
+};
+
+#endif // NGRAMCOUNTER_H
@@ -0,0 +1,251 @@
+#include "parallelsort.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <array>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t InsertionSortSize = 32;
+constexpr size_t ParallelSortSize = 1 << 14;
+
+struct KeyEntry {
+    uint64_t prefix;
+    uint32_t id;
+};
+
+struct CountEntry {
+    uint32_t key;
+    uint32_t id;
+};
+
+uint64_t prefixAt(string_view key, size_t depth) {
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; i++) {
+        uint64_t byte = depth + i < key.size() ? static_cast<uint8_t>(key[depth + i]) : 0;
+        prefix |= byte << (56 - 8 * i);
+    }
+    return prefix;
+}
+
+class KeySorter {
+public:
+    KeySorter(const function<string_view(uint32_t)>& keyOf, ThreadPool::TaskGroup* group)
+        : keyOf(keyOf), group(group) {}
+
+    void sort(KeyEntry* first, size_t n, int byteIndex, size_t depth) const {
+        while (n > InsertionSortSize) {
+            if (byteIndex == 8) {
+                depth += 8;
+                byteIndex = 0;
+                for (size_t i = 0; i < n; i++) {
+                    first[i].prefix = prefixAt(keyOf(first[i].id), depth);
+                }
+            }
+
+            const int shift = 56 - 8 * byteIndex;
+            array<size_t, 256> counts = {};
+            for (size_t i = 0; i < n; i++) {
+                counts[(first[i].prefix >> shift) & 0xff]++;
+            }
+
+            if (counts[(first[0].prefix >> shift) & 0xff] == n) {
+                // Byte 0 only appears once a key has ended, so the whole range is equal.
+                if (((first[0].prefix >> shift) & 0xff) == 0) return;
+                byteIndex++;
+                continue;
+            }
+
+            array<size_t, 256> heads;
+            array<size_t, 256> tails;
+            size_t offset = 0;
+            for (size_t b = 0; b < 256; b++) {
+                heads[b] = offset;
+                offset += counts[b];
+                tails[b] = offset;
+            }
+
+            array<size_t, 256> starts = heads;
+            for (size_t b = 0; b < 256; b++) {
+                while (heads[b] < tails[b]) {
+                    KeyEntry entry = first[heads[b]];
+                    size_t target = (entry.prefix >> shift) & 0xff;
+                    while (target != b) {
+                        swap(entry, first[heads[target]++]);
+                        target = (entry.prefix >> shift) & 0xff;
+                    }
+                    first[heads[b]++] = entry;
+                }
+            }
+
+            for (size_t b = 1; b < 256; b++) {
+                KeyEntry* bucket = first + starts[b];
+                size_t size = counts[b];
+                if (size < 2) continue;
+                if (group && size >= ParallelSortSize) {
+                    group->run([this, bucket, size, byteIndex, depth]() {
+                        sort(bucket, size, byteIndex + 1, depth);
+                    });
+                } else {
+                    sort(bucket, size, byteIndex + 1, depth);
+                }
+            }
+            return;
+        }
+
+        insertionSort(first, n);
+    }
+
+private:
+    const function<string_view(uint32_t)>& keyOf;
+    ThreadPool::TaskGroup* group;
+
+    void insertionSort(KeyEntry* first, size_t n) const {
+        for (size_t i = 1; i < n; i++) {
+            KeyEntry entry = first[i];
+            size_t j = i;
+            while (j > 0 && less(entry, first[j - 1])) {
+                first[j] = first[j - 1];
+                j--;
+            }
+            first[j] = entry;
+        }
+    }
+
+    bool less(const KeyEntry& a, const KeyEntry& b) const {
+        if (a.prefix != b.prefix) return a.prefix < b.prefix;
+        return keyOf(a.id) < keyOf(b.id);
+    }
+};
+
+}
+
+void ParallelSort::byKey(vector<uint32_t>& ids, const function<string_view(uint32_t)>& keyOf) {
+    const size_t n = ids.size();
+    if (n < 2) return;
+
+    vector<KeyEntry> entries(n);
+    auto fill = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            entries[i] = {prefixAt(keyOf(ids[i]), 0), ids[i]};
+        }
+    };
+
+    if (n < ParallelSortSize) {
+        fill(0, n);
+        KeySorter(keyOf, nullptr).sort(entries.data(), n, 0, 0);
+    } else {
+        ThreadPool::TaskGroup group(ThreadPool::shared());
+        const size_t chunk = (n + ThreadPool::shared().threadCount() - 1) / ThreadPool::shared().threadCount();
+        for (size_t begin = 0; begin < n; begin += chunk) {
+            group.run([&, begin]() { fill(begin, min(n, begin + chunk)); });
+        }
+        group.wait();
+
+        KeySorter sorter(keyOf, &group);
+        sorter.sort(entries.data(), n, 0, 0);
+        group.wait();
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        ids[i] = entries[i].id;
+    }
+}
+
+void ParallelSort::byCountDescending(vector<uint32_t>& ids, const function<uint32_t(uint32_t)>& countOf) {
+    const size_t n = ids.size();
+    if (n < 2) return;
+
+    const size_t chunkCount = n < ParallelSortSize ? 1 : ThreadPool::shared().threadCount();
+    const size_t chunk = (n + chunkCount - 1) / chunkCount;
+    auto forEachChunk = [&](const function<void(size_t, size_t, size_t)>& work) {
+        if (chunkCount == 1) {
+            work(0, 0, n);
+            return;
+        }
+        ThreadPool::TaskGroup group(ThreadPool::shared());
+        for (size_t c = 0; c < chunkCount; c++) {
+            size_t begin = min(n, c * chunk);
+            size_t end = min(n, begin + chunk);
+            group.run([&work, c, begin, end]() { work(c, begin, end); });
+        }
+        group.wait();
+    };
+
+    // Inverting the count turns the descending order into an ascending one.
+    vector<CountEntry> entries(n);
+    vector<uint32_t> chunkMaxima(chunkCount, 0);
+    forEachChunk([&](size_t c, size_t begin, size_t end) {
+        uint32_t maximum = 0;
+        for (size_t i = begin; i < end; i++) {
+            uint32_t count = countOf(ids[i]);
+            maximum = max(maximum, count);
+            entries[i] = {~count, ids[i]};
+        }
+        chunkMaxima[c] = maximum;
+    });
+
+    uint32_t maximum = *max_element(chunkMaxima.begin(), chunkMaxima.end());
+    int passes = 0;
+    while (passes < 4 && (maximum >> (8 * passes)) != 0) passes++;
+
+    vector<CountEntry> buffer(n);
+    vector<array<size_t, 256>> histograms(chunkCount);
+    for (int pass = 0; pass < passes; pass++) {
+        const int shift = 8 * pass;
+
+        forEachChunk([&](size_t c, size_t begin, size_t end) {
+            histograms[c].fill(0);
+            for (size_t i = begin; i < end; i++) {
+                histograms[c][(entries[i].key >> shift) & 0xff]++;
+            }
+        });
+
+        size_t offset = 0;
+        for (size_t digit = 0; digit < 256; digit++) {
+            for (size_t c = 0; c < chunkCount; c++) {
+                size_t count = histograms[c][digit];
+                histograms[c][digit] = offset;
+                offset += count;
+            }
+        }
+
+        forEachChunk([&](size_t c, size_t begin, size_t end) {
+            auto& positions = histograms[c];
+            for (size_t i = begin; i < end; i++) {
+                buffer[positions[(entries[i].key >> shift) & 0xff]++] = entries[i];
+            }
+        });
+        entries.swap(buffer);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        ids[i] = entries[i].id;
+    }
+}
+
+void ParallelSort::alphabetically(vector<pair<string, int>>& items) {
+    vector<uint32_t> order(items.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<uint32_t>(i);
+
+    byKey(order, [&items](uint32_t i) { return string_view(items[i].first); });
+
+    vector<pair<string, int>> sorted;
+    sorted.reserve(items.size());
+    for (uint32_t i : order) sorted.push_back(std::move(items[i]));
+    items.swap(sorted);
+}
+
+void ParallelSort::byFrequency(vector<pair<string, int>>& items) {
+    vector<uint32_t> order(items.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<uint32_t>(i);
+
+    byKey(order, [&items](uint32_t i) { return string_view(items[i].first); });
+    byCountDescending(order, [&items](uint32_t i) { return static_cast<uint32_t>(max(items[i].second, 0)); });
+
+    vector<pair<string, int>> sorted;
+    sorted.reserve(items.size());
+    for (uint32_t i : order) sorted.push_back(std::move(items[i]));
+    items.swap(sorted);
+}
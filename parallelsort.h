@@ -0,0 +1,31 @@
+#ifndef PARALLELSORT_H
+#define PARALLELSORT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+using namespace std;
+
+// Radix sorts for the dictionary views, spread over ThreadPool::shared().
+// Keys are read once into cached 8-byte prefixes (or counts), so the hot
+// loops work on flat arrays instead of following string pointers.
+class ParallelSort {
+public:
+    // MSD radix (American flag) sort of ids by key bytes; keyOf must not
+    // return keys containing zero bytes.
+    static void byKey(vector<uint32_t>& ids, const function<string_view(uint32_t)>& keyOf);
+
+    // Stable LSD radix sort of ids by descending count, so ids that arrive in
+    // alphabetical order keep it among equal counts.
+    static void byCountDescending(vector<uint32_t>& ids, const function<uint32_t(uint32_t)>& countOf);
+
+    static void alphabetically(vector<pair<string, int>>& items);
+
+    // Count descending, then alphabetically.
+    static void byFrequency(vector<pair<string, int>>& items);
+};
+
+#endif // PARALLELSORT_H
@@ -0,0 +1,248 @@
+#include "partialcache.h"
+#include "wordhashindex.h"
+#include "logger.h"
+#include <QFile>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+
+using namespace std;
+
+namespace {
+
+const char PartialMagic[4] = {'D', 'P', 'R', 'T'};
+// Bump when tokenizing or normalization changes, so that counts made the
+// old way are not merged into new dictionaries.
+const uint32_t PartialVersion = 2;
+constexpr size_t HashReadSize = 1 << 20;
+
+struct PartialHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t pathLength;
+    uint32_t reserved;
+    uint64_t size;
+    int64_t modified;
+    uint64_t contentHash;
+    uint64_t tokens;
+    uint64_t wordCount;
+    uint64_t fileSize;
+};
+
+void appendVarint(vector<uint8_t>& data, uint64_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t*& position, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; position < end && shift < 64; shift += 7) {
+        uint8_t byte = *position++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool decodeCounts(const uint8_t* position, const uint8_t* end, uint64_t wordCount,
+                  vector<pair<string, uint64_t>>& counts) {
+    counts.clear();
+    counts.reserve(static_cast<size_t>(min<uint64_t>(wordCount, static_cast<uint64_t>(end - position))));
+
+    string word;
+    for (uint64_t i = 0; i < wordCount; i++) {
+        uint64_t shared = 0;
+        uint64_t suffixLength = 0;
+        uint64_t count = 0;
+        if (!readVarint(position, end, shared) || !readVarint(position, end, suffixLength) ||
+            shared > word.size() || suffixLength > static_cast<uint64_t>(end - position)) {
+            return false;
+        }
+        word.resize(static_cast<size_t>(shared));
+        word.append(reinterpret_cast<const char*>(position), static_cast<size_t>(suffixLength));
+        position += suffixLength;
+        if (!readVarint(position, end, count)) return false;
+        counts.emplace_back(word, count);
+    }
+    return position == end;
+}
+
+}
+
+void PartialCache::ContentHasher::update(const char* data, size_t size) {
+    length += size;
+
+    if (pendingSize > 0) {
+        size_t taken = min(size, sizeof(pending) - pendingSize);
+        memcpy(pending + pendingSize, data, taken);
+        pendingSize += taken;
+        data += taken;
+        size -= taken;
+        if (pendingSize < sizeof(pending)) return;
+
+        uint64_t word;
+        memcpy(&word, pending, sizeof(word));
+        state = mixHash(state ^ word);
+        pendingSize = 0;
+    }
+
+    for (; size >= sizeof(uint64_t); data += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        state = mixHash(state ^ word);
+    }
+
+    memcpy(pending, data, size);
+    pendingSize = size;
+}
+
+uint64_t PartialCache::ContentHasher::value() const {
+    uint64_t tail = 0;
+    memcpy(&tail, pending, pendingSize);
+    return mixHash(state ^ tail ^ mixHash(length));
+}
+
+PartialCache::PartialCache(string directory) : root(std::move(directory)) {
+    error_code error;
+    filesystem::create_directories(root, error);
+    if (error) {
+        Logger::log(Logger::Error, "Failed to create cache directory: " + root);
+    }
+}
+
+const string& PartialCache::directory() const {
+    return root;
+}
+
+bool PartialCache::stat(const string& path, Fingerprint& fingerprint) {
+    error_code error;
+    uint64_t size = filesystem::file_size(path, error);
+    if (error) return false;
+    auto modified = filesystem::last_write_time(path, error);
+    if (error) return false;
+
+    fingerprint.size = size;
+    fingerprint.modified = chrono::duration_cast<chrono::nanoseconds>(modified.time_since_epoch()).count();
+    fingerprint.contentHash = 0;
+    return true;
+}
+
+bool PartialCache::hashFile(const string& path, uint64_t& hash) {
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    ContentHasher hasher;
+    vector<char> buffer(HashReadSize);
+    qint64 bytesRead;
+    while ((bytesRead = file.read(buffer.data(), static_cast<qint64>(buffer.size()))) > 0) {
+        hasher.update(buffer.data(), static_cast<size_t>(bytesRead));
+    }
+    file.close();
+    if (bytesRead < 0) return false;
+
+    hash = hasher.value();
+    return true;
+}
+
+bool PartialCache::lookup(const string& path, const Fingerprint& current, Partial& partial) {
+    QFile file(QString::fromStdString(entryPath(path)));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QByteArray content = file.readAll();
+    file.close();
+
+    const uint8_t* image = reinterpret_cast<const uint8_t*>(content.constData());
+    size_t imageSize = static_cast<size_t>(content.size());
+    PartialHeader header{};
+    if (imageSize >= sizeof(header)) memcpy(&header, image, sizeof(header));
+
+    if (imageSize < sizeof(header) || memcmp(header.magic, PartialMagic, sizeof(PartialMagic)) != 0 ||
+        header.version != PartialVersion || header.fileSize != imageSize ||
+        header.pathLength > imageSize - sizeof(header) ||
+        string_view(reinterpret_cast<const char*>(image + sizeof(header)), header.pathLength) != path) {
+        return false;
+    }
+    if (header.size != current.size) return false;
+
+    bool revived = false;
+    if (header.modified != current.modified) {
+        uint64_t hash = 0;
+        if (!hashFile(path, hash) || hash != header.contentHash) return false;
+        revived = true;
+    }
+
+    const uint8_t* words = image + sizeof(header) + header.pathLength;
+    if (!decodeCounts(words, image + imageSize, header.wordCount, partial.counts)) {
+        Logger::log(Logger::Warning, "Corrupt cache entry for " + path);
+        return false;
+    }
+    partial.tokens = header.tokens;
+
+    if (revived) {
+        Fingerprint fingerprint = current;
+        fingerprint.contentHash = header.contentHash;
+        store(path, fingerprint, partial);
+    }
+    return true;
+}
+
+bool PartialCache::store(const string& path, const Fingerprint& fingerprint, const Partial& partial) {
+    vector<uint8_t> image(sizeof(PartialHeader));
+    image.insert(image.end(), path.begin(), path.end());
+
+    string_view previous;
+    for (const auto& [word, count] : partial.counts) {
+        size_t shared = 0;
+        size_t limit = min(previous.size(), word.size());
+        while (shared < limit && previous[shared] == word[shared]) shared++;
+
+        appendVarint(image, shared);
+        appendVarint(image, word.size() - shared);
+        image.insert(image.end(), word.begin() + static_cast<ptrdiff_t>(shared), word.end());
+        appendVarint(image, count);
+        previous = word;
+    }
+
+    PartialHeader header{};
+    memcpy(header.magic, PartialMagic, sizeof(PartialMagic));
+    header.version = PartialVersion;
+    header.pathLength = static_cast<uint32_t>(path.size());
+    header.size = fingerprint.size;
+    header.modified = fingerprint.modified;
+    header.contentHash = fingerprint.contentHash;
+    header.tokens = partial.tokens;
+    header.wordCount = partial.counts.size();
+    header.fileSize = image.size();
+    memcpy(image.data(), &header, sizeof(header));
+
+    // Written aside and renamed, so readers never see half an entry.
+    string target = entryPath(path);
+    string temporary = target + ".tmp";
+    QFile file(QString::fromStdString(temporary));
+    if (!file.open(QIODevice::WriteOnly)) {
+        Logger::log(Logger::Error, "Failed to write cache entry: " + temporary);
+        return false;
+    }
+    bool written = file.write(reinterpret_cast<const char*>(image.data()), static_cast<qint64>(image.size())) ==
+                   static_cast<qint64>(image.size());
+    file.close();
+
+    error_code error;
+    if (written) filesystem::rename(temporary, target, error);
+    if (!written || error) {
+        Logger::log(Logger::Error, "Failed to write cache entry: " + target);
+        filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+string PartialCache::entryPath(const string& path) const {
+    char name[24];
+    snprintf(name, sizeof(name), "%016llx.part", static_cast<unsigned long long>(hashWord(path)));
+    return root + "/" + name;
+}
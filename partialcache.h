@@ -0,0 +1,69 @@
+#ifndef PARTIALCACHE_H
+#define PARTIALCACHE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Word counts of single files kept between runs, one small binary entry
+// per source file under a cache directory, named after a hash of the
+// source path. An entry stays valid while its file has the same size and
+// modification time; when only the time changed, a matching content hash
+// revives it. Words are stored sorted and front coded.
+class PartialCache {
+public:
+    struct Fingerprint {
+        uint64_t size = 0;
+        // Nanoseconds since the epoch.
+        int64_t modified = 0;
+        uint64_t contentHash = 0;
+    };
+
+    struct Partial {
+        // Sorted by word.
+        vector<pair<string, uint64_t>> counts;
+        // Tokens before normalization.
+        uint64_t tokens = 0;
+    };
+
+    // 64-bit hash of a byte stream; the result does not depend on how the
+    // stream is split between update() calls.
+    class ContentHasher {
+    public:
+        void update(const char* data, size_t size);
+
+        uint64_t value() const;
+
+    private:
+        uint64_t state = 0x452821e638d01377ULL;
+        uint64_t length = 0;
+        char pending[8] = {};
+        size_t pendingSize = 0;
+    };
+
+    explicit PartialCache(string directory);
+
+    const string& directory() const;
+
+    // Size and modification time of path, without the content hash.
+    static bool stat(const string& path, Fingerprint& fingerprint);
+
+    static bool hashFile(const string& path, uint64_t& hash);
+
+    // The stored counts of path if the entry matches current, the file as it
+    // is now. A revived entry is rewritten with the new modification time.
+    bool lookup(const string& path, const Fingerprint& current, Partial& partial);
+
+    bool store(const string& path, const Fingerprint& fingerprint, const Partial& partial);
+
+private:
+    string root;
+
+    string entryPath(const string& path) const;
+};
+
+#endif // PARTIALCACHE_H
@@ -0,0 +1,152 @@
+#include "spellindex.h"
+#include <algorithm>
+#include <unordered_set>
+
+using namespace std;
+
+SpellIndex::SpellIndex(int maxEditDistance, int prefixLength)
+    : maxDistance(clamp(maxEditDistance, 1, 3)),
+      prefix(max(prefixLength, maxDistance + 1)) {
+}
+
+void SpellIndex::addWord(uint32_t id, const string& word) {
+    for (uint64_t hash : deleteHashes(decodeUtf8(word), maxDistance)) {
+        deletes[hash].push_back(id);
+    }
+}
+
+vector<pair<uint32_t, int>> SpellIndex::lookup(const string& query, int maxDistanceLimit,
+                                               const function<const string&(uint32_t)>& wordAt) const {
+    vector<pair<uint32_t, int>> matches;
+    int limit = min(maxDistanceLimit, maxDistance);
+    if (limit < 0) return matches;
+
+    u32string target = decodeUtf8(query);
+    unordered_set<uint32_t> seen;
+
+    for (uint64_t hash : deleteHashes(target, limit)) {
+        auto it = deletes.find(hash);
+        if (it == deletes.end()) continue;
+
+        for (uint32_t id : it->second) {
+            if (!seen.insert(id).second) continue;
+
+            u32string candidate = decodeUtf8(wordAt(id));
+            if (abs(static_cast<int>(candidate.size()) - static_cast<int>(target.size())) > limit) {
+                continue;
+            }
+
+            int distance = editDistance(target, candidate, limit);
+            if (distance <= limit) {
+                matches.emplace_back(id, distance);
+            }
+        }
+    }
+    return matches;
+}
+
+void SpellIndex::clear() {
+    deletes.clear();
+}
+
+int SpellIndex::maxEditDistance() const {
+    return maxDistance;
+}
+
+int SpellIndex::prefixLength() const {
+    return prefix;
+}
+
+size_t SpellIndex::deleteCount() const {
+    return deletes.size();
+}
+
+size_t SpellIndex::memoryUsage() const {
+    size_t bytes = deletes.bucket_count() * sizeof(void*);
+    for (const auto& [hash, ids] : deletes) {
+        bytes += sizeof(void*) + sizeof(hash) + sizeof(ids) + ids.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+int SpellIndex::editDistance(const u32string& a, const u32string& b, int maxDistanceLimit) {
+    const size_t n = a.size();
+    const size_t m = b.size();
+    vector<int> previous(m + 1), current(m + 1), beforePrevious(m + 1);
+
+    for (size_t j = 0; j <= m; j++) previous[j] = static_cast<int>(j);
+
+    for (size_t i = 1; i <= n; i++) {
+        current[0] = static_cast<int>(i);
+        int rowMin = current[0];
+        for (size_t j = 1; j <= m; j++) {
+            int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            current[j] = min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) {
+                current[j] = min(current[j], beforePrevious[j - 2] + 1);
+            }
+            rowMin = min(rowMin, current[j]);
+        }
+        if (rowMin > maxDistanceLimit) return maxDistanceLimit + 1;
+
+        beforePrevious.swap(previous);
+        previous.swap(current);
+    }
+    return previous[m];
+}
+
+u32string SpellIndex::decodeUtf8(const string& text) {
+    u32string result;
+    result.reserve(text.size());
+
+    for (size_t i = 0; i < text.size();) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        int length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xe ? 3 : (c >> 3) == 0x1e ? 4 : 1;
+        if (i + length > text.size()) length = 1;
+
+        char32_t codePoint = length == 1 ? c : c & (0x7f >> length);
+        for (int k = 1; k < length; k++) {
+            codePoint = (codePoint << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3f);
+        }
+        result.push_back(codePoint);
+        i += length;
+    }
+    return result;
+}
+
+vector<uint64_t> SpellIndex::deleteHashes(const u32string& word, int distance) const {
+    u32string head = word.substr(0, static_cast<size_t>(prefix));
+
+    unordered_set<u32string> generated{head};
+    vector<u32string> frontier{head};
+    for (int d = 0; d < distance; d++) {
+        vector<u32string> next;
+        for (const auto& text : frontier) {
+            for (size_t i = 0; i < text.size(); i++) {
+                u32string shorter = text.substr(0, i) + text.substr(i + 1);
+                if (generated.insert(shorter).second) {
+                    next.push_back(std::move(shorter));
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+
+    vector<uint64_t> hashes;
+    hashes.reserve(generated.size());
+    for (const auto& text : generated) {
+        hashes.push_back(hashOf(text));
+    }
+    sort(hashes.begin(), hashes.end());
+    hashes.erase(unique(hashes.begin(), hashes.end()), hashes.end());
+    return hashes;
+}
+
+uint64_t SpellIndex::hashOf(const u32string& text) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (char32_t c : text) {
+        hash ^= static_cast<uint64_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
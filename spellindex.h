@@ -0,0 +1,51 @@
+#ifndef SPELLINDEX_H
+#define SPELLINDEX_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+using namespace std;
+
+// SymSpell-style deletion index: every word is registered under all strings
+// obtained by deleting up to maxEditDistance code points from its prefix, so a
+// query only has to look up its own deletions instead of scanning the
+// vocabulary. Memory grows with maxEditDistance and prefixLength.
+class SpellIndex {
+public:
+    SpellIndex(int maxEditDistance = 2, int prefixLength = 7);
+
+    void addWord(uint32_t id, const string& word);
+
+    // Ids of words within maxDistance edits (Damerau-Levenshtein, optimal string
+    // alignment) of the query, paired with their distance.
+    vector<pair<uint32_t, int>> lookup(const string& query, int maxDistance,
+                                       const function<const string&(uint32_t)>& wordAt) const;
+
+    void clear();
+
+    int maxEditDistance() const;
+
+    int prefixLength() const;
+
+    size_t deleteCount() const;
+
+    size_t memoryUsage() const;
+
+    static int editDistance(const u32string& a, const u32string& b, int maxDistance);
+
+    static u32string decodeUtf8(const string& text);
+
+private:
+    int maxDistance;
+    int prefix;
+    unordered_map<uint64_t, vector<uint32_t>> deletes;
+
+    vector<uint64_t> deleteHashes(const u32string& word, int distance) const;
+
+    static uint64_t hashOf(const u32string& text);
+};
+
+#endif // SPELLINDEX_H
@@ -0,0 +1,71 @@
+#include "streamtokenizer.h"
+#include <algorithm>
+#include <array>
+
+using namespace std;
+
+namespace {
+
+// The same separators as istream >> string in the C locale.
+constexpr array<bool, 256> makeSeparators() {
+    array<bool, 256> table = {};
+    for (unsigned char c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+        table[c] = true;
+    }
+    return table;
+}
+
+constexpr array<bool, 256> Separators = makeSeparators();
+
+}
+
+void StreamTokenizer::feed(const char* data, size_t size, const TokenHandler& handler) {
+    const char* position = data;
+    const char* end = data + size;
+
+    while (position < end) {
+        if (isSeparator(*position)) {
+            if (!carry.empty()) {
+                handler(carry);
+                carry.clear();
+                truncated = false;
+            }
+            position++;
+            continue;
+        }
+
+        const char* tokenEnd = position;
+        while (tokenEnd < end && !isSeparator(*tokenEnd)) tokenEnd++;
+
+        if (tokenEnd == end) {
+            append(position, tokenEnd);
+        } else if (carry.empty()) {
+            handler(string_view(position, static_cast<size_t>(tokenEnd - position)).substr(0, MaxTokenLength));
+        } else {
+            append(position, tokenEnd);
+            handler(carry);
+            carry.clear();
+            truncated = false;
+        }
+        position = tokenEnd;
+    }
+}
+
+void StreamTokenizer::finish(const TokenHandler& handler) {
+    if (!carry.empty()) handler(carry);
+    carry.clear();
+    truncated = false;
+}
+
+bool StreamTokenizer::isSeparator(char c) {
+    return Separators[static_cast<unsigned char>(c)];
+}
+
+void StreamTokenizer::append(const char* begin, const char* end) {
+    if (truncated) return;
+
+    size_t room = MaxTokenLength - carry.size();
+    size_t length = static_cast<size_t>(end - begin);
+    carry.append(begin, min(room, length));
+    truncated = length >= room;
+}
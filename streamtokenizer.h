@@ -0,0 +1,35 @@
+#ifndef STREAMTOKENIZER_H
+#define STREAMTOKENIZER_H
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <cstddef>
+
+using namespace std;
+
+// Splits a byte stream that arrives in arbitrary chunks into
+// whitespace-separated tokens. A token cut by a chunk boundary is carried
+// over to the next chunk; tokens longer than MaxTokenLength are truncated,
+// so memory stays bounded whatever the input looks like.
+class StreamTokenizer {
+public:
+    static constexpr size_t MaxTokenLength = 1 << 16;
+
+    using TokenHandler = function<void(string_view)>;
+
+    void feed(const char* data, size_t size, const TokenHandler& handler);
+
+    // Emits the token still pending at the end of the stream.
+    void finish(const TokenHandler& handler);
+
+    static bool isSeparator(char c);
+
+private:
+    string carry;
+    bool truncated = false;
+
+    void append(const char* begin, const char* end);
+};
+
+#endif // STREAMTOKENIZER_H
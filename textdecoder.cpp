@@ -0,0 +1,300 @@
+#include "textdecoder.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Code points of the CP1251 bytes 0x80-0xFF; 0x98 is unassigned.
+constexpr array<uint16_t, 128> Cp1251CodePoints = {
+    0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+    0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0xFFFD, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+    0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7,
+    0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+    0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7,
+    0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457,
+    0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+    0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+    0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+    0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+};
+
+struct Utf8Sequence {
+    char bytes[3];
+    uint8_t length;
+};
+
+constexpr Utf8Sequence encodeBmp(uint16_t codePoint) {
+    if (codePoint < 0x80) return {{static_cast<char>(codePoint), 0, 0}, 1};
+    if (codePoint < 0x800) {
+        return {{static_cast<char>(0xC0 | (codePoint >> 6)), static_cast<char>(0x80 | (codePoint & 0x3F)), 0}, 2};
+    }
+    return {{static_cast<char>(0xE0 | (codePoint >> 12)), static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)),
+             static_cast<char>(0x80 | (codePoint & 0x3F))}, 3};
+}
+
+constexpr array<Utf8Sequence, 128> makeCp1251Table() {
+    array<Utf8Sequence, 128> table = {};
+    for (size_t i = 0; i < table.size(); i++) {
+        table[i] = encodeBmp(Cp1251CodePoints[i]);
+    }
+    return table;
+}
+
+constexpr array<Utf8Sequence, 128> Cp1251Utf8 = makeCp1251Table();
+
+char* encodeUtf8(uint32_t codePoint, char* out) {
+    if (codePoint < 0x10000) {
+        Utf8Sequence sequence = encodeBmp(static_cast<uint16_t>(codePoint));
+        memcpy(out, sequence.bytes, sizeof(sequence.bytes));
+        return out + sequence.length;
+    }
+    out[0] = static_cast<char>(0xF0 | (codePoint >> 18));
+    out[1] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (codePoint & 0x3F));
+    return out + 4;
+}
+
+uint16_t readUnit(const char* data, bool bigEndian) {
+    auto high = static_cast<uint8_t>(data[bigEndian ? 0 : 1]);
+    auto low = static_cast<uint8_t>(data[bigEndian ? 1 : 0]);
+    return static_cast<uint16_t>(high << 8 | low);
+}
+
+// Length of the leading run of ASCII bytes.
+size_t asciiPrefix(const char* data, size_t size) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= size; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        if (mask != 0) return i + static_cast<size_t>(countr_zero(static_cast<unsigned>(mask)));
+    }
+#endif
+    while (i < size && static_cast<unsigned char>(data[i]) < 0x80) i++;
+    return i;
+}
+
+// Narrows the leading run of ASCII UTF-16 units into out; returns its length in units.
+size_t packAscii(const char* data, size_t units, bool bigEndian, char* out) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    for (; i + 8 <= units; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 2 * i));
+        if (bigEndian) v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(v, nonAscii), _mm_setzero_si128());
+        if (_mm_movemask_epi8(ascii) != 0xFFFF) break;
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(v, v));
+    }
+#endif
+    for (; i < units; i++) {
+        uint16_t unit = readUnit(data + 2 * i, bigEndian);
+        if (unit >= 0x80) break;
+        out[i] = static_cast<char>(unit);
+    }
+    return i;
+}
+
+// True if data is UTF-8, allowing a sequence cut off by the end.
+bool isUtf8(const unsigned char* data, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        i += asciiPrefix(reinterpret_cast<const char*>(data + i), size - i);
+        if (i == size) break;
+
+        unsigned char lead = data[i];
+        size_t length = lead >= 0xC2 && lead <= 0xDF ? 2 : lead >= 0xE0 && lead <= 0xEF ? 3
+                      : lead >= 0xF0 && lead <= 0xF4 ? 4 : 0;
+        if (length == 0) return false;
+        for (size_t k = 1; k < length; k++) {
+            if (i + k == size) return true;
+            if ((data[i + k] & 0xC0) != 0x80) return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+size_t bomLength(const unsigned char* data, size_t size, TextDecoder::Encoding encoding) {
+    switch (encoding) {
+    case TextDecoder::Utf8:
+        return size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF ? 3 : 0;
+    case TextDecoder::Utf16LE:
+        return size >= 2 && data[0] == 0xFF && data[1] == 0xFE ? 2 : 0;
+    case TextDecoder::Utf16BE:
+        return size >= 2 && data[0] == 0xFE && data[1] == 0xFF ? 2 : 0;
+    default:
+        return 0;
+    }
+}
+
+}
+
+TextDecoder::Encoding TextDecoder::detect(const char* data, size_t size) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    for (Encoding encoding : {Utf8, Utf16LE, Utf16BE}) {
+        if (bomLength(bytes, size, encoding) > 0) return encoding;
+    }
+    size = min(size, SampleSize);
+
+    // In UTF-16 without a mark nearly every other byte is the high byte of a
+    // Latin (0x00) or Cyrillic (0x04) unit; in 8-bit text such bytes are rare.
+    size_t pairs = size / 2;
+    size_t evenHigh = 0;
+    size_t oddHigh = 0;
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        evenHigh += bytes[i] == 0x00 || bytes[i] == 0x04;
+        oddHigh += bytes[i + 1] == 0x00 || bytes[i + 1] == 0x04;
+    }
+    if (pairs >= 2) {
+        if (oddHigh * 10 >= pairs * 7 && evenHigh * 10 <= pairs) return Utf16LE;
+        if (evenHigh * 10 >= pairs * 7 && oddHigh * 10 <= pairs) return Utf16BE;
+    }
+
+    if (isUtf8(bytes, size)) return Utf8;
+
+    size_t high = 0;
+    size_t letters = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (bytes[i] < 0x80) continue;
+        high++;
+        letters += bytes[i] >= 0xC0 || bytes[i] == 0xA8 || bytes[i] == 0xB8;
+    }
+    return letters * 2 >= high ? Cp1251 : Utf8;
+}
+
+string TextDecoder::encodingName(Encoding encoding) {
+    switch (encoding) {
+    case Utf8:
+        return "UTF-8";
+    case Utf16LE:
+        return "UTF-16LE";
+    case Utf16BE:
+        return "UTF-16BE";
+    case Cp1251:
+        return "CP1251";
+    }
+    return "unknown";
+}
+
+TextDecoder::TextDecoder() : source(Utf8), detecting(true) {
+}
+
+TextDecoder::TextDecoder(Encoding encoding) : source(encoding), detecting(false) {
+}
+
+void TextDecoder::feed(const char* data, size_t size, const ChunkHandler& handler) {
+    if (size == 0) return;
+
+    if (!started) {
+        started = true;
+        if (detecting) source = detect(data, size);
+        size_t mark = bomLength(reinterpret_cast<const unsigned char*>(data), size, source);
+        data += mark;
+        size -= mark;
+    }
+
+    size_t length = 0;
+    switch (source) {
+    case Utf8:
+        if (size > 0) handler(data, size);
+        return;
+    case Cp1251:
+        length = decodeCp1251(data, size);
+        break;
+    case Utf16LE:
+    case Utf16BE:
+        length = decodeUtf16(data, size);
+        break;
+    }
+    if (length > 0) handler(output.data(), length);
+}
+
+TextDecoder::Encoding TextDecoder::encoding() const {
+    return source;
+}
+
+size_t TextDecoder::decodeCp1251(const char* data, size_t size) {
+    output.resize(max(output.size(), size * 3 + 3));
+    char* out = output.data();
+
+    size_t i = 0;
+    while (i < size) {
+        size_t ascii = asciiPrefix(data + i, size - i);
+        memcpy(out, data + i, ascii);
+        out += ascii;
+        i += ascii;
+        if (i == size) break;
+
+        // Always three bytes copied, so the copy has a fixed size; out moves by length.
+        const Utf8Sequence& sequence = Cp1251Utf8[static_cast<unsigned char>(data[i]) - 0x80];
+        memcpy(out, sequence.bytes, sizeof(sequence.bytes));
+        out += sequence.length;
+        i++;
+    }
+    return static_cast<size_t>(out - output.data());
+}
+
+size_t TextDecoder::decodeUtf16(const char* data, size_t size) {
+    const bool bigEndian = source == Utf16BE;
+    output.resize(max(output.size(), (size / 2 + 2) * 3 + 4));
+    char* out = output.data();
+
+    if (hasCarry) {
+        char unit[2] = {carry, data[0]};
+        out = decodeUnit(readUnit(unit, bigEndian), out);
+        hasCarry = false;
+        data++;
+        size--;
+    }
+
+    const size_t units = size / 2;
+    size_t i = 0;
+    while (i < units) {
+        if (highSurrogate == 0) {
+            size_t ascii = packAscii(data + 2 * i, units - i, bigEndian, out);
+            out += ascii;
+            i += ascii;
+            if (i == units) break;
+        }
+        out = decodeUnit(readUnit(data + 2 * i, bigEndian), out);
+        i++;
+    }
+
+    if (size % 2 != 0) {
+        carry = data[size - 1];
+        hasCarry = true;
+    }
+    return static_cast<size_t>(out - output.data());
+}
+
+char* TextDecoder::decodeUnit(uint16_t unit, char* out) {
+    if (highSurrogate != 0) {
+        uint16_t high = highSurrogate;
+        highSurrogate = 0;
+        if (unit >= 0xDC00 && unit <= 0xDFFF) {
+            return encodeUtf8(0x10000 + ((static_cast<uint32_t>(high) - 0xD800) << 10) + (unit - 0xDC00), out);
+        }
+        out = encodeUtf8(0xFFFD, out);
+    }
+
+    if (unit >= 0xD800 && unit <= 0xDBFF) {
+        highSurrogate = unit;
+        return out;
+    }
+    if (unit >= 0xDC00 && unit <= 0xDFFF) return encodeUtf8(0xFFFD, out);
+    return encodeUtf8(unit, out);
+}
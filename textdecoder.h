@@ -0,0 +1,65 @@
+#ifndef TEXTDECODER_H
+#define TEXTDECODER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Brings text in the encodings common for Russian sources to the UTF-8 the
+// tokenizer expects. UTF-8 and ASCII input is passed on untouched, without
+// a copy; CP1251 and UTF-16 are converted chunk by chunk, with ASCII runs
+// handled sixteen bytes at a time where SSE2 is available. A code unit cut
+// by a chunk boundary is carried over to the next chunk.
+class TextDecoder {
+public:
+    enum Encoding {
+        Utf8,
+        Utf16LE,
+        Utf16BE,
+        Cp1251
+    };
+
+    using ChunkHandler = function<void(const char* data, size_t size)>;
+
+    static constexpr size_t SampleSize = 1 << 16;
+
+    // From a byte order mark, or else from the byte statistics of the first
+    // SampleSize bytes. Data that is neither UTF-16 nor valid UTF-8 is taken
+    // for CP1251 when most of its high bytes are CP1251 letters.
+    static Encoding detect(const char* data, size_t size);
+
+    static string encodingName(Encoding encoding);
+
+    // Detects the encoding from the first chunk fed.
+    TextDecoder();
+
+    explicit TextDecoder(Encoding encoding);
+
+    // Passes data on to handler as UTF-8. A byte order mark at the start of
+    // the input is dropped.
+    void feed(const char* data, size_t size, const ChunkHandler& handler);
+
+    Encoding encoding() const;
+
+private:
+    Encoding source;
+    bool detecting;
+    bool started = false;
+    vector<char> output;
+    // Odd byte of a UTF-16 unit cut by the chunk boundary.
+    char carry = 0;
+    bool hasCarry = false;
+    uint16_t highSurrogate = 0;
+
+    size_t decodeCp1251(const char* data, size_t size);
+
+    size_t decodeUtf16(const char* data, size_t size);
+
+    char* decodeUnit(uint16_t unit, char* out);
+};
+
+#endif // TEXTDECODER_H
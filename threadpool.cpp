@@ -0,0 +1,105 @@
+#include "threadpool.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <string>
+
+using namespace std;
+
+ThreadPool::TaskGroup::TaskGroup(ThreadPool& pool) : pool(pool), pending(0) {
+}
+
+ThreadPool::TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void ThreadPool::TaskGroup::run(function<void()> task) {
+    pending++;
+    pool.enqueue([this, task = std::move(task)]() {
+        try {
+            task();
+        } catch (const exception& e) {
+            Logger::log(Logger::Error, "Exception in pool task: " + string(e.what()));
+        }
+        // The decrement happens under the lock so that wait() cannot return
+        // and destroy the group while this task still touches it.
+        lock_guard<mutex> lock(doneMutex);
+        if (--pending == 0) done.notify_all();
+    });
+}
+
+void ThreadPool::TaskGroup::wait() {
+    while (true) {
+        if (pending == 0) {
+            lock_guard<mutex> lock(doneMutex);
+            return;
+        }
+        if (pool.runOne()) continue;
+
+        unique_lock<mutex> lock(doneMutex);
+        done.wait_for(lock, chrono::milliseconds(1), [this]() { return pending == 0; });
+    }
+}
+
+ThreadPool::ThreadPool(int threads) : stopping(false) {
+    size_t count = threads > 0 ? static_cast<size_t>(threads) : max(1u, thread::hardware_concurrency());
+    workers.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+size_t ThreadPool::threadCount() const {
+    return workers.size();
+}
+
+void ThreadPool::enqueue(function<void()> task) {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        tasks.push_back(std::move(task));
+    }
+    available.notify_one();
+}
+
+bool ThreadPool::runOne() {
+    function<void()> task;
+    {
+        lock_guard<mutex> lock(queueMutex);
+        if (tasks.empty()) return false;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
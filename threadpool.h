@@ -0,0 +1,60 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstddef>
+
+using namespace std;
+
+// Fixed set of worker threads fed from one FIFO queue. Work is submitted
+// through a TaskGroup, whose wait() runs queued tasks on the calling thread
+// until every task of the group has finished, so groups may be waited on
+// from inside other tasks.
+class ThreadPool {
+public:
+    class TaskGroup {
+    public:
+        explicit TaskGroup(ThreadPool& pool);
+        ~TaskGroup();
+
+        void run(function<void()> task);
+
+        void wait();
+
+    private:
+        ThreadPool& pool;
+        atomic<size_t> pending;
+        mutex doneMutex;
+        condition_variable done;
+    };
+
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Process-wide pool with one thread per hardware thread, started on first use.
+    static ThreadPool& shared();
+
+    size_t threadCount() const;
+
+private:
+    vector<thread> workers;
+    deque<function<void()>> tasks;
+    mutex queueMutex;
+    condition_variable available;
+    bool stopping;
+
+    void enqueue(function<void()> task);
+    bool runOne();
+    void workerLoop();
+};
+
+#endif // THREADPOOL_H
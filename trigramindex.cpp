@@ -0,0 +1,169 @@
+#include "trigramindex.h"
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+void TrigramIndex::addWord(uint32_t id, const string& word) {
+    if (word.size() < 3) return;
+
+    for (size_t i = 0; i + 3 <= word.size(); i++) {
+        PostingList& list = postings[trigramKey(word.data() + i)];
+        if (list.size > 0 && list.lastId == id) continue;
+
+        appendVarint(list.data, list.size == 0 ? id : id - list.lastId);
+        list.lastId = id;
+        list.size++;
+    }
+}
+
+bool TrigramIndex::candidates(const vector<string>& literals, vector<uint32_t>& out) const {
+    vector<const PostingList*> lists;
+
+    for (const auto& literal : literals) {
+        for (size_t i = 0; i + 3 <= literal.size(); i++) {
+            auto it = postings.find(trigramKey(literal.data() + i));
+            if (it == postings.end()) {
+                out.clear();
+                return true;
+            }
+            lists.push_back(&it->second);
+        }
+    }
+
+    if (lists.empty()) return false;
+
+    sort(lists.begin(), lists.end(),
+         [](const PostingList* a, const PostingList* b) { return a->size < b->size; });
+    lists.erase(unique(lists.begin(), lists.end()), lists.end());
+
+    out = decode(*lists[0]);
+    vector<uint32_t> next;
+    vector<uint32_t> merged;
+    for (size_t i = 1; i < lists.size() && !out.empty(); i++) {
+        next = decode(*lists[i]);
+        merged.clear();
+        set_intersection(out.begin(), out.end(), next.begin(), next.end(),
+                         back_inserter(merged));
+        out.swap(merged);
+    }
+    return true;
+}
+
+vector<string> TrigramIndex::requiredLiterals(const string& pattern) {
+    vector<string> literals;
+    string current;
+
+    auto flush = [&]() {
+        if (current.size() >= 3) literals.push_back(current);
+        current.clear();
+    };
+
+    auto skipGroup = [&](size_t i, char open, char close) {
+        int depth = 0;
+        for (; i < pattern.size(); i++) {
+            if (pattern[i] == '\\') {
+                i++;
+            } else if (pattern[i] == open) {
+                depth++;
+            } else if (pattern[i] == close && --depth == 0) {
+                break;
+            }
+        }
+        return i;
+    };
+
+    for (size_t i = 0; i < pattern.size(); i++) {
+        char c = pattern[i];
+        switch (c) {
+            case '|':
+                return {};
+            case '\\':
+                if (i + 1 < pattern.size() && !isalnum(static_cast<unsigned char>(pattern[i + 1]))) {
+                    current.push_back(pattern[++i]);
+                } else {
+                    flush();
+                    i++;
+                }
+                break;
+            case '[':
+                flush();
+                i = skipGroup(i, '[', ']');
+                break;
+            case '(':
+                flush();
+                i = skipGroup(i, '(', ')');
+                break;
+            case '?':
+            case '*':
+            case '{':
+                if (!current.empty()) current.pop_back();
+                flush();
+                if (c == '{') i = skipGroup(i, '{', '}');
+                break;
+            case '+':
+            case '.':
+            case '^':
+            case '$':
+                flush();
+                break;
+            default:
+                current.push_back(c);
+                break;
+        }
+    }
+    flush();
+
+    return literals;
+}
+
+void TrigramIndex::clear() {
+    postings.clear();
+}
+
+size_t TrigramIndex::trigramCount() const {
+    return postings.size();
+}
+
+size_t TrigramIndex::memoryUsage() const {
+    size_t bytes = postings.bucket_count() * sizeof(void*);
+    for (const auto& [key, list] : postings) {
+        bytes += sizeof(key) + sizeof(list) + list.data.capacity();
+    }
+    return bytes;
+}
+
+uint32_t TrigramIndex::trigramKey(const char* p) {
+    return (static_cast<uint32_t>(static_cast<unsigned char>(p[0])) << 16) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(p[1])) << 8) |
+           static_cast<uint32_t>(static_cast<unsigned char>(p[2]));
+}
+
+void TrigramIndex::appendVarint(vector<uint8_t>& data, uint32_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+vector<uint32_t> TrigramIndex::decode(const PostingList& list) {
+    vector<uint32_t> ids;
+    ids.reserve(list.size);
+
+    uint32_t id = 0;
+    uint32_t value = 0;
+    int shift = 0;
+    for (uint8_t byte : list.data) {
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        id = ids.empty() ? value : id + value;
+        ids.push_back(id);
+        value = 0;
+        shift = 0;
+    }
+    return ids;
+}
@@ -0,0 +1,45 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+// Inverted index from byte trigrams to word ids. Posting lists are kept
+// sorted and stored as delta + varint encoded bytes, so appending a new
+// (always larger) word id is O(1) and the index grows with the vocabulary.
+class TrigramIndex {
+public:
+    void addWord(uint32_t id, const string& word);
+
+    // Ids of words containing every trigram of every literal. Returns false
+    // when the literals are too short to narrow the search (caller must scan).
+    bool candidates(const vector<string>& literals, vector<uint32_t>& out) const;
+
+    // Literal fragments that every match of an ECMAScript regex must contain.
+    static vector<string> requiredLiterals(const string& pattern);
+
+    void clear();
+
+    size_t trigramCount() const;
+
+    size_t memoryUsage() const;
+
+private:
+    struct PostingList {
+        vector<uint8_t> data;
+        uint32_t lastId = 0;
+        uint32_t size = 0;
+    };
+
+    unordered_map<uint32_t, PostingList> postings;
+
+    static uint32_t trigramKey(const char* p);
+    static void appendVarint(vector<uint8_t>& data, uint32_t value);
+    static vector<uint32_t> decode(const PostingList& list);
+};
+
+#endif // TRIGRAMINDEX_H
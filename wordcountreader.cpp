@@ -0,0 +1,34 @@
+#include "wordcountreader.h"
+#include "streamtokenizer.h"
+#include <charconv>
+#include <vector>
+
+using namespace std;
+
+bool WordCountReader::read(QIODevice& device, const EntryHandler& handler) {
+    StreamTokenizer tokenizer;
+    string word;
+    bool haveWord = false;
+
+    auto onToken = [&](string_view token) {
+        if (haveWord) {
+            int count = 0;
+            auto [end, error] = from_chars(token.data(), token.data() + token.size(), count);
+            if (error == errc() && end == token.data() + token.size()) {
+                handler(word, count);
+                haveWord = false;
+                return;
+            }
+        }
+        word.assign(token);
+        haveWord = true;
+    };
+
+    vector<char> buffer(ReadBufferSize);
+    qint64 bytesRead;
+    while ((bytesRead = device.read(buffer.data(), static_cast<qint64>(buffer.size()))) > 0) {
+        tokenizer.feed(buffer.data(), static_cast<size_t>(bytesRead), onToken);
+    }
+    tokenizer.finish(onToken);
+    return bytesRead == 0;
+}
@@ -0,0 +1,27 @@
+#ifndef WORDCOUNTREADER_H
+#define WORDCOUNTREADER_H
+
+#include <QIODevice>
+#include <string>
+#include <functional>
+#include <cstddef>
+
+using namespace std;
+
+// Reads the "word count" text format written by Dictionary::saveToFile().
+// The device is read in raw blocks and split on whitespace in one pass, so
+// '\r' and '\n' are ordinary separators and a CRLF file reads exactly like
+// an LF one; no line is ever built. Tokens are taken in pairs; when the
+// token in the count position is not a number it starts a new pair, which
+// skips a malformed line without losing the one after it.
+class WordCountReader {
+public:
+    static constexpr size_t ReadBufferSize = 1 << 20;
+
+    using EntryHandler = function<void(const string& word, int count)>;
+
+    // Returns false if the device fails mid-read.
+    static bool read(QIODevice& device, const EntryHandler& handler);
+};
+
+#endif // WORDCOUNTREADER_H
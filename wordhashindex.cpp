@@ -0,0 +1,71 @@
+#include "wordhashindex.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+const size_t InitialCapacity = 1024;
+
+}
+
+WordHashIndex::WordHashIndex() {
+    clear();
+}
+
+void WordHashIndex::insert(uint64_t hash, uint32_t id) {
+    if (id >= hashes.size()) hashes.resize(static_cast<size_t>(id) + 1, 0);
+    hashes[id] = hash;
+
+    if ((hashes.size() + 1) * 4 > slots.size() * 3) {
+        grow();
+    } else {
+        place(hash, id);
+    }
+}
+
+void WordHashIndex::clear() {
+    slots.assign(InitialCapacity, Slot{0, Npos});
+    hashes.clear();
+    mask = InitialCapacity - 1;
+}
+
+void WordHashIndex::remap(const vector<uint32_t>& newIds) {
+    vector<uint64_t> kept;
+    for (uint32_t id = 0; id < hashes.size() && id < newIds.size(); id++) {
+        if (newIds[id] == Npos) continue;
+        if (newIds[id] >= kept.size()) kept.resize(static_cast<size_t>(newIds[id]) + 1, 0);
+        kept[newIds[id]] = hashes[id];
+    }
+    hashes.swap(kept);
+
+    fill(slots.begin(), slots.end(), Slot{0, Npos});
+    for (uint32_t id = 0; id < hashes.size(); id++) {
+        place(hashes[id], id);
+    }
+}
+
+size_t WordHashIndex::memoryUsage() const {
+    return slots.capacity() * sizeof(Slot) + hashes.capacity() * sizeof(uint64_t);
+}
+
+void WordHashIndex::place(uint64_t hash, uint32_t id) {
+    uint64_t i = hash & mask;
+    while (slots[i].id != Npos) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = Slot{static_cast<uint32_t>(hash >> 32), id};
+}
+
+void WordHashIndex::grow() {
+    size_t capacity = slots.size();
+    while ((hashes.size() + 1) * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+
+    slots.assign(capacity, Slot{0, Npos});
+    mask = capacity - 1;
+    for (uint32_t id = 0; id < hashes.size(); id++) {
+        place(hashes[id], id);
+    }
+}
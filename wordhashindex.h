@@ -0,0 +1,105 @@
+#ifndef WORDHASHINDEX_H
+#define WORDHASHINDEX_H
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+
+inline void prefetchAddress(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#elif defined(_MSC_VER)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    (void)address;
+#endif
+}
+
+inline uint64_t mixHash(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+inline uint64_t hashWord(string_view word) {
+    uint64_t hash = 0x243f6a8885a308d3ULL ^ word.size();
+    size_t i = 0;
+    for (; i + 8 <= word.size(); i += 8) {
+        uint64_t chunk;
+        memcpy(&chunk, word.data() + i, sizeof(chunk));
+        hash = mixHash(hash ^ chunk);
+    }
+    uint64_t tail = 0;
+    if (i < word.size()) memcpy(&tail, word.data() + i, word.size() - i);
+    return mixHash(hash ^ tail ^ 0x13198a2e03707344ULL);
+}
+
+// Open-addressing word hash -> word id table with linear probing. It only
+// stores ids and 32-bit hash tags; callers confirm a hit against their own
+// key storage. The split between prefetch()/candidate() and find() lets batched
+// callers issue all memory loads of a batch before resolving any of them.
+class WordHashIndex {
+public:
+    static constexpr uint32_t Npos = UINT32_MAX;
+
+    WordHashIndex();
+
+    void prefetch(uint64_t hash) const {
+        prefetchAddress(&slots[hash & mask]);
+    }
+
+    // First id whose tag matches, without confirming the key.
+    uint32_t candidate(uint64_t hash) const {
+        const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+        for (uint64_t i = hash & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (slot.id == Npos || slot.tag == tag) return slot.id;
+        }
+    }
+
+    template <typename Equals>
+    uint32_t find(uint64_t hash, Equals&& equals) const {
+        const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+        for (uint64_t i = hash & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (slot.id == Npos) return Npos;
+            if (slot.tag == tag && equals(slot.id)) return slot.id;
+        }
+    }
+
+    // Ids must be inserted densely: 0, 1, 2, ...
+    void insert(uint64_t hash, uint32_t id);
+
+    void clear();
+
+    // Renumbers ids after words were dropped: newIds[id] is the new dense id,
+    // or Npos to remove the entry. Stored hashes are reused, not recomputed.
+    void remap(const vector<uint32_t>& newIds);
+
+    size_t memoryUsage() const;
+
+private:
+    struct Slot {
+        uint32_t tag;
+        uint32_t id;
+    };
+
+    vector<Slot> slots;
+    vector<uint64_t> hashes;
+    uint64_t mask;
+
+    void place(uint64_t hash, uint32_t id);
+    void grow();
+};
+
+#endif // WORDHASHINDEX_H